@@ -0,0 +1,447 @@
+/*
+Headless benchmark for TdAssimp, cooks the sop outside of TouchDesigner against the mocks in Benchmark_Mocks.h and
+reports the per stage timings of the Info CHOP, throughput and peak memory as JSON.
+
+Build (linux, with the system assimp, from the repository root):
+
+	g++ -std=c++17 -O2 -pthread -I. -IBenchmark/Linux -IDependancies/MIKKTSPACE -IDependancies/MIKKTWELD \
+		Benchmark/Benchmark.cpp -lassimp -o tdassimp_benchmark
+
+Usage:
+
+	tdassimp_benchmark [options] [files or directories ...] > results.json
+
+	--preset NAME       run only this parameter preset, can be repeated. default is every preset.
+	--set NAME=VALUE    sets a parameter in every preset, ie. --set Lodlevels=3. menus take the item name or index.
+	--cooks N           cold cooks per run, each one re-imports the file (default 5).
+	--warm N            warm cooks per run, the import is cached and only the output stages run (default 5).
+	--synthetic TRIS    adds a synthetic sphere with about TRIS triangles, can be repeated.
+	--asset SPEC        adds a synthetic asset, ie. tris=1000000,meshes=8,instances=4,colors=1,anim=1,format=gltf2.
+	                    see parse_synthetic_asset() in Benchmark_Assets.h for the keys. can be repeated.
+	--assets MAXTRIS    adds the standard asset matrix from 1k triangles up to MAXTRIS, see synthetic_asset_matrix().
+	--asset-dir DIR     where synthetic assets are written and reused from (default the temp directory).
+	--output FILE       writes the JSON to FILE instead of stdout.
+	--regression FILE   runs the regression matrix instead (see Benchmark_Regression.h) and compares it to the baseline
+	                    FILE, usually Benchmark/regression_baseline.json. exits with 1 on any regression, against a
+	                    baseline without scenarios only on failed cooks.
+	--update-baseline   with --regression, writes the results to the baseline FILE instead of comparing.
+
+Every stage is reported as min / median / max over the cooks. peak_rss_mb is the peak resident memory of the process
+during the run (on linux the peak is reset before every run, elsewhere it's the peak so far).
+*/
+
+#include "Benchmark_Mocks.h"
+#include "TdAssimp.cpp"
+#include "Benchmark_Corpus.h"
+#include "Benchmark_Assets.h"
+#include "Benchmark_Regression.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+#ifdef _WIN32
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+// parameter presets, on top of the defaults of setupParameters(). menus are set by index.
+struct BenchmarkPreset {
+	const char* name;
+	std::vector<std::pair<const char*, double>> parameters;
+};
+
+static const std::vector<BenchmarkPreset> benchmarkPresets = {
+	{ "touchdesigner", {} },
+	{ "touchdesigner_mikktspace", { { "Tangentalgorithm", 1 } } },
+	{ "filament", { { "Attributestyle", 1 } } },
+	{ "filament_mikktspace", { { "Attributestyle", 1 }, { "Tangentalgorithm", 1 } } },
+	{ "lods", { { "Lodlevels", 4 }, { "Overdrawordering", 1 }, { "Meshlets", 1 } } },
+	{ "instanced", { { "Instancedoutput", 1 } } },
+	{ "animation", { { "Playanimation", 1 } } },
+};
+
+// peak resident memory of the process in bytes.
+size_t peak_rss_bytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+#elif defined(__APPLE__)
+	struct rusage usage;
+	return getrusage(RUSAGE_SELF, &usage) == 0 ? (size_t)usage.ru_maxrss : 0; // bytes on macOS.
+#else
+	// VmHWM follows the reset below, ru_maxrss doesn't.
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line)) {
+		if (line.compare(0, 6, "VmHWM:") == 0) {
+			return (size_t)std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+		}
+	}
+	struct rusage usage;
+	return getrusage(RUSAGE_SELF, &usage) == 0 ? (size_t)usage.ru_maxrss * 1024 : 0;
+#endif
+}
+
+// starts a new peak, where the OS allows it.
+void reset_peak_rss() {
+#if !defined(_WIN32) && !defined(__APPLE__)
+	std::ofstream clearRefs("/proc/self/clear_refs");
+	clearRefs << "5";
+#endif
+}
+
+std::string json_string(const std::string& value) {
+	std::string escaped = "\"";
+	for (char c : value) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+			escaped += c;
+		}
+		else if ((unsigned char)c < 0x20) {
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", c);
+			escaped += code;
+		}
+		else {
+			escaped += c;
+		}
+	}
+	return escaped + "\"";
+}
+
+// the cook channels of the Info CHOP after a cook, by name.
+std::map<std::string, float> cook_channels(TdAssimp& sop) {
+	std::map<std::string, float> channels;
+	MockString name;
+	OP_InfoCHOPChan chan;
+	chan.name = &name;
+	for (int32_t i = 0; i < numCookChannels; i++) {
+		sop.getInfoCHOPChan(i, &chan, nullptr);
+		channels[name.value] = chan.value;
+	}
+	return channels;
+}
+
+// cooks the sop once like TD would, returns the error of the cook if there was one.
+std::string cook(TdAssimp& sop, MockInputs& inputs, MockSOPOutput& output, MockVBOOutput& vboOutput) {
+	SOP_GeneralInfo info;
+	info.cookEveryFrame = false;
+	info.cookEveryFrameIfAsked = false;
+	info.directToGPU = false;
+	sop.getGeneralInfo(&info, &inputs, nullptr);
+
+	output.clear();
+	if (info.directToGPU) {
+		sop.executeVBO(&vboOutput, &inputs, nullptr);
+	}
+	else {
+		sop.execute(&output, &inputs, nullptr);
+	}
+
+	MockString error;
+	sop.getErrorString(&error, nullptr);
+	return error.value;
+}
+
+// min, median and max of every cook channel over a set of cooks, as a JSON object.
+std::string cook_statistics(const std::vector<std::map<std::string, float>>& cooks, double& medianCookMs) {
+	std::string json = "{";
+	for (int32_t i = 0; i < NumCookStages; i++) {
+		std::vector<float> values;
+		for (const auto& channels : cooks) {
+			values.push_back(channels.at(cookStageChannels[i]));
+		}
+		std::sort(values.begin(), values.end());
+		float median = values.empty() ? 0.0f : values[values.size() / 2];
+		if (i == StageCook) {
+			medianCookMs = median;
+		}
+
+		char stage[256];
+		snprintf(stage, sizeof(stage), "%s\"%s\": { \"min\": %.4f, \"median\": %.4f, \"max\": %.4f }", i ? ", " : "",
+			cookStageChannels[i], values.empty() ? 0.0f : values.front(), median, values.empty() ? 0.0f : values.back());
+		json += stage;
+	}
+	return json + "}";
+}
+
+// checksums of the geometry of the last cook, for the regression runs.
+void output_checksums(const MockSOPOutput& output, std::map<std::string, std::string>& checksums) {
+	checksums["positions"] = checksum_string(checksum_floats(&output.positions.data()->x, output.positions.size() * 3));
+	checksums["indices"] = checksum_string(checksum_indices(output.triangles.data(), output.triangles.size()));
+
+	// "T" for the touchdesigner style, "mesh_tangents" for filament.
+	uint64_t tangents = checksum_floats(nullptr, 0);
+	for (const char* name : { "T", "mesh_tangents" }) {
+		auto found = output.customAttributes.find(name);
+		if (found != output.customAttributes.end()) {
+			tangents = checksum_floats(found->second.data(), found->second.size(), tangents);
+		}
+	}
+	checksums["tangents"] = checksum_string(tangents);
+}
+
+// runs one file with one preset, as a JSON object. fills regression with the compared metrics if given.
+std::string run_benchmark(const std::string& file, const BenchmarkPreset& preset, const std::vector<std::pair<std::string, std::string>>& overrides,
+	int coldCooks, int warmCooks, RegressionResult* regression = nullptr) {
+
+	OP_NodeInfo nodeInfo = OP_NodeInfo();
+	nodeInfo.opPath = "/benchmark/tdassimp";
+	nodeInfo.pluginPath = "";
+	TdAssimp* sop = new TdAssimp(&nodeInfo);
+
+	MockParameters parameters;
+	sop->setupParameters(&parameters, nullptr);
+
+	MockInputs inputs;
+	inputs.reset(parameters);
+	for (const auto& parameter : preset.parameters) {
+		inputs.set(parameter.first, parameter.second);
+	}
+	for (const auto& parameter : overrides) {
+		char* end = nullptr;
+		double value = std::strtod(parameter.second.c_str(), &end);
+		if (!(end && *end == 0 && !parameter.second.empty() && inputs.set(parameter.first, value)) && !inputs.setString(parameter.first, parameter.second)) {
+			fprintf(stderr, "unknown parameter or value: %s=%s\n", parameter.first.c_str(), parameter.second.c_str());
+		}
+	}
+	inputs.setString("File", file);
+
+	MockSOPOutput output;
+	MockVBOOutput vboOutput;
+	std::string error;
+	reset_peak_rss();
+
+	// cold cooks import the file every time, warm cooks reuse the cached import like a cook from a parameter change.
+	std::vector<std::map<std::string, float>> cold;
+	std::vector<std::map<std::string, float>> warm;
+	for (int c = 0; c < coldCooks && error.empty(); c++) {
+		sop->pulsePressed("Reload", nullptr);
+		error = cook(*sop, inputs, output, vboOutput);
+		cold.push_back(cook_channels(*sop));
+	}
+	for (int c = 0; c < warmCooks && error.empty(); c++) {
+		error = cook(*sop, inputs, output, vboOutput);
+		warm.push_back(cook_channels(*sop));
+	}
+	size_t peakRss = peak_rss_bytes();
+
+	std::map<std::string, float> last = warm.empty() ? (cold.empty() ? std::map<std::string, float>() : cold.back()) : warm.back();
+	double vertices = last.count("vertices") ? last["vertices"] : 0;
+	double triangles = last.count("triangles") ? last["triangles"] : 0;
+	double bytes = last.count("bytes_emitted") ? last["bytes_emitted"] : 0;
+
+	double coldMs = 0;
+	double warmMs = 0;
+	std::string coldJson = cook_statistics(cold, coldMs);
+	std::string warmJson = cook_statistics(warm, warmMs);
+
+	char summary[512];
+	snprintf(summary, sizeof(summary),
+		"\"vertices\": %.0f, \"triangles\": %.0f, \"bytes_emitted\": %.0f, "
+		"\"cold_mvert_per_s\": %.3f, \"warm_mvert_per_s\": %.3f, \"peak_rss_mb\": %.2f",
+		vertices, triangles, bytes,
+		coldMs > 0 ? vertices / coldMs / 1000 : 0.0, warmMs > 0 ? vertices / warmMs / 1000 : 0.0,
+		peakRss / (1024.0 * 1024.0));
+
+	std::string json = "{ \"file\": " + json_string(file) + ", \"preset\": " + json_string(preset.name)
+		+ ", \"error\": " + json_string(error) + ", " + summary
+		+ ", \"cold\": { \"cooks\": " + std::to_string(cold.size()) + ", \"stages_ms\": " + coldJson + " }"
+		+ ", \"warm\": { \"cooks\": " + std::to_string(warm.size()) + ", \"stages_ms\": " + warmJson + " } }";
+
+	if (regression) {
+		regression->error = error;
+		regression->metrics["vertices"] = vertices;
+		regression->metrics["triangles"] = triangles;
+		regression->metrics["cold_cook_ms"] = coldMs;
+		regression->metrics["warm_cook_ms"] = warmMs;
+		regression->metrics["peak_rss_mb"] = peakRss / (1024.0 * 1024.0);
+		output_checksums(output, regression->checksums);
+	}
+
+	delete sop;
+	return json;
+}
+
+// cooks the regression matrix, then compares it to the baseline or replaces the baseline. returns the exit code.
+int run_regression(const std::string& baselineFile, bool updateBaseline, const std::string& assetDirectory, int coldCooks, int warmCooks,
+	const std::string& outputFile) {
+
+	JsonValue baseline;
+	if (!read_json_file(baselineFile, baseline) && !updateBaseline) {
+		fprintf(stderr, "couldn't read the baseline %s\n", baselineFile.c_str());
+		return 1;
+	}
+
+	std::cout.rdbuf(nullptr);
+
+	std::vector<RegressionResult> results;
+	std::string json = "{ \"runs\": [\n";
+	for (const RegressionScenario& scenario : regression_scenarios()) {
+		RegressionResult result;
+		result.name = scenario.name;
+		std::string file = write_synthetic_asset(scenario.asset, assetDirectory, result.error);
+		if (!file.empty()) {
+			fprintf(stderr, "%s\n", scenario.name.c_str());
+			BenchmarkPreset preset = { scenario.name.c_str(), scenario.parameters };
+			json += (results.empty() ? "\t" : ",\n\t") + run_benchmark(file, preset, {}, coldCooks, warmCooks, &result);
+		}
+		results.push_back(result);
+	}
+	json += "\n] }\n";
+
+	if (!outputFile.empty()) {
+		std::ofstream(outputFile) << json;
+	}
+
+	if (updateBaseline) {
+		std::ofstream out(baselineFile);
+		out << regression_baseline_json(baseline, results);
+		if (!out) {
+			fprintf(stderr, "couldn't write the baseline %s\n", baselineFile.c_str());
+			return 1;
+		}
+		fprintf(stderr, "wrote %zu scenarios to %s\n", results.size(), baselineFile.c_str());
+		return 0;
+	}
+
+	std::string report;
+	int regressions = compare_regression(baseline, results, report);
+	fputs(report.c_str(), stderr);
+	fprintf(stderr, "%zu scenarios, %d regressions\n", results.size(), regressions);
+	return regressions ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+	std::vector<std::string> paths;
+	std::vector<std::string> presetNames;
+	std::vector<std::pair<std::string, std::string>> overrides;
+	std::vector<SyntheticAsset> synthetic;
+	std::string assetDirectory = std::filesystem::temp_directory_path().string();
+	int coldCooks = 5;
+	int warmCooks = 5;
+	std::string outputFile;
+	std::string baselineFile;
+	bool updateBaseline = false;
+
+	for (int a = 1; a < argc; a++) {
+		std::string arg = argv[a];
+		bool hasValue = a + 1 < argc;
+		if (arg == "--preset" && hasValue) {
+			presetNames.push_back(argv[++a]);
+		}
+		else if (arg == "--set" && hasValue) {
+			std::string assignment = argv[++a];
+			size_t equals = assignment.find('=');
+			if (equals == std::string::npos) {
+				fprintf(stderr, "--set expects NAME=VALUE, got %s\n", assignment.c_str());
+				return 1;
+			}
+			overrides.push_back({ assignment.substr(0, equals), assignment.substr(equals + 1) });
+		}
+		else if (arg == "--cooks" && hasValue) {
+			coldCooks = std::max(0, atoi(argv[++a]));
+		}
+		else if (arg == "--warm" && hasValue) {
+			warmCooks = std::max(0, atoi(argv[++a]));
+		}
+		else if (arg == "--synthetic" && hasValue) {
+			SyntheticAsset asset;
+			asset.triangles = std::max<int64_t>(1, atoll(argv[++a]));
+			synthetic.push_back(asset);
+		}
+		else if (arg == "--asset" && hasValue) {
+			SyntheticAsset asset;
+			std::string error;
+			if (!parse_synthetic_asset(argv[++a], asset, error)) {
+				fprintf(stderr, "--asset %s: %s\n", argv[a], error.c_str());
+				return 1;
+			}
+			synthetic.push_back(asset);
+		}
+		else if (arg == "--assets" && hasValue) {
+			std::vector<SyntheticAsset> matrix = synthetic_asset_matrix(atoll(argv[++a]));
+			synthetic.insert(synthetic.end(), matrix.begin(), matrix.end());
+		}
+		else if (arg == "--asset-dir" && hasValue) {
+			assetDirectory = argv[++a];
+		}
+		else if (arg == "--output" && hasValue) {
+			outputFile = argv[++a];
+		}
+		else if (arg == "--regression" && hasValue) {
+			baselineFile = argv[++a];
+		}
+		else if (arg == "--update-baseline") {
+			updateBaseline = true;
+		}
+		else if (arg.compare(0, 2, "--") == 0) {
+			fprintf(stderr, "unknown option %s, see the top of Benchmark.cpp for the usage.\n", arg.c_str());
+			return 1;
+		}
+		else {
+			paths.push_back(arg);
+		}
+	}
+
+	if (!baselineFile.empty()) {
+		return run_regression(baselineFile, updateBaseline, assetDirectory, coldCooks, warmCooks, outputFile);
+	}
+
+	std::vector<const BenchmarkPreset*> presets;
+	for (const BenchmarkPreset& preset : benchmarkPresets) {
+		if (presetNames.empty() || std::find(presetNames.begin(), presetNames.end(), preset.name) != presetNames.end()) {
+			presets.push_back(&preset);
+		}
+	}
+	if (presets.empty()) {
+		fprintf(stderr, "no preset matches, the presets are:");
+		for (const BenchmarkPreset& preset : benchmarkPresets) {
+			fprintf(stderr, " %s", preset.name);
+		}
+		fprintf(stderr, "\n");
+		return 1;
+	}
+
+	std::vector<std::string> files = collect_corpus(paths);
+	for (const SyntheticAsset& asset : synthetic) {
+		std::string error;
+		std::string file = write_synthetic_asset(asset, assetDirectory, error);
+		if (file.empty()) {
+			fprintf(stderr, "couldn't write %s to %s: %s\n", synthetic_asset_name(asset).c_str(), assetDirectory.c_str(), error.c_str());
+			return 1;
+		}
+		files.push_back(file);
+	}
+	if (files.empty()) {
+		fprintf(stderr, "nothing to benchmark, pass files, directories, --synthetic or --asset.\n");
+		return 1;
+	}
+
+	// execute() prints to std::cout every cook, the JSON goes through stdio so it stays clean.
+	std::cout.rdbuf(nullptr);
+
+	std::string json = "{ \"runs\": [\n";
+	bool first = true;
+	for (const std::string& file : files) {
+		for (const BenchmarkPreset* preset : presets) {
+			fprintf(stderr, "%s, %s\n", file.c_str(), preset->name);
+			json += (first ? "\t" : ",\n\t") + run_benchmark(file, *preset, overrides, coldCooks, warmCooks);
+			first = false;
+		}
+	}
+	json += "\n] }\n";
+
+	FILE* out = outputFile.empty() ? stdout : fopen(outputFile.c_str(), "w");
+	if (!out) {
+		fprintf(stderr, "couldn't write %s\n", outputFile.c_str());
+		return 1;
+	}
+	fputs(json.c_str(), out);
+	if (out != stdout) {
+		fclose(out);
+	}
+	return 0;
+}
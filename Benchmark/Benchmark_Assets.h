@@ -0,0 +1,409 @@
+#pragma once
+
+#include <assimp/Exporter.hpp>
+#include <assimp/StandardShapes.h>
+#include <assimp/Subdivision.h>
+#include <assimp/scene.h>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <filesystem>
+#include <cstring>
+#include <cmath>
+
+/*
+Synthetic assets for the benchmark, so the timings don't depend on which production files happen to be around.
+
+Every mesh is an assimp StandardShapes sphere, or a cube rounded off by catmull-clark subdivision (every other mesh),
+subdivided to get as close to the requested triangle count as the shapes allow (x4 per level). the corners are welded
+into an indexed mesh with smooth normals, and the optional attributes (uvs, colors, tangents) are derived from the
+position, so the same spec always writes the same file. with instances, every mesh is referenced by several nodes, and
+with animation every node gets a rotation / translation track.
+
+The scene is written with the assimp exporter, so any format it can export works (obj, ply, gltf2, glb2, fbxa ...).
+*/
+
+struct SyntheticAsset {
+	int64_t triangles = 100000; // over all the meshes, without instancing.
+	int meshes = 1;
+	int instances = 1; // nodes referencing each mesh.
+	bool uvs = true;
+	bool colors = false;
+	bool tangents = false;
+	bool animated = false;
+	std::string format = "obj"; // assimp exporter id.
+};
+
+// triangles of a shape at a subdivision level. assimp's sphere starts from an icosahedron (20 triangles, the
+// "octahedron" in the MakeSphere doc comment is outdated), the cube from 6 quads that are triangulated in the end.
+// write_synthetic_asset checks this against the meshes it built.
+inline int64_t synthetic_shape_triangles(bool cube, int level) {
+	return (cube ? 12 : 20) * ((int64_t)1 << (2 * level));
+}
+
+// the subdivision level of a shape closest to the wanted triangles.
+inline int synthetic_shape_level(bool cube, int64_t triangles) {
+	int best = 0;
+	for (int level = 1; level <= 13; level++) {
+		if (std::llabs(synthetic_shape_triangles(cube, level) - triangles) < std::llabs(synthetic_shape_triangles(cube, best) - triangles)) {
+			best = level;
+		}
+	}
+	return best;
+}
+
+// triangles the asset actually ends up with.
+inline int64_t synthetic_asset_triangles(const SyntheticAsset& asset) {
+	int64_t total = 0;
+	for (int m = 0; m < asset.meshes; m++) {
+		bool cube = m % 2 == 1;
+		total += synthetic_shape_triangles(cube, synthetic_shape_level(cube, asset.triangles / asset.meshes));
+	}
+	return total;
+}
+
+// file extension of an exporter id, empty if assimp can't export it.
+std::string synthetic_asset_extension(const std::string& format) {
+	Assimp::Exporter exporter;
+	for (size_t i = 0; i < exporter.GetExportFormatCount(); i++) {
+		const aiExportFormatDesc* description = exporter.GetExportFormatDescription(i);
+		if (format == description->id) {
+			return description->fileExtension;
+		}
+	}
+	return "";
+}
+
+// file name with everything in the spec, so an asset that was already written can be reused.
+std::string synthetic_asset_name(const SyntheticAsset& asset) {
+	return "tdassimp_" + std::to_string(synthetic_asset_triangles(asset)) + "tris_" + std::to_string(asset.meshes) + "x"
+		+ std::to_string(asset.instances) + (asset.uvs ? "_uv" : "") + (asset.colors ? "_cd" : "") + (asset.tangents ? "_t" : "")
+		+ (asset.animated ? "_anim" : "") + "_" + asset.format + "." + synthetic_asset_extension(asset.format);
+}
+
+// parses a comma separated spec, ie. "tris=1000000,meshes=8,instances=4,uvs=1,colors=0,tangents=1,anim=1,format=gltf2".
+// keys that are left out keep their defaults.
+bool parse_synthetic_asset(const std::string& spec, SyntheticAsset& asset, std::string& error) {
+	size_t start = 0;
+	while (start < spec.size()) {
+		size_t end = spec.find(',', start);
+		end = end == std::string::npos ? spec.size() : end;
+		std::string field = spec.substr(start, end - start);
+		start = end + 1;
+
+		size_t equals = field.find('=');
+		if (equals == std::string::npos) {
+			error = "expected key=value, got " + field;
+			return false;
+		}
+		std::string key = field.substr(0, equals);
+		std::string value = field.substr(equals + 1);
+		long long number = atoll(value.c_str());
+
+		if (key == "tris") asset.triangles = std::max(1LL, number);
+		else if (key == "meshes") asset.meshes = (int)std::max(1LL, number);
+		else if (key == "instances") asset.instances = (int)std::max(1LL, number);
+		else if (key == "uvs") asset.uvs = number != 0;
+		else if (key == "colors") asset.colors = number != 0;
+		else if (key == "tangents") asset.tangents = number != 0;
+		else if (key == "anim") asset.animated = number != 0;
+		else if (key == "format") asset.format = value;
+		else {
+			error = "unknown asset key " + key;
+			return false;
+		}
+	}
+	if (synthetic_asset_extension(asset.format).empty()) {
+		error = "assimp can't export " + asset.format;
+		return false;
+	}
+	return true;
+}
+
+// the standard set: every triangle count from 1k up to maxTriangles (x10 per step), each in a few variants that
+// between them go through every conversion branch of execute(): plain, uvs and colors, many meshes, instancing with
+// tangents, and node animation. the variants use different formats, so the importers get some coverage too.
+std::vector<SyntheticAsset> synthetic_asset_matrix(int64_t maxTriangles) {
+	std::vector<SyntheticAsset> assets;
+	for (int64_t triangles = 1000; triangles <= maxTriangles; triangles *= 10) {
+		SyntheticAsset plain;
+		plain.triangles = triangles;
+		plain.uvs = false;
+		plain.format = "obj";
+		assets.push_back(plain);
+
+		SyntheticAsset colored;
+		colored.triangles = triangles;
+		colored.colors = true;
+		colored.format = "ply";
+		assets.push_back(colored);
+
+		SyntheticAsset many;
+		many.triangles = triangles;
+		many.meshes = 16;
+		many.format = "gltf2";
+		assets.push_back(many);
+
+		SyntheticAsset instanced;
+		instanced.triangles = triangles;
+		instanced.meshes = 4;
+		instanced.instances = 16;
+		instanced.tangents = true;
+		instanced.format = "fbxa";
+		assets.push_back(instanced);
+
+		SyntheticAsset animated;
+		animated.triangles = triangles;
+		animated.meshes = 4;
+		animated.instances = 4;
+		animated.animated = true;
+		animated.format = "gltf2";
+		assets.push_back(animated);
+	}
+	return assets;
+}
+
+// welds the corners of a verbose (one vertex per corner) mesh of triangles or quads into an indexed triangle mesh,
+// with area weighted smooth normals. the source mesh is deleted.
+aiMesh* synthetic_weld(aiMesh* source) {
+	struct PositionHash {
+		size_t operator()(const aiVector3D& p) const {
+			uint32_t bits[3];
+			memcpy(bits, &p.x, sizeof(bits));
+			return ((size_t)bits[0] * 73856093) ^ ((size_t)bits[1] * 19349663) ^ ((size_t)bits[2] * 83492791);
+		}
+	};
+
+	std::unordered_map<aiVector3D, unsigned int, PositionHash> welded;
+	welded.reserve(source->mNumVertices / 2);
+	std::vector<aiVector3D> positions;
+	std::vector<unsigned int> remap(source->mNumVertices);
+	for (unsigned int v = 0; v < source->mNumVertices; v++) {
+		auto found = welded.insert({ source->mVertices[v], (unsigned int)positions.size() });
+		if (found.second) {
+			positions.push_back(source->mVertices[v]);
+		}
+		remap[v] = found.first->second;
+	}
+
+	std::vector<unsigned int> indices;
+	for (unsigned int f = 0; f < source->mNumFaces; f++) {
+		const aiFace& face = source->mFaces[f];
+		for (unsigned int corner = 1; corner + 1 < face.mNumIndices; corner++) {
+			indices.push_back(remap[face.mIndices[0]]);
+			indices.push_back(remap[face.mIndices[corner]]);
+			indices.push_back(remap[face.mIndices[corner + 1]]);
+		}
+	}
+	delete source;
+
+	aiMesh* mesh = new aiMesh();
+	mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+	mesh->mNumVertices = (unsigned int)positions.size();
+	mesh->mVertices = new aiVector3D[positions.size()];
+	mesh->mNormals = new aiVector3D[positions.size()];
+	std::copy(positions.begin(), positions.end(), mesh->mVertices);
+	std::fill(mesh->mNormals, mesh->mNormals + positions.size(), aiVector3D(0, 0, 0));
+
+	mesh->mNumFaces = (unsigned int)(indices.size() / 3);
+	mesh->mFaces = new aiFace[mesh->mNumFaces];
+	for (unsigned int f = 0; f < mesh->mNumFaces; f++) {
+		aiFace& face = mesh->mFaces[f];
+		face.mNumIndices = 3;
+		face.mIndices = new unsigned int[3] { indices[f * 3], indices[f * 3 + 1], indices[f * 3 + 2] };
+
+		// the cross product is twice the area, so bigger triangles weigh more.
+		const aiVector3D& a = positions[face.mIndices[0]];
+		aiVector3D normal = (positions[face.mIndices[1]] - a) ^ (positions[face.mIndices[2]] - a);
+		for (int corner = 0; corner < 3; corner++) {
+			mesh->mNormals[face.mIndices[corner]] += normal;
+		}
+	}
+	for (unsigned int v = 0; v < mesh->mNumVertices; v++) {
+		mesh->mNormals[v].NormalizeSafe();
+	}
+	return mesh;
+}
+
+// one mesh of the asset. spheres on even meshes, rounded cubes on odd ones.
+aiMesh* synthetic_mesh(const SyntheticAsset& asset, int index) {
+	bool cube = index % 2 == 1;
+	int level = synthetic_shape_level(cube, asset.triangles / asset.meshes);
+
+	aiMesh* verbose = nullptr;
+	if (cube) {
+		std::vector<aiVector3D> positions;
+		unsigned int corners = Assimp::StandardShapes::MakeHexahedron(positions, true);
+		aiMesh* box = Assimp::StandardShapes::MakeMesh(positions, corners);
+		if (level > 0) {
+			Assimp::Subdivider* subdivider = Assimp::Subdivider::Create(Assimp::Subdivider::CATMULL_CLARKE);
+			subdivider->Subdivide(box, verbose, level, true);
+			delete subdivider;
+		}
+		else {
+			verbose = box;
+		}
+	}
+	else {
+		std::vector<aiVector3D> positions;
+		Assimp::StandardShapes::MakeSphere(level, positions);
+		verbose = Assimp::StandardShapes::MakeMesh(positions, 3);
+	}
+
+	aiMesh* mesh = synthetic_weld(verbose);
+	mesh->mName.Set("mesh" + std::to_string(index));
+	mesh->mMaterialIndex = 0;
+
+	// spherical mapping around the origin, the tangent follows u.
+	const float pi = 3.14159265358979f;
+	if (asset.uvs) {
+		mesh->mNumUVComponents[0] = 2;
+		mesh->mTextureCoords[0] = new aiVector3D[mesh->mNumVertices];
+	}
+	if (asset.colors) {
+		mesh->mColors[0] = new aiColor4D[mesh->mNumVertices];
+	}
+	if (asset.tangents) {
+		mesh->mTangents = new aiVector3D[mesh->mNumVertices];
+		mesh->mBitangents = new aiVector3D[mesh->mNumVertices];
+	}
+	for (unsigned int v = 0; v < mesh->mNumVertices; v++) {
+		aiVector3D p = mesh->mVertices[v];
+		aiVector3D direction = p;
+		direction.NormalizeSafe();
+
+		if (asset.uvs) {
+			float u = 0.5f + std::atan2(direction.z, direction.x) / (2 * pi);
+			float w = std::acos(std::min(std::max(direction.y, -1.0f), 1.0f)) / pi;
+			mesh->mTextureCoords[0][v] = aiVector3D(u, 1 - w, 0);
+		}
+		if (asset.colors) {
+			mesh->mColors[0][v] = aiColor4D(0.5f + 0.5f * direction.x, 0.5f + 0.5f * direction.y, 0.5f + 0.5f * direction.z, 1);
+		}
+		if (asset.tangents) {
+			const aiVector3D& normal = mesh->mNormals[v];
+			aiVector3D tangent(-direction.z, 0, direction.x);
+			if (tangent.SquareLength() < 1e-12f) {
+				tangent = aiVector3D(1, 0, 0); // at the poles.
+			}
+			tangent = (tangent - normal * (normal * tangent)).NormalizeSafe();
+			mesh->mTangents[v] = tangent;
+			mesh->mBitangents[v] = normal ^ tangent;
+		}
+	}
+	return mesh;
+}
+
+// builds the whole scene. meshes are laid out in a row, their instances in a grid behind them.
+aiScene* build_synthetic_scene(const SyntheticAsset& asset) {
+	aiScene* scene = new aiScene();
+
+	scene->mNumMaterials = 1;
+	scene->mMaterials = new aiMaterial*[1];
+	scene->mMaterials[0] = new aiMaterial();
+	aiString materialName("synthetic");
+	scene->mMaterials[0]->AddProperty(&materialName, AI_MATKEY_NAME);
+
+	scene->mNumMeshes = asset.meshes;
+	scene->mMeshes = new aiMesh*[asset.meshes];
+	for (int m = 0; m < asset.meshes; m++) {
+		scene->mMeshes[m] = synthetic_mesh(asset, m);
+	}
+
+	aiNode* root = new aiNode("root");
+	scene->mRootNode = root;
+	root->mNumChildren = asset.meshes * asset.instances;
+	root->mChildren = new aiNode*[root->mNumChildren];
+
+	int side = std::max(1, (int)std::ceil(std::sqrt((double)asset.instances)));
+	for (int m = 0; m < asset.meshes; m++) {
+		for (int i = 0; i < asset.instances; i++) {
+			aiNode* node = new aiNode("mesh" + std::to_string(m) + "_instance" + std::to_string(i));
+			node->mParent = root;
+			node->mNumMeshes = 1;
+			node->mMeshes = new unsigned int[1] { (unsigned int)m };
+
+			// spread out, turned and scaled a little differently, deterministic.
+			aiMatrix4x4 translation, rotation, scale;
+			aiMatrix4x4::Translation(aiVector3D(m * 3.0f, (float)(i / side) * 3.0f, (float)(i % side) * 3.0f), translation);
+			aiMatrix4x4::RotationY(0.4f * i + 0.7f * m, rotation);
+			aiMatrix4x4::Scaling(aiVector3D(1.0f + 0.05f * (i % 5)), scale);
+			node->mTransformation = translation * rotation * scale;
+			root->mChildren[m * asset.instances + i] = node;
+		}
+	}
+
+	// every node spins once around y and bobs up and down, 2 seconds at 25 ticks per second.
+	if (asset.animated) {
+		aiAnimation* animation = new aiAnimation();
+		animation->mName.Set("spin");
+		animation->mTicksPerSecond = 25;
+		animation->mDuration = 50;
+		animation->mNumChannels = root->mNumChildren;
+		animation->mChannels = new aiNodeAnim*[root->mNumChildren];
+
+		const float pi = 3.14159265358979f;
+		const int numKeys = 9;
+		for (unsigned int n = 0; n < root->mNumChildren; n++) {
+			aiNode* node = root->mChildren[n];
+			aiVector3D scaling, position;
+			aiQuaternion rotation;
+			node->mTransformation.Decompose(scaling, rotation, position);
+
+			aiNodeAnim* channel = new aiNodeAnim();
+			channel->mNodeName = node->mName;
+			channel->mNumPositionKeys = channel->mNumRotationKeys = channel->mNumScalingKeys = numKeys;
+			channel->mPositionKeys = new aiVectorKey[numKeys];
+			channel->mRotationKeys = new aiQuatKey[numKeys];
+			channel->mScalingKeys = new aiVectorKey[numKeys];
+			for (int k = 0; k < numKeys; k++) {
+				double time = animation->mDuration * k / (numKeys - 1);
+				float angle = 2 * pi * k / (numKeys - 1);
+				channel->mPositionKeys[k] = aiVectorKey(time, position + aiVector3D(0, 0.5f * std::sin(angle), 0));
+				channel->mRotationKeys[k] = aiQuatKey(time, aiQuaternion(aiVector3D(0, 1, 0), angle) * rotation);
+				channel->mScalingKeys[k] = aiVectorKey(time, scaling);
+			}
+			animation->mChannels[n] = channel;
+		}
+
+		scene->mNumAnimations = 1;
+		scene->mAnimations = new aiAnimation*[1] { animation };
+	}
+	return scene;
+}
+
+// writes the asset to directory, unless a file of the same spec is already there. returns the file, or empty with error set.
+std::string write_synthetic_asset(const SyntheticAsset& asset, const std::string& directory, std::string& error) {
+	std::string file = (std::filesystem::path(directory) / synthetic_asset_name(asset)).string();
+	std::error_code exists;
+	if (std::filesystem::exists(file, exists)) {
+		return file;
+	}
+
+	aiScene* scene = build_synthetic_scene(asset);
+
+	// the file name, the level choice and the regression sizes all go by synthetic_asset_triangles.
+	int64_t built = 0;
+	for (unsigned int m = 0; m < scene->mNumMeshes; m++) {
+		built += scene->mMeshes[m]->mNumFaces;
+	}
+	if (built != synthetic_asset_triangles(asset)) {
+		error = "synthetic asset has " + std::to_string(built) + " triangles, expected " + std::to_string(synthetic_asset_triangles(asset));
+		delete scene;
+		return "";
+	}
+
+	Assimp::Exporter exporter;
+	aiReturn result = exporter.Export(scene, asset.format, file);
+	delete scene;
+
+	if (result != aiReturn_SUCCESS) {
+		error = exporter.GetErrorString();
+		std::filesystem::remove(file, exists);
+		return "";
+	}
+	return file;
+}
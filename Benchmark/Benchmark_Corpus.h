@@ -0,0 +1,37 @@
+#pragma once
+
+#include <assimp/Importer.hpp>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+
+/*
+The files a benchmark runs on: files given on the command line and every file assimp can read in the given directories.
+synthetic assets are in Benchmark_Assets.h.
+*/
+
+// expands directories (recursively) into the files assimp can import, sorted so runs are comparable. files are kept as is.
+std::vector<std::string> collect_corpus(const std::vector<std::string>& paths) {
+	Assimp::Importer importer;
+	std::vector<std::string> files;
+	for (const std::string& path : paths) {
+		std::error_code error;
+		if (!std::filesystem::is_directory(path, error)) {
+			files.push_back(path);
+			continue;
+		}
+
+		std::vector<std::string> found;
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(path, error)) {
+			if (entry.is_regular_file() && importer.IsExtensionSupported(entry.path().extension().string())) {
+				found.push_back(entry.path().string());
+			}
+		}
+		std::sort(found.begin(), found.end());
+		files.insert(files.end(), found.begin(), found.end());
+	}
+	return files;
+}
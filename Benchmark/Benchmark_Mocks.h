@@ -0,0 +1,516 @@
+#pragma once
+
+/*
+Stand-ins for the parts of TouchDesigner the sop talks to, so TdAssimp can be cooked outside of TD.
+
+MockParameters records what setupParameters() appends, so every parameter starts at the default it has in TD.
+MockInputs serves those values to execute(), and presets override them by name. MockSOPOutput copies everything it's
+handed into its own buffers, like TD does, so the output stage costs roughly what it does in TD.
+*/
+
+// the TD headers are written for windows (__cdecl) and macOS (OpenGL/gltypes.h, strlcpy). Benchmark/Linux has the
+// gltypes.h, these cover the rest.
+#if !defined(_WIN32) && !defined(__APPLE__)
+	#ifndef __cdecl
+		#define __cdecl
+	#endif
+
+	#include <string.h>
+	#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+	static inline size_t strlcpy(char* dst, const char* src, size_t size) {
+		size_t length = strlen(src);
+		if (size > 0) {
+			size_t count = length < size - 1 ? length : size - 1;
+			memcpy(dst, src, count);
+			dst[count] = 0;
+		}
+		return length;
+	}
+	#endif
+#endif
+
+// the TD headers expect these to be included already.
+#include <stdint.h>
+#include <stddef.h>
+
+#include "SOP_CPlusPlusBase.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+
+class MockString : public OP_String {
+public:
+	void setString(const char* val) override {
+		value = val ? val : "";
+	}
+
+	std::string value;
+};
+
+// one parameter, up to 4 values. menus keep their item names, getParInt() is the index of the selected one.
+struct MockParameter {
+	double values[4] = { 0, 0, 0, 0 };
+	std::string string;
+	std::vector<std::string> menu;
+};
+
+class MockParameters : public OP_ParameterManager {
+public:
+	OP_ParAppendResult appendFloat(const OP_NumericParameter& np, int32_t size = 1) override { return numeric(np); }
+	OP_ParAppendResult appendInt(const OP_NumericParameter& np, int32_t size = 1) override { return numeric(np); }
+	OP_ParAppendResult appendXY(const OP_NumericParameter& np) override { return numeric(np); }
+	OP_ParAppendResult appendXYZ(const OP_NumericParameter& np) override { return numeric(np); }
+	OP_ParAppendResult appendUV(const OP_NumericParameter& np) override { return numeric(np); }
+	OP_ParAppendResult appendUVW(const OP_NumericParameter& np) override { return numeric(np); }
+	OP_ParAppendResult appendRGB(const OP_NumericParameter& np) override { return numeric(np); }
+	OP_ParAppendResult appendRGBA(const OP_NumericParameter& np) override { return numeric(np); }
+	OP_ParAppendResult appendToggle(const OP_NumericParameter& np) override { return numeric(np); }
+	OP_ParAppendResult appendPulse(const OP_NumericParameter& np) override { return numeric(np); }
+	OP_ParAppendResult appendMomentary(const OP_NumericParameter& np) override { return numeric(np); }
+	OP_ParAppendResult appendWH(const OP_NumericParameter& np) override { return numeric(np); }
+
+	OP_ParAppendResult appendString(const OP_StringParameter& sp) override { return string(sp); }
+	OP_ParAppendResult appendFile(const OP_StringParameter& sp) override { return string(sp); }
+	OP_ParAppendResult appendFolder(const OP_StringParameter& sp) override { return string(sp); }
+	OP_ParAppendResult appendDAT(const OP_StringParameter& sp) override { return string(sp); }
+	OP_ParAppendResult appendCHOP(const OP_StringParameter& sp) override { return string(sp); }
+	OP_ParAppendResult appendTOP(const OP_StringParameter& sp) override { return string(sp); }
+	OP_ParAppendResult appendObject(const OP_StringParameter& sp) override { return string(sp); }
+	OP_ParAppendResult appendSOP(const OP_StringParameter& sp) override { return string(sp); }
+	OP_ParAppendResult appendPython(const OP_StringParameter& sp) override { return string(sp); }
+	OP_ParAppendResult appendOP(const OP_StringParameter& sp) override { return string(sp); }
+	OP_ParAppendResult appendCOMP(const OP_StringParameter& sp) override { return string(sp); }
+	OP_ParAppendResult appendMAT(const OP_StringParameter& sp) override { return string(sp); }
+	OP_ParAppendResult appendPanelCOMP(const OP_StringParameter& sp) override { return string(sp); }
+	OP_ParAppendResult appendHeader(const OP_StringParameter& sp) override { return string(sp); }
+
+	OP_ParAppendResult appendMenu(const OP_StringParameter& sp, int32_t nitems, const char** names, const char** labels) override {
+		OP_ParAppendResult result = string(sp);
+		if (result == OP_ParAppendResult::Success) {
+			MockParameter& parameter = parameters[sp.name];
+			// some menus pass a fixed size array with null entries after the items.
+			for (int32_t i = 0; i < nitems && names[i]; i++) {
+				parameter.menu.push_back(names[i]);
+			}
+			auto selected = std::find(parameter.menu.begin(), parameter.menu.end(), parameter.string);
+			parameter.values[0] = selected == parameter.menu.end() ? 0 : (double)(selected - parameter.menu.begin());
+		}
+		return result;
+	}
+
+	OP_ParAppendResult appendStringMenu(const OP_StringParameter& sp, int32_t nitems, const char** names, const char** labels) override {
+		return appendMenu(sp, nitems, names, labels);
+	}
+
+	std::map<std::string, MockParameter> parameters;
+
+private:
+	OP_ParAppendResult numeric(const OP_NumericParameter& np) {
+		if (!np.name || parameters.count(np.name)) {
+			return OP_ParAppendResult::InvalidName;
+		}
+		MockParameter& parameter = parameters[np.name];
+		std::copy(np.defaultValues, np.defaultValues + 4, parameter.values);
+		return OP_ParAppendResult::Success;
+	}
+
+	OP_ParAppendResult string(const OP_StringParameter& sp) {
+		if (!sp.name || parameters.count(sp.name)) {
+			return OP_ParAppendResult::InvalidName;
+		}
+		parameters[sp.name].string = sp.defaultValue ? sp.defaultValue : "";
+		return OP_ParAppendResult::Success;
+	}
+};
+
+// a CHOP for the CHOP parameters (Query CHOP, Morph CHOP), channels of equal length.
+class MockCHOP : public OP_CHOPInput {
+public:
+	MockCHOP() {
+		opPath = "/mock/chop";
+		opId = 0;
+		numChannels = 0;
+		numSamples = 0;
+		sampleRate = 60;
+		startIndex = 0;
+		channelData = nullptr;
+		nameData = nullptr;
+		totalCooks = 0;
+	}
+
+	void addChannel(const std::string& name, const std::vector<float>& samples) {
+		myNames.push_back(name);
+		myChannels.push_back(samples);
+		myNamePointers.clear();
+		myChannelPointers.clear();
+		for (size_t c = 0; c < myChannels.size(); c++) {
+			myNamePointers.push_back(myNames[c].c_str());
+			myChannelPointers.push_back(myChannels[c].data());
+		}
+		numChannels = (int32_t)myChannels.size();
+		numSamples = (int32_t)myChannels[0].size();
+		nameData = myNamePointers.data();
+		channelData = myChannelPointers.data();
+	}
+
+private:
+	std::vector<std::string> myNames;
+	std::vector<std::vector<float>> myChannels;
+	std::vector<const char*> myNamePointers;
+	std::vector<const float*> myChannelPointers;
+};
+
+class MockInputs : public OP_Inputs {
+public:
+	MockInputs() {
+		myTimeInfo = OP_TimeInfo();
+		myTimeInfo.rate = myTimeInfo.rootRate = 60;
+		myTimeInfo.deltaFrames = 1;
+		myTimeInfo.deltaMS = 1000.0 / 60;
+	}
+
+	// the parameter defaults, from a MockParameters that setupParameters() was run on.
+	void reset(const MockParameters& manager) {
+		myParameters = manager.parameters;
+		myChops.clear();
+	}
+
+	// sets a numeric parameter, or a menu by index. returns false for a parameter the sop doesn't have.
+	bool set(const std::string& name, double value, int index = 0) {
+		auto found = myParameters.find(name);
+		if (found == myParameters.end() || index < 0 || index > 3) {
+			return false;
+		}
+		found->second.values[index] = value;
+		if (!found->second.menu.empty() && index == 0) {
+			int item = std::min(std::max((int)value, 0), (int)found->second.menu.size() - 1);
+			found->second.string = found->second.menu[item];
+		}
+		return true;
+	}
+
+	// sets a string parameter, or a menu by item name.
+	bool setString(const std::string& name, const std::string& value) {
+		auto found = myParameters.find(name);
+		if (found == myParameters.end()) {
+			return false;
+		}
+		found->second.string = value;
+		if (!found->second.menu.empty()) {
+			auto selected = std::find(found->second.menu.begin(), found->second.menu.end(), value);
+			if (selected == found->second.menu.end()) {
+				return false;
+			}
+			found->second.values[0] = (double)(selected - found->second.menu.begin());
+		}
+		return true;
+	}
+
+	// the CHOP a CHOP parameter points at.
+	void setCHOP(const std::string& name, const MockCHOP* chop) {
+		myChops[name] = chop;
+	}
+
+	int32_t getNumInputs() const override { return 0; }
+	const OP_TOPInput* getInputTOP(int32_t index) const override { return nullptr; }
+	const OP_CHOPInput* getInputCHOP(int32_t index) const override { return nullptr; }
+	const OP_DATInput* getParDAT(const char* name) const override { return nullptr; }
+	const OP_TOPInput* getParTOP(const char* name) const override { return nullptr; }
+	const OP_ObjectInput* getParObject(const char* name) const override { return nullptr; }
+
+	const OP_CHOPInput* getParCHOP(const char* name) const override {
+		auto found = myChops.find(name);
+		return found == myChops.end() ? nullptr : found->second;
+	}
+
+	double getParDouble(const char* name, int32_t index = 0) const override {
+		const MockParameter* parameter = find(name);
+		return parameter && index >= 0 && index < 4 ? parameter->values[index] : 0.0;
+	}
+
+	bool getParDouble2(const char* name, double& v0, double& v1) const override {
+		v0 = getParDouble(name, 0);
+		v1 = getParDouble(name, 1);
+		return find(name) != nullptr;
+	}
+
+	bool getParDouble3(const char* name, double& v0, double& v1, double& v2) const override {
+		v2 = getParDouble(name, 2);
+		return getParDouble2(name, v0, v1);
+	}
+
+	bool getParDouble4(const char* name, double& v0, double& v1, double& v2, double& v3) const override {
+		v3 = getParDouble(name, 3);
+		return getParDouble3(name, v0, v1, v2);
+	}
+
+	int32_t getParInt(const char* name, int32_t index = 0) const override {
+		return (int32_t)std::lround(getParDouble(name, index));
+	}
+
+	bool getParInt2(const char* name, int32_t& v0, int32_t& v1) const override {
+		v0 = getParInt(name, 0);
+		v1 = getParInt(name, 1);
+		return find(name) != nullptr;
+	}
+
+	bool getParInt3(const char* name, int32_t& v0, int32_t& v1, int32_t& v2) const override {
+		v2 = getParInt(name, 2);
+		return getParInt2(name, v0, v1);
+	}
+
+	bool getParInt4(const char* name, int32_t& v0, int32_t& v1, int32_t& v2, int32_t& v3) const override {
+		v3 = getParInt(name, 3);
+		return getParInt3(name, v0, v1, v2);
+	}
+
+	const char* getParString(const char* name) const override {
+		const MockParameter* parameter = find(name);
+		return parameter ? parameter->string.c_str() : "";
+	}
+
+	const char* getParFilePath(const char* name) const override {
+		return getParString(name);
+	}
+
+	bool getRelativeTransform(const char* from_name, const char* to_name, double matrix[4][4]) const override { return false; }
+	void enablePar(const char* name, bool onoff) const override {}
+
+	const OP_DATInput* getDAT(const char* path) const override { return nullptr; }
+	const OP_TOPInput* getTOP(const char* path) const override { return nullptr; }
+	const OP_CHOPInput* getCHOP(const char* path) const override { return nullptr; }
+	const OP_ObjectInput* getObject(const char* path) const override { return nullptr; }
+	void* getTOPDataInCPUMemory(const OP_TOPInput* top, const OP_TOPInputDownloadOptions* options) const override { return nullptr; }
+	const OP_SOPInput* getParSOP(const char* name) const override { return nullptr; }
+	const OP_SOPInput* getInputSOP(int32_t index) const override { return nullptr; }
+	const OP_SOPInput* getSOP(const char* path) const override { return nullptr; }
+	const OP_DATInput* getInputDAT(int32_t index) const override { return nullptr; }
+	PyObject* getParPython(const char* name) const override { return nullptr; }
+	const OP_TimeInfo* getTimeInfo() const override { return &myTimeInfo; }
+
+private:
+	const MockParameter* find(const char* name) const {
+		auto found = myParameters.find(name);
+		return found == myParameters.end() ? nullptr : &found->second;
+	}
+
+	std::map<std::string, MockParameter> myParameters;
+	std::map<std::string, const MockCHOP*> myChops;
+	OP_TimeInfo myTimeInfo;
+};
+
+// keeps a copy of everything the sop outputs. custom attributes are stored by name, groups as lists of indices.
+class MockSOPOutput : public SOP_Output {
+public:
+	void clear() {
+		positions.clear();
+		normals.clear();
+		colors.clear();
+		texCoords.clear();
+		customAttributes.clear();
+		triangles.clear();
+		pointGroups.clear();
+		primGroups.clear();
+	}
+
+	int32_t addPoint(const Position& pos) override {
+		positions.push_back(pos);
+		return (int32_t)positions.size() - 1;
+	}
+
+	bool addPoints(const Position* pos, int32_t numPoints) override {
+		positions.insert(positions.end(), pos, pos + numPoints);
+		return true;
+	}
+
+	int32_t getNumPoints() override {
+		return (int32_t)positions.size();
+	}
+
+	bool setNormal(const Vector& n, int32_t pointIdx) override {
+		return setNormals(&n, 1, pointIdx);
+	}
+
+	bool setNormals(const Vector* n, int32_t numPoints, int32_t startPointIdx) override {
+		return write(normals, n, numPoints, startPointIdx);
+	}
+
+	bool hasNormal() override {
+		return !normals.empty();
+	}
+
+	bool setColor(const Color& c, int32_t pointIdx) override {
+		return setColors(&c, 1, pointIdx);
+	}
+
+	bool setColors(const Color* c, int32_t numPoints, int32_t startPointIdx) override {
+		return write(colors, c, numPoints, startPointIdx);
+	}
+
+	bool hasColor() override {
+		return !colors.empty();
+	}
+
+	// only the first layer is kept, that's all the sop outputs.
+	bool setTexCoord(const TexCoord* tex, int32_t numLayers, int32_t pointIdx) override {
+		return write(texCoords, tex, 1, pointIdx);
+	}
+
+	bool setTexCoords(const TexCoord* t, int32_t numPoints, int32_t numLayers, int32_t startPointIdx) override {
+		for (int32_t i = 0; i < numPoints; i++) {
+			if (!write(texCoords, t + i * numLayers, 1, startPointIdx + i)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool hasTexCoord() override {
+		return !texCoords.empty();
+	}
+
+	int32_t getNumTexCoordLayers() override {
+		return texCoords.empty() ? 0 : 1;
+	}
+
+	bool setCustomAttribute(const SOP_CustomAttribData* cu, int32_t numPoints) override {
+		std::vector<float>& values = customAttributes[cu->name];
+		size_t count = (size_t)numPoints * cu->numComponents;
+		values.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			values[i] = cu->attribType == AttribType::Float ? (cu->floatData ? cu->floatData[i] : 0.0f) : (cu->intData ? (float)cu->intData[i] : 0.0f);
+		}
+		return true;
+	}
+
+	bool hasCustomAttibutes() override {
+		return !customAttributes.empty();
+	}
+
+	bool addTriangle(int32_t ptIdx1, int32_t ptIdx2, int32_t ptIdx3) override {
+		triangles.insert(triangles.end(), { ptIdx1, ptIdx2, ptIdx3 });
+		return true;
+	}
+
+	bool addTriangles(const int32_t* indices, int32_t size) override {
+		triangles.insert(triangles.end(), indices, indices + size * 3);
+		return true;
+	}
+
+	bool addParticleSystem(int32_t numParticles, int32_t startIndex) override { return false; }
+	bool addLine(const int32_t* indices, int32_t size) override { return false; }
+	bool addLines(const int32_t* indices, int32_t* sizeOfEachLine, int32_t numOfLines) override { return false; }
+
+	int32_t getNumPrimitives() override {
+		return (int32_t)triangles.size() / 3;
+	}
+
+	bool setBoundingBox(const BoundingBox& bbox) override { return true; }
+
+	bool addGroup(const SOP_GroupType& type, const char* name) override {
+		(type == SOP_GroupType::Point ? pointGroups : primGroups)[name];
+		return true;
+	}
+
+	bool destroyGroup(const SOP_GroupType& type, const char* name) override {
+		return (type == SOP_GroupType::Point ? pointGroups : primGroups).erase(name) > 0;
+	}
+
+	bool addPointToGroup(int index, const char* name) override {
+		return addToGroup(index, SOP_GroupType::Point, name);
+	}
+
+	bool addPrimToGroup(int index, const char* name) override {
+		return addToGroup(index, SOP_GroupType::Primitive, name);
+	}
+
+	bool addToGroup(int index, const SOP_GroupType& type, const char* name) override {
+		std::map<std::string, std::vector<int>>& groups = type == SOP_GroupType::Point ? pointGroups : primGroups;
+		auto found = groups.find(name);
+		if (found == groups.end()) {
+			return false;
+		}
+		found->second.push_back(index);
+		return true;
+	}
+
+	bool discardFromPointGroup(int index, const char* name) override { return false; }
+	bool discardFromPrimGroup(int index, const char* name) override { return false; }
+	bool discardFromGroup(int index, const SOP_GroupType& type, const char* name) override { return false; }
+
+	std::vector<Position> positions;
+	std::vector<Vector> normals;
+	std::vector<Color> colors;
+	std::vector<TexCoord> texCoords;
+	std::map<std::string, std::vector<float>> customAttributes;
+	std::vector<int32_t> triangles;
+	std::map<std::string, std::vector<int>> pointGroups;
+	std::map<std::string, std::vector<int>> primGroups;
+
+private:
+	// per point attributes can only be set on points that exist.
+	template <typename T>
+	bool write(std::vector<T>& values, const T* data, int32_t count, int32_t start) {
+		if (start < 0 || start + count > (int32_t)positions.size()) {
+			return false;
+		}
+		values.resize(positions.size());
+		std::copy(data, data + count, values.begin() + start);
+		return true;
+	}
+};
+
+// executeVBO() doesn't output anything yet, this only has to hand out buffers.
+class MockVBOOutput : public SOP_VBOOutput {
+public:
+	void enableNormal() override { myNormal = true; }
+	void enableColor() override { myColor = true; }
+	void enableTexCoord(int32_t numLayers = 0) override { myTexCoordLayers = std::max(numLayers, 1); }
+	bool hasNormal() override { return myNormal; }
+	bool hasColor() override { return myColor; }
+	bool hasTexCoord() override { return myTexCoordLayers > 0; }
+	bool hasCustomAttibutes() override { return false; }
+	bool addCustomAttribute(const SOP_CustomAttribInfo& cu) override { return false; }
+
+	void allocVBO(int32_t numVertices, int32_t numIndices, VBOBufferMode mode) override {
+		myPositions.assign(numVertices, Position());
+		myNormals.assign(numVertices, Vector());
+		myColors.assign(numVertices, Color());
+		myTexCoords.assign((size_t)numVertices * std::max(myTexCoordLayers, 1), TexCoord());
+		myIndices.clear();
+		myIndices.reserve(numIndices);
+	}
+
+	Position* getPos() override { return myPositions.data(); }
+	Vector* getNormals() override { return myNormal ? myNormals.data() : nullptr; }
+	Color* getColors() override { return myColor ? myColors.data() : nullptr; }
+	TexCoord* getTexCoords() override { return myTexCoordLayers > 0 ? myTexCoords.data() : nullptr; }
+	int32_t getNumTexCoordLayers() override { return myTexCoordLayers; }
+
+	int32_t* addTriangles(int32_t numTriangles) override { return append(numTriangles * 3); }
+	int32_t* addParticleSystem(int32_t numParticles) override { return append(numParticles); }
+	int32_t* addLines(int32_t numIndices) override { return append(numIndices); }
+
+	bool getCustomAttribute(SOP_CustomAttribData* cu, const char* name) override { return false; }
+	void updateComplete() override {}
+	bool setBoundingBox(const BoundingBox& bbox) override { return true; }
+
+private:
+	int32_t* append(int32_t count) {
+		size_t start = myIndices.size();
+		myIndices.resize(start + count);
+		return myIndices.data() + start;
+	}
+
+	bool myNormal = false;
+	bool myColor = false;
+	int32_t myTexCoordLayers = 0;
+	std::vector<Position> myPositions;
+	std::vector<Vector> myNormals;
+	std::vector<Color> myColors;
+	std::vector<TexCoord> myTexCoords;
+	std::vector<int32_t> myIndices;
+};
@@ -0,0 +1,312 @@
+#pragma once
+
+#include "Benchmark_Assets.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+/*
+Regression runs: a fixed matrix of scenarios (attribute style x tangent algorithm x post process preset x asset size)
+cooked like the benchmark, then compared against Benchmark/regression_baseline.json.
+
+Timings and peak memory may get worse by the tolerance of their metric in the baseline, relative to the baseline value
+plus an absolute slack so tiny values don't fail on noise. the checksums of the positions, indices and tangents have
+to match exactly, an optimization that changes the geometry has to update the baseline on purpose. a scenario or a
+checksum the baseline doesn't have fails too, so a renamed scenario can't pass without being compared. a baseline with
+no scenarios at all hasn't been recorded yet, against it only failed cooks count.
+*/
+
+struct RegressionScenario {
+	std::string name;
+	SyntheticAsset asset;
+	std::vector<std::pair<const char*, double>> parameters;
+};
+
+struct RegressionResult {
+	std::string name;
+	std::string error;
+	std::map<std::string, double> metrics;
+	std::map<std::string, std::string> checksums;
+};
+
+struct RegressionTolerance {
+	double relative;
+	double absolute;
+};
+
+// metrics a run is compared on, with their tolerance when the baseline doesn't set one.
+static const std::vector<std::pair<const char*, RegressionTolerance>> regressionMetrics = {
+	{ "cold_cook_ms", { 0.15, 2.0 } },
+	{ "warm_cook_ms", { 0.15, 1.0 } },
+	{ "peak_rss_mb", { 0.10, 16.0 } },
+};
+
+// the matrix. the post process presets are the assimp steps that change the geometry or cost the most.
+std::vector<RegressionScenario> regression_scenarios() {
+	struct PostProcessPreset {
+		const char* name;
+		std::vector<std::pair<const char*, double>> parameters;
+	};
+	static const std::vector<PostProcessPreset> postProcessPresets = {
+		{ "minimal", { { "Joinidenticalvertices", 0 }, { "Improvecachelocality", 0 }, { "Optimizemeshes", 0 }, { "Finddegenerates", 0 }, { "Validatedatastructure", 0 } } },
+		{ "default", {} },
+		{ "quality", { { "Findinvaliddata", 1 }, { "Fixinfacingnormals", 1 }, { "Optimizegraph", 1 } } },
+	};
+	static const char* attributeStyles[] = { "touchdesigner", "filament" };
+	static const char* tangentAlgorithms[] = { "assimp", "mikktspace" };
+	static const int64_t sizes[] = { 10000, 100000, 1000000 };
+
+	std::vector<RegressionScenario> scenarios;
+	for (int64_t size : sizes) {
+		for (const PostProcessPreset& postProcess : postProcessPresets) {
+			for (int style = 0; style < 2; style++) {
+				for (int tangents = 0; tangents < 2; tangents++) {
+					RegressionScenario scenario;
+					scenario.name = std::string(attributeStyles[style]) + "/" + tangentAlgorithms[tangents] + "/" + postProcess.name + "/" + std::to_string(size);
+					scenario.asset.triangles = size;
+					scenario.asset.meshes = 4;
+					scenario.asset.format = "obj";
+					scenario.parameters = postProcess.parameters;
+					scenario.parameters.push_back({ "Attributestyle", style });
+					scenario.parameters.push_back({ "Tangentalgorithm", tangents });
+					scenarios.push_back(scenario);
+				}
+			}
+		}
+	}
+	return scenarios;
+}
+
+// fnv-1a over the values. floats are rounded to 1e-4 first, so a different compiler or an other order of additions
+// doesn't change the checksum, but anything visible does.
+uint64_t checksum_floats(const float* values, size_t count, uint64_t hash = 1469598103934665603ULL) {
+	for (size_t i = 0; i < count; i++) {
+		int64_t quantized = std::isfinite(values[i]) ? (int64_t)std::llround((double)values[i] * 10000.0) : INT64_MIN;
+		for (int b = 0; b < 8; b++) {
+			hash = (hash ^ (uint8_t)(quantized >> (b * 8))) * 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+uint64_t checksum_indices(const int32_t* values, size_t count, uint64_t hash = 1469598103934665603ULL) {
+	for (size_t i = 0; i < count; i++) {
+		for (int b = 0; b < 4; b++) {
+			hash = (hash ^ (uint8_t)((uint32_t)values[i] >> (b * 8))) * 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+std::string checksum_string(uint64_t hash) {
+	char text[17];
+	snprintf(text, sizeof(text), "%016llx", (unsigned long long)hash);
+	return text;
+}
+
+// just enough json to read back a baseline: objects, arrays, strings and numbers.
+struct JsonValue {
+	enum Type { Null, Number, String, Array, Object } type = Null;
+	double number = 0;
+	std::string string;
+	std::vector<JsonValue> array;
+	std::map<std::string, JsonValue> object;
+
+	const JsonValue* find(const std::string& key) const {
+		auto found = object.find(key);
+		return found == object.end() ? nullptr : &found->second;
+	}
+};
+
+bool parse_json(const std::string& text, size_t& at, JsonValue& value) {
+	while (at < text.size() && isspace((unsigned char)text[at])) at++;
+	if (at >= text.size()) {
+		return false;
+	}
+
+	if (text[at] == '{' || text[at] == '[') {
+		bool isObject = text[at] == '{';
+		char close = isObject ? '}' : ']';
+		value.type = isObject ? JsonValue::Object : JsonValue::Array;
+		at++;
+		while (true) {
+			while (at < text.size() && (isspace((unsigned char)text[at]) || text[at] == ',')) at++;
+			if (at >= text.size()) {
+				return false;
+			}
+			if (text[at] == close) {
+				at++;
+				return true;
+			}
+			JsonValue key;
+			if (isObject) {
+				if (!parse_json(text, at, key) || key.type != JsonValue::String) {
+					return false;
+				}
+				while (at < text.size() && isspace((unsigned char)text[at])) at++;
+				if (at >= text.size() || text[at++] != ':') {
+					return false;
+				}
+			}
+			JsonValue element;
+			if (!parse_json(text, at, element)) {
+				return false;
+			}
+			if (isObject) {
+				value.object[key.string] = element;
+			}
+			else {
+				value.array.push_back(element);
+			}
+		}
+	}
+
+	if (text[at] == '"') {
+		value.type = JsonValue::String;
+		for (at++; at < text.size() && text[at] != '"'; at++) {
+			if (text[at] == '\\' && at + 1 < text.size()) {
+				at++;
+				if (text[at] == 'u' && at + 4 < text.size()) {
+					value.string += (char)strtol(text.substr(at + 1, 4).c_str(), nullptr, 16);
+					at += 4;
+					continue;
+				}
+			}
+			value.string += text[at];
+		}
+		return at++ < text.size();
+	}
+
+	if (text.compare(at, 4, "null") == 0) {
+		at += 4;
+		return true;
+	}
+
+	char* end = nullptr;
+	value.type = JsonValue::Number;
+	value.number = strtod(text.c_str() + at, &end);
+	if (end == text.c_str() + at) {
+		return false;
+	}
+	at = end - text.c_str();
+	return true;
+}
+
+bool read_json_file(const std::string& file, JsonValue& value) {
+	std::ifstream in(file, std::ios::binary);
+	if (!in) {
+		return false;
+	}
+	std::stringstream text;
+	text << in.rdbuf();
+	size_t at = 0;
+	return parse_json(text.str(), at, value) && value.type == JsonValue::Object;
+}
+
+RegressionTolerance regression_tolerance(const JsonValue& baseline, const char* metric, RegressionTolerance fallback) {
+	const JsonValue* tolerances = baseline.find("tolerances");
+	const JsonValue* tolerance = tolerances ? tolerances->find(metric) : nullptr;
+	if (tolerance) {
+		if (const JsonValue* relative = tolerance->find("relative")) fallback.relative = relative->number;
+		if (const JsonValue* absolute = tolerance->find("absolute")) fallback.absolute = absolute->number;
+	}
+	return fallback;
+}
+
+// compares the results against the baseline, writes a line per problem to report. returns the number of regressions.
+int compare_regression(const JsonValue& baseline, const std::vector<RegressionResult>& results, std::string& report) {
+	int regressions = 0;
+	const JsonValue* scenarios = baseline.find("scenarios");
+	bool recorded = scenarios && !scenarios->object.empty();
+	if (!recorded) {
+		report += "the baseline has no scenarios, only failed cooks are checked. record it with --update-baseline\n";
+	}
+	for (const RegressionResult& result : results) {
+		if (!result.error.empty()) {
+			report += result.name + ": cook failed, " + result.error + "\n";
+			regressions++;
+			continue;
+		}
+		if (!recorded) {
+			continue;
+		}
+		const JsonValue* expected = scenarios ? scenarios->find(result.name) : nullptr;
+		if (!expected) {
+			report += result.name + ": no baseline, record it with --update-baseline\n";
+			regressions++;
+			continue;
+		}
+
+		for (const auto& metric : regressionMetrics) {
+			const JsonValue* value = expected->find(metric.first);
+			auto measured = result.metrics.find(metric.first);
+			if (!value || measured == result.metrics.end()) {
+				continue;
+			}
+			RegressionTolerance tolerance = regression_tolerance(baseline, metric.first, metric.second);
+			double limit = value->number * (1 + tolerance.relative) + tolerance.absolute;
+			if (measured->second > limit) {
+				char line[512];
+				snprintf(line, sizeof(line), "%s: %s %.3f, baseline %.3f (limit %.3f)\n", result.name.c_str(), metric.first,
+					measured->second, value->number, limit);
+				report += line;
+				regressions++;
+			}
+		}
+
+		for (const auto& checksum : result.checksums) {
+			const JsonValue* value = expected->find(checksum.first);
+			if (!value) {
+				report += result.name + ": " + checksum.first + " " + checksum.second + ", not in the baseline\n";
+				regressions++;
+			}
+			else if (value->string != checksum.second) {
+				report += result.name + ": " + checksum.first + " " + checksum.second + ", baseline " + value->string + "\n";
+				regressions++;
+			}
+		}
+	}
+	return regressions;
+}
+
+// the results as a baseline, keeping the tolerances of the previous one.
+std::string regression_baseline_json(const JsonValue& previous, const std::vector<RegressionResult>& results) {
+	std::string json = "{\n\t\"tolerances\": {\n";
+	for (size_t m = 0; m < regressionMetrics.size(); m++) {
+		RegressionTolerance tolerance = regression_tolerance(previous, regressionMetrics[m].first, regressionMetrics[m].second);
+		char line[256];
+		snprintf(line, sizeof(line), "\t\t\"%s\": { \"relative\": %g, \"absolute\": %g }%s\n", regressionMetrics[m].first,
+			tolerance.relative, tolerance.absolute, m + 1 < regressionMetrics.size() ? "," : "");
+		json += line;
+	}
+	json += "\t},\n\t\"scenarios\": {";
+
+	bool first = true;
+	for (const RegressionResult& result : results) {
+		if (!result.error.empty()) {
+			continue;
+		}
+		json += std::string(first ? "\n" : ",\n") + "\t\t\"" + result.name + "\": { ";
+		first = false;
+		bool firstField = true;
+		for (const auto& metric : result.metrics) {
+			char field[256];
+			snprintf(field, sizeof(field), "%s\"%s\": %.3f", firstField ? "" : ", ", metric.first.c_str(), metric.second);
+			json += field;
+			firstField = false;
+		}
+		for (const auto& checksum : result.checksums) {
+			json += (firstField ? "\"" : ", \"") + checksum.first + "\": \"" + checksum.second + "\"";
+			firstField = false;
+		}
+		json += " }";
+	}
+	return json + "\n\t}\n}\n";
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// the GL types the TD headers use, on macOS they come from the OpenGL framework. only for building the benchmark on linux.
+typedef unsigned int GLuint;
+typedef int GLint;
+typedef unsigned int GLenum;
+typedef float GLfloat;
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <cstring>
+
+#include "DataAndTypes.h"
+
+/*
+Tail latency of the cooks: a histogram of every cook stage's time (and of the whole cook), so the info CHOP can report
+p50 / p95 / p99 / max instead of only the last cook.
+
+The histograms are HDR style, log linear buckets over microseconds: exact below kLatencySub us, then kLatencySub
+buckets per power of two, so every value is kept to about 3% in a fixed amount of memory. they roll over two windows of
+kLatencyWindow cooks: once the current window is full it replaces the previous one and starts over, so the numbers
+cover the last 1 - 2 windows of cooks and a hitch from minutes ago ages out.
+*/
+
+const int kLatencySubBits = 5;
+const int kLatencySub = 1 << kLatencySubBits;
+const int kLatencyOctaves = 24; // up to 2^29 us, about 9 minutes, slower cooks land in the last bucket.
+const int kLatencyBuckets = kLatencySub * (kLatencyOctaves + 1);
+const int kLatencyWindow = 1024;
+
+// percentiles the info CHOP reports per stage, then the max.
+static const double latencyPercentiles[] = { 0.50, 0.95, 0.99 };
+static const char* latencyChannelSuffixes[] = { "_p50_ms", "_p95_ms", "_p99_ms", "_max_ms" };
+const int kLatencyValues = sizeof(latencyChannelSuffixes) / sizeof(latencyChannelSuffixes[0]);
+
+int latency_bucket(uint64_t us) {
+	if (us < (uint64_t)kLatencySub) {
+		return (int)us;
+	}
+	int msb = kLatencySubBits;
+	while (msb < 63 && (us >> (msb + 1)) != 0) {
+		msb++;
+	}
+	int octave = msb - kLatencySubBits + 1;
+	int step = (int)((us >> (msb - kLatencySubBits)) - kLatencySub);
+	return std::min(octave * kLatencySub + step, kLatencyBuckets - 1);
+}
+
+// the highest value that falls into bucket.
+uint64_t latency_bucket_value(int bucket) {
+	if (bucket < kLatencySub) {
+		return (uint64_t)bucket;
+	}
+	int shift = bucket / kLatencySub - 1;
+	int step = bucket % kLatencySub;
+	return ((uint64_t)(kLatencySub + step) << shift) + ((1ull << shift) - 1);
+}
+
+class LatencyHistogram {
+public:
+	void record(double ms) {
+		if (myCount[myCurrent] == kLatencyWindow) {
+			myCurrent = 1 - myCurrent;
+			clear(myCurrent);
+		}
+		uint64_t us = ms > 0 ? (uint64_t)(ms * 1000.0 + 0.5) : 0;
+		myBuckets[myCurrent][latency_bucket(us)]++;
+		myCount[myCurrent]++;
+		myMax[myCurrent] = std::max(myMax[myCurrent], us);
+	}
+
+	void reset() {
+		clear(0);
+		clear(1);
+		myCurrent = 0;
+	}
+
+	// cooks the numbers are over.
+	int count() const {
+		return myCount[0] + myCount[1];
+	}
+
+	// value at percentile (0 - 1) in milliseconds, the upper end of its bucket but never more than the max.
+	double percentile(double p) const {
+		int total = count();
+		if (total == 0) {
+			return 0;
+		}
+		int target = std::max(1, (int)std::ceil(p * total));
+		int seen = 0;
+		for (int bucket = 0; bucket < kLatencyBuckets; bucket++) {
+			seen += myBuckets[0][bucket] + myBuckets[1][bucket];
+			if (seen >= target) {
+				return std::min(latency_bucket_value(bucket), std::max(myMax[0], myMax[1])) / 1000.0;
+			}
+		}
+		return max();
+	}
+
+	double max() const {
+		return std::max(myMax[0], myMax[1]) / 1000.0;
+	}
+
+private:
+	void clear(int window) {
+		memset(myBuckets[window], 0, sizeof(myBuckets[window]));
+		myCount[window] = 0;
+		myMax[window] = 0;
+	}
+
+	uint32_t myBuckets[2][kLatencyBuckets] = {};
+	int myCount[2] = { 0, 0 };
+	uint64_t myMax[2] = { 0, 0 };
+	int myCurrent = 0;
+};
+
+// one histogram per CookStage, StageCook being the whole cook.
+class CookStats {
+public:
+	// stageMs is indexed by CookStage, stages that didn't run count as 0.
+	void record(const float* stageMs) {
+		for (int stage = 0; stage < NumCookStages; stage++) {
+			myStages[stage].record(stageMs[stage]);
+		}
+		myDirty = true;
+	}
+
+	void reset() {
+		for (LatencyHistogram& histogram : myStages) {
+			histogram.reset();
+		}
+		myDirty = true;
+	}
+
+	int count() const {
+		return myStages[StageCook].count();
+	}
+
+	// value (index into latencyChannelSuffixes) of stage in milliseconds. the percentiles are worked out once per cook,
+	// the first time one of them is asked for.
+	float value(int stage, int which) {
+		if (myDirty) {
+			for (int s = 0; s < NumCookStages; s++) {
+				for (int v = 0; v < kLatencyValues; v++) {
+					mySummary[s][v] = (float)(v < kLatencyValues - 1 ? myStages[s].percentile(latencyPercentiles[v]) : myStages[s].max());
+				}
+			}
+			myDirty = false;
+		}
+		return mySummary[stage][which];
+	}
+
+private:
+	LatencyHistogram myStages[NumCookStages];
+	float mySummary[NumCookStages][kLatencyValues] = {};
+	bool myDirty = true;
+};
+
+// times the whole cook into stageMs[StageCook] and records the cook into stats, whichever way execute() returns.
+class CookStatsScope {
+public:
+	CookStatsScope(CookStats* stats, float* stageMs) : myStats(stats), myStageMs(stageMs) {
+		myStart = std::chrono::high_resolution_clock::now();
+	}
+
+	~CookStatsScope() {
+		myStageMs[StageCook] = (float)elapsed_ms(myStart);
+		myStats->record(myStageMs);
+	}
+
+private:
+	CookStats* myStats;
+	float* myStageMs;
+	std::chrono::high_resolution_clock::time_point myStart;
+};
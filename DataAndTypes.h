@@ -8,9 +8,11 @@
 #include <assimp/DefaultLogger.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <assimp/config.h>
 
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
 #include <math.h>
 #include <assert.h>
 #include <iostream>
@@ -18,6 +20,8 @@
 #include <vector>
 #include <array>
 #include <cmath>
+#include <chrono>
+#include <unordered_set>
 
 #include <mikktspace.h>
 #include <mikktspace.c>
@@ -30,21 +34,9 @@ Vector vec;
 Color col;
 TexCoord tex;
 std::string	myError;
-std::array<double, 4> vertexTint;
-float normal[3];
-float tangent[3];
-float tangentSign;
-float bitangent[3];
-float tbnquat[4];
 int vtxOffset;
 int triOffset;
 
-// public variable to append log data to.
-std::string myLog;
-
-SMikkTSpaceInterface iface{};
-SMikkTSpaceContext context{};
-
 /*
 class Vertex {
 public:
@@ -57,11 +49,61 @@ public:
 };
 */
 
-std::vector<float> expandedPositions;
-std::vector<float> expandedColors;
-std::vector<float> expandedUvs0;
+// the buffers emit_mesh expands the Google Filament attributes into. one per sop, they keep their capacity between cooks
+// so the next emit doesn't have to grow them again.
+struct FilamentScratch {
+	std::vector<float> expandedPositions;
+	std::vector<float> expandedColors;
+	std::vector<float> expandedUvs0;
+
+	std::vector<float> debugging;
+};
+
+// node hierarchy of a skinned and/or animated scene. nodes are every bone node, animated node and (with animations) mesh node,
+// plus their ancestors. parents always come before their children.
+struct Skeleton {
+	std::vector<std::string> nodeNames;
+	std::vector<int> nodeParents; // -1 for the root.
+	std::vector<float> nodeLocals; // 16 per node, column major rest transform relative to the parent.
+	std::vector<int> jointNodes; // skeleton node each joint follows.
+	std::vector<float> jointBinds; // 16 per joint, column major, takes a flattened vertex into the joint's space.
+	std::vector<int> meshNodes; // per source mesh, node whose animation moves it rigidly, -1 if none (skinned, instanced or not animated).
+	std::vector<int> instanceNodes; // per Instance_Data row, node of the reference. only with animations.
+
+	bool empty() const {
+		return jointNodes.empty();
+	}
+};
 
-std::vector<float> debugging;
+// keyframes of one animated node, times are in ticks. rotations are quaternions stored w x y z.
+struct AnimationChannel {
+	int node = -1; // skeleton node the channel drives.
+	std::vector<double> positionTimes;
+	std::vector<float> positions; // 3 per key.
+	std::vector<double> rotationTimes;
+	std::vector<float> rotations; // 4 per key.
+	std::vector<double> scaleTimes;
+	std::vector<float> scales; // 3 per key.
+	float rest[10] = { 0, 0, 0, 1, 0, 0, 0, 1, 1, 1 }; // rest translate xyz, rotate wxyz, scale xyz, for key types without keys.
+};
+
+// one aiAnimation, copied out of the scene so it outlives the importer.
+struct Animation {
+	std::string name;
+	double duration = 0; // in ticks.
+	double ticksPerSecond = 25;
+	std::vector<AnimationChannel> channels;
+};
+
+// one morph target (blendshape), merged by name over all source meshes. sparse, only the vertices it moves are stored.
+// deltas are in world space and 4 wide (the 4th is 0) so they can be added with one sse op.
+struct MorphTarget {
+	std::string name;
+	float defaultWeight = 0; // aiAnimMesh::mWeight, used when no weight is given for the target.
+	std::vector<int32_t> vertices; // ascending.
+	std::vector<float> positionDeltas; // 4 per vertex.
+	std::vector<float> normalDeltas; // 4 per vertex.
+};
 
 class Mesh {
 public:
@@ -73,10 +115,41 @@ public:
 	std::vector<float> Bitangent_Data; // 3
 	std::vector<float> TbnQuat_Data; // 4
 	std::vector<int32_t> FaceIndex_Data; // 4
+	std::vector<int32_t> MeshId_Data; // 1, index of the source mesh each vertex came from.
+	std::vector<int> MeshFace_Offsets; // first triangle of each source mesh, plus a trailing entry equal to numTris.
+	std::vector<int32_t> JointIndex_Data; // 4, strongest joint influences per vertex, only if the scene has bones.
+	std::vector<float> JointWeight_Data; // 4, weights of those joints, summing to 1 (or 0 for vertices without bones).
+	Skeleton skeleton;
+	std::vector<Animation> animations;
+	std::vector<MorphTarget> morphTargets;
+	std::vector<int32_t> SourceVertex_Data; // 1, compacted meshes only: the vertex of the flattened mesh each vertex was copied from.
+	std::vector<std::string> NodeName_Data; // 1 per source mesh, name of the node that references it.
+	std::vector<std::string> MeshName_Data; // 1 per source mesh, name of the aiMesh.
+	std::vector<float> Instance_Data; // 10, instanced output only: translate xyz, rotate xyz, scale xyz, source mesh id, per node reference.
 	int numTris = 0; // init'd here, but updated in main for loop.
 	int vertsPerFace = 3; // always 3 , always using triangles for our implementation.
+	int numSkippedMeshes = 0; // mesh references left out by the name filters.
+	int numSkippedVertices = 0;
+	double flattenMs = 0; // how long flatten_scene took, without the mikktspace stages below.
+	double tangentsMs = 0; // mikktspace tangent generation.
+	double tbnQuatMs = 0; // tbn quats packed after mikktspace, the standard method packs them while flattening.
 };
 
+// everything flatten_scene needs from the parameters, bundled so it can be handed to a background load as is.
+struct FlattenOptions {
+	int DoMikktSpaceTangents = 0;
+	int Attributestyle = 0;
+	std::array<double, 4> Vertextint = { 1.0, 1.0, 1.0, 1.0 };
+	int Instanced = 0;
+	std::string Includenames = "*"; // space separated glob patterns, matched against node and mesh names.
+	std::string Excludenames = "";
+};
+
+// milliseconds since start.
+inline double elapsed_ms(std::chrono::high_resolution_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
 struct Vertex {
 	float x, y, z;
 };
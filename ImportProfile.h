@@ -0,0 +1,198 @@
+#pragma once
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/config.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+
+/*
+Per step timings of an import, from assimp's own profiler (AI_CONFIG_GLOB_MEASURE_TIME).
+
+The profiler writes its timings as debug messages: START / END `region`, dt= seconds. ReadFile times its regions by
+name (import, preprocess, total ...), but every post processing step is timed as the same `postprocess` region, so
+the step is taken from the "<Step>Process begin" message each step logs when it starts. the messages reach the
+ImportProfile of the calling thread through the log stream in LogRing.h.
+
+rank_post_process_steps() answers the other question, what each step costs in total: it imports the file once with
+the current flags and once with each step toggled, and ranks the steps by the difference.
+*/
+
+struct ImportStep {
+	std::string name; // lower case, ie. "triangulate", "joinvertices", "import".
+	double ms = 0;
+};
+
+class ImportProfile {
+public:
+	// called with every debug message logged while this profile is the thread's target.
+	void parse(const char* message) {
+		size_t length = strlen(message);
+		while (length > 0 && isspace((unsigned char)message[length - 1])) {
+			length--;
+		}
+		std::string text(message, length);
+
+		const std::string begin = " begin";
+		if (text.size() > begin.size() && text.compare(text.size() - begin.size(), begin.size(), begin) == 0
+			&& text.find(' ') == text.size() - begin.size()) {
+			myPendingStep = step_name(text.substr(0, text.size() - begin.size()));
+			return;
+		}
+
+		if (text.compare(0, 3, "END") != 0) {
+			return;
+		}
+		size_t open = text.find('`');
+		size_t close = open == std::string::npos ? std::string::npos : text.find('`', open + 1);
+		size_t dt = text.find("dt=");
+		if (close == std::string::npos || dt == std::string::npos) {
+			return;
+		}
+		std::string region = text.substr(open + 1, close - open - 1);
+		double ms = atof(text.c_str() + dt + 3) * 1000.0;
+
+		if (region == "postprocess") {
+			region = myPendingStep.empty() ? "step" + std::to_string(myUnnamed++) : myPendingStep;
+			myPendingStep.clear();
+		}
+		add(step_name(region), ms);
+	}
+
+	const std::vector<ImportStep>& steps() const {
+		return mySteps;
+	}
+
+private:
+	// "JoinVerticesProcess" -> "joinvertices", anything that isn't a letter or digit is dropped.
+	static std::string step_name(const std::string& name) {
+		std::string stripped = name;
+		const std::string suffix = "Process";
+		if (stripped.size() > suffix.size() && stripped.compare(stripped.size() - suffix.size(), suffix.size(), suffix) == 0) {
+			stripped.resize(stripped.size() - suffix.size());
+		}
+		std::string lower;
+		for (char c : stripped) {
+			if (isalnum((unsigned char)c)) {
+				lower += (char)tolower((unsigned char)c);
+			}
+		}
+		return lower;
+	}
+
+	// a step that runs twice (ie. validation) is summed.
+	void add(const std::string& name, double ms) {
+		for (ImportStep& step : mySteps) {
+			if (step.name == name) {
+				step.ms += ms;
+				return;
+			}
+		}
+		mySteps.push_back({ name, ms });
+	}
+
+	std::vector<ImportStep> mySteps;
+	std::string myPendingStep;
+	int myUnnamed = 0;
+};
+
+// profile the assimp debug messages of the calling thread are parsed into, if any.
+static thread_local ImportProfile* profileTarget = nullptr;
+
+// parses the profiler output of the imports on the calling thread into profile, for as long as it's in scope.
+class ProfileScope {
+public:
+	ProfileScope(ImportProfile* profile) : myPrevious(profileTarget) {
+		profileTarget = profile;
+	}
+
+	~ProfileScope() {
+		profileTarget = myPrevious;
+	}
+
+private:
+	ImportProfile* myPrevious;
+};
+
+// the post processing steps rank_post_process_steps() toggles, with the parameter that controls them (or none if the sop
+// always sets them).
+struct PostProcessStep {
+	const char* name;
+	const char* parameter;
+	unsigned int flag;
+};
+
+static const PostProcessStep postProcessSteps[] = {
+	{ "calctangentspace", nullptr, aiProcess_CalcTangentSpace },
+	{ "joinidenticalvertices", "Joinidenticalvertices", aiProcess_JoinIdenticalVertices },
+	{ "triangulate", nullptr, aiProcess_Triangulate },
+	{ "gennormals", nullptr, aiProcess_GenNormals },
+	{ "validatedatastructure", "Validatedatastructure", aiProcess_ValidateDataStructure },
+	{ "improvecachelocality", "Improvecachelocality", aiProcess_ImproveCacheLocality },
+	{ "fixinfacingnormals", "Fixinfacingnormals", aiProcess_FixInfacingNormals },
+	{ "sortbyptype", "Sortbyptype", aiProcess_SortByPType },
+	{ "finddegenerates", "Finddegenerates", aiProcess_FindDegenerates },
+	{ "findinvaliddata", "Findinvaliddata", aiProcess_FindInvalidData },
+	{ "genuvcoords", "Genuvcoords", aiProcess_GenUVCoords },
+	{ "transformuvcoords", "Transformuvcoords", aiProcess_TransformUVCoords },
+	{ "optimizemeshes", "Optimizemeshes", aiProcess_OptimizeMeshes },
+	{ "optimizegraph", "Optimizegraph", aiProcess_OptimizeGraph },
+	{ "flipwindingorder", "Flipwindingorder", aiProcess_FlipWindingOrder },
+	{ "findinstances", "Instancedoutput", aiProcess_FindInstances },
+};
+
+struct StepCost {
+	const char* name;
+	const char* parameter;
+	bool enabled; // part of the flags the sop imports with.
+	double costMs; // import time the step adds, negative if the import is faster with it.
+};
+
+// best of a few imports of file with flags in milliseconds, or a negative value if it doesn't load.
+double time_import(const std::string& file, unsigned int flags, const std::string& keepList, int repeats) {
+	double best = -1;
+	for (int r = 0; r < repeats; r++) {
+		auto start = std::chrono::high_resolution_clock::now();
+		Assimp::Importer importer;
+		importer.SetPropertyString(AI_CONFIG_PP_OG_EXCLUDE_LIST, keepList);
+		const aiScene* scene = importer.ReadFile(file, 0);
+		if (scene) {
+			scene = importer.ApplyPostProcessing(flags);
+		}
+		if (!scene) {
+			return -1;
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		best = best < 0 ? ms : std::min(best, ms);
+	}
+	return best;
+}
+
+// imports file with flags, then with every step of postProcessSteps toggled, and returns the steps sorted by what they
+// cost, most expensive first. the cost of an enabled step is what turning it off saves, of a disabled one what turning it
+// on would add. empty if the file doesn't load.
+std::vector<StepCost> rank_post_process_steps(const std::string& file, unsigned int flags, const std::string& keepList, int repeats) {
+	std::vector<StepCost> costs;
+	double baseline = time_import(file, flags, keepList, repeats);
+	if (baseline < 0) {
+		return costs;
+	}
+
+	for (const PostProcessStep& step : postProcessSteps) {
+		bool enabled = (flags & step.flag) != 0;
+		double toggled = time_import(file, flags ^ step.flag, keepList, repeats);
+		if (toggled < 0) {
+			continue;
+		}
+		costs.push_back({ step.name, step.parameter, enabled, enabled ? baseline - toggled : toggled - baseline });
+	}
+
+	std::sort(costs.begin(), costs.end(), [](const StepCost& a, const StepCost& b) { return a.costMs > b.costMs; });
+	return costs;
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <assimp/DefaultLogger.hpp>
+#include <assimp/LogStream.hpp>
+
+#include "ImportProfile.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+
+/*
+Assimp log, kept per sop in a fixed size ring of the last kLogRingCapacity messages, which the Info DAT lists one row
+per message.
+
+Assimp's logger is global, so it's created once, with one stream per severity, while any sop exists, and never rebuilt
+while one of them might be logging from the background. every message goes to the ring of the sop whose import is
+running on the calling thread: execute(), the progressive loader and the prefetch workers set it with a LogScope.
+messages logged outside of a scope are dropped, and each ring keeps only the severities its sop asked for. debug
+messages also go to the thread's ImportProfile, if it has one, which is how the timings of assimp's profiler are read.
+
+Writers never block: a message claims a slot with one atomic add, and the slot's sequence number tells a reader whether
+it holds a finished message. once the ring is full the oldest messages are overwritten, and messages longer than
+kLogMessageLength are cut off.
+*/
+
+const int kLogRingCapacity = 1024;
+const int kLogMessageLength = 256;
+
+enum LogSeverity { LogDebug, LogInfo, LogWarn, LogError };
+
+static const char* logSeverityNames[] = { "debug", "info", "warn", "error" };
+
+// Assimp::Logger::ErrorSeverity flag of each LogSeverity.
+static const unsigned int logSeverityFlags[] = { Assimp::Logger::Debugging, Assimp::Logger::Info, Assimp::Logger::Warn, Assimp::Logger::Err };
+
+struct LogEntry {
+	int severity;
+	int64_t timeMs; // milliseconds since the unix epoch.
+	std::string message;
+};
+
+class LogRing {
+public:
+	// severities (Assimp::Logger::ErrorSeverity flags) the ring keeps, the others are dropped by write().
+	void setSeverity(unsigned int severity) {
+		mySeverity.store(severity, std::memory_order_relaxed);
+	}
+
+	// safe to call from any thread.
+	void write(int severity, const char* message) {
+		if ((mySeverity.load(std::memory_order_relaxed) & logSeverityFlags[severity]) == 0) {
+			return;
+		}
+		uint64_t ticket = myHead.fetch_add(1, std::memory_order_relaxed);
+		Slot& slot = mySlots[ticket % kLogRingCapacity];
+
+		// 0 marks the slot as being written, readers skip it.
+		slot.sequence.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		slot.severity = severity;
+		slot.timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+		// assimp ends every message with a line break.
+		size_t length = strnlen(message, kLogMessageLength - 1);
+		while (length > 0 && (message[length - 1] == '\n' || message[length - 1] == '\r')) {
+			length--;
+		}
+		memcpy(slot.message, message, length);
+		slot.message[length] = 0;
+
+		slot.sequence.store(ticket + 1, std::memory_order_release);
+	}
+
+	// hides everything written so far, ie. when a new import starts.
+	void clear() {
+		myStart.store(myHead.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+
+	// the messages still in the ring, oldest first. messages being written while this runs are left out.
+	std::vector<LogEntry> snapshot() const {
+		uint64_t head = myHead.load(std::memory_order_acquire);
+		uint64_t start = std::max(myStart.load(std::memory_order_relaxed), head > (uint64_t)kLogRingCapacity ? head - kLogRingCapacity : 0);
+
+		std::vector<LogEntry> entries;
+		entries.reserve((size_t)(head - start));
+		for (uint64_t ticket = start; ticket < head; ticket++) {
+			const Slot& slot = mySlots[ticket % kLogRingCapacity];
+			if (slot.sequence.load(std::memory_order_acquire) != ticket + 1) {
+				continue;
+			}
+			LogEntry entry = { slot.severity, slot.timeMs, std::string(slot.message, strnlen(slot.message, kLogMessageLength)) };
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			// overwritten while it was copied.
+			if (slot.sequence.load(std::memory_order_relaxed) != ticket + 1) {
+				continue;
+			}
+			entries.push_back(std::move(entry));
+		}
+		return entries;
+	}
+
+	// messages overwritten before anyone saw them, since the last clear().
+	uint64_t overwritten() const {
+		uint64_t head = myHead.load(std::memory_order_relaxed);
+		uint64_t start = myStart.load(std::memory_order_relaxed);
+		return head - start > (uint64_t)kLogRingCapacity ? head - start - kLogRingCapacity : 0;
+	}
+
+private:
+	struct Slot {
+		std::atomic<uint64_t> sequence{ 0 }; // ticket + 1 once the message is complete.
+		int severity = LogInfo;
+		int64_t timeMs = 0;
+		char message[kLogMessageLength];
+	};
+
+	Slot mySlots[kLogRingCapacity];
+	std::atomic<uint64_t> myHead{ 0 };
+	std::atomic<uint64_t> myStart{ 0 };
+	std::atomic<unsigned int> mySeverity{ 0 };
+};
+
+// ring the assimp messages of the calling thread go to.
+static thread_local LogRing* logTarget = nullptr;
+
+// sends the assimp messages of the calling thread to ring, for as long as it's in scope.
+class LogScope {
+public:
+	LogScope(LogRing* ring) : myPrevious(logTarget) {
+		logTarget = ring;
+	}
+
+	~LogScope() {
+		logTarget = myPrevious;
+	}
+
+private:
+	LogRing* myPrevious;
+};
+
+class AssimpLogStream : public Assimp::LogStream {
+public:
+	AssimpLogStream(int severity) : mySeverity(severity) {}
+
+	// assimp knows to call the write function inside this logstream class, so overriding it here with our own functionality.
+	void write(const char* message) override {
+		// the severity is known from the stream, drop assimp's "Info,  T0: " prefix.
+		const char* text = strstr(message, ": ");
+		text = text && text - message < 16 ? text + 2 : message;
+
+		if (profileTarget && mySeverity == LogDebug) {
+			profileTarget->parse(text);
+		}
+		if (logTarget) {
+			logTarget->write(mySeverity, text);
+		}
+	}
+
+private:
+	int mySeverity;
+};
+
+// sops holding the global logger.
+static int loggerUsers = 0;
+
+// every sop holds the logger from its constructor until its background threads are joined in its destructor, so it's
+// created with the first sop and killed after the last one, never while anyone could be logging. it's verbose with
+// every severity attached, the rings filter what their sop asked for, and the profiler's debug messages always arrive.
+void acquire_logger() {
+	if (loggerUsers++ > 0) {
+		return;
+	}
+	Assimp::DefaultLogger::create("", Assimp::Logger::VERBOSE);
+	for (int severity = LogDebug; severity <= LogError; severity++) {
+		Assimp::DefaultLogger::get()->attachStream(new AssimpLogStream(severity), logSeverityFlags[severity]);
+	}
+}
+
+void release_logger() {
+	if (--loggerUsers == 0) {
+		Assimp::DefaultLogger::kill();
+	}
+}
+
+// local time of a log entry as hh:mm:ss.mmm.
+std::string log_time_string(int64_t timeMs) {
+	time_t seconds = (time_t)(timeMs / 1000);
+	struct tm local;
+#ifdef _WIN32
+	localtime_s(&local, &seconds);
+#else // macOS
+	localtime_r(&seconds, &local);
+#endif
+	char text[32];
+	snprintf(text, sizeof(text), "%02d:%02d:%02d.%03d", local.tm_hour, local.tm_min, local.tm_sec, (int)(timeMs % 1000));
+	return text;
+}
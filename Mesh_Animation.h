@@ -0,0 +1,369 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+
+#include "DataAndTypes.h"
+#include "Parallel.h"
+#include "Mesh_Transform.h"
+#include "Mesh_Skinning.h"
+
+/*
+Node animation playback.
+
+flatten_scene copies the aiAnimations out of the scene (the importer doesn't outlive the import), with every channel
+pointing at a skeleton node. the skeleton is extended with the animated nodes, and with the node of every mesh, so one
+pose (a local matrix per skeleton node) drives skinning, rigid mesh animation and the instance table alike.
+
+Sampling keeps a cursor (last key index) per channel and key type. playback moves forward a frame at a time, so the
+cursor is almost always already on the right key or one step before it, and a lookup costs O(1). a jump further than
+kAnimationCursorSteps keys (scrubbing, looping back) falls back to a binary search.
+
+The animated mesh is a copy of the output mesh that's updated in place: a source mesh is only re-transformed (from the
+rest data) when the world matrix of its node changed since the last cook, so static parts of an animated scene cost nothing.
+*/
+
+// keys a cursor is stepped forward before giving up and doing a binary search.
+const int kAnimationCursorSteps = 4;
+
+// frames sampled by the benchmark.
+const int kAnimationBenchmarkFrames = 1000;
+
+// copies the animations of the scene into animations, adding every animated node to the skeleton, and links the
+// meshes / instance references to their nodes. referenceNodes is the node of every Instance_Data row (instanced output),
+// empty otherwise. meshes with bones are moved by their skin, not their node.
+void collect_animations(const aiScene* scene, const std::vector<MeshInstance>& instances, const std::vector<const aiNode*>& referenceNodes,
+	Skeleton& skeleton, std::unordered_map<const aiNode*, int>& nodeIndex, std::vector<Animation>& animations) {
+
+	animations.clear();
+	skeleton.meshNodes.assign(instances.size(), -1);
+	skeleton.instanceNodes.clear();
+	if (scene->mNumAnimations == 0 || scene->mRootNode == nullptr) {
+		return;
+	}
+
+	for (unsigned int anim_index = 0; anim_index < scene->mNumAnimations; anim_index++) {
+		const aiAnimation* source = scene->mAnimations[anim_index];
+
+		Animation animation;
+		animation.name = source->mName.C_Str();
+		animation.duration = source->mDuration;
+		animation.ticksPerSecond = source->mTicksPerSecond != 0 ? source->mTicksPerSecond : 25.0;
+
+		for (unsigned int channel_index = 0; channel_index < source->mNumChannels; channel_index++) {
+			const aiNodeAnim* nodeAnim = source->mChannels[channel_index];
+			const aiNode* node = scene->mRootNode->FindNode(nodeAnim->mNodeName);
+			if (node == nullptr) {
+				continue;
+			}
+
+			AnimationChannel channel;
+			channel.node = skeleton_add_node(skeleton, nodeIndex, node);
+
+			aiVector3D restScaling, restPosition;
+			aiQuaternion restRotation;
+			node->mTransformation.Decompose(restScaling, restRotation, restPosition);
+			const float rest[10] = { restPosition.x, restPosition.y, restPosition.z,
+				restRotation.w, restRotation.x, restRotation.y, restRotation.z, restScaling.x, restScaling.y, restScaling.z };
+			std::copy(rest, rest + 10, channel.rest);
+
+			for (unsigned int k = 0; k < nodeAnim->mNumPositionKeys; k++) {
+				const aiVectorKey& key = nodeAnim->mPositionKeys[k];
+				channel.positionTimes.push_back(key.mTime);
+				channel.positions.insert(channel.positions.end(), { key.mValue.x, key.mValue.y, key.mValue.z });
+			}
+			for (unsigned int k = 0; k < nodeAnim->mNumRotationKeys; k++) {
+				const aiQuatKey& key = nodeAnim->mRotationKeys[k];
+				channel.rotationTimes.push_back(key.mTime);
+				channel.rotations.insert(channel.rotations.end(), { key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z });
+			}
+			for (unsigned int k = 0; k < nodeAnim->mNumScalingKeys; k++) {
+				const aiVectorKey& key = nodeAnim->mScalingKeys[k];
+				channel.scaleTimes.push_back(key.mTime);
+				channel.scales.insert(channel.scales.end(), { key.mValue.x, key.mValue.y, key.mValue.z });
+			}
+			animation.channels.push_back(std::move(channel));
+		}
+
+		animations.push_back(std::move(animation));
+	}
+
+	for (size_t inst = 0; inst < instances.size(); inst++) {
+		const MeshInstance& instance = instances[inst];
+		if (referenceNodes.empty() && instance.node && !scene->mMeshes[instance.meshIndex]->HasBones()) {
+			skeleton.meshNodes[inst] = skeleton_add_node(skeleton, nodeIndex, instance.node);
+		}
+	}
+	for (const aiNode* node : referenceNodes) {
+		skeleton.instanceNodes.push_back(node ? skeleton_add_node(skeleton, nodeIndex, node) : -1);
+	}
+}
+
+// finds the key interval for time t, times[key] <= t < times[key + 1], using and updating the cursor.
+// returns the blend factor between key and key + 1, the key is clamped to the first / last key outside the range.
+float animation_find_key(const std::vector<double>& times, double t, int& cursor, bool useCursor) {
+	int count = (int)times.size();
+	if (count < 2 || t <= times[0]) {
+		cursor = 0;
+		return 0;
+	}
+	if (t >= times[count - 1]) {
+		cursor = count - 1;
+		return 0;
+	}
+
+	int key = -1;
+	if (useCursor && cursor >= 0 && cursor < count - 1 && times[cursor] <= t) {
+		for (int step = 0; step < kAnimationCursorSteps; step++, cursor++) {
+			if (t < times[cursor + 1]) {
+				key = cursor;
+				break;
+			}
+		}
+	}
+	if (key == -1) {
+		key = (int)(std::upper_bound(times.begin(), times.end(), t) - times.begin()) - 1;
+	}
+
+	cursor = key;
+	return (float)((t - times[key]) / (times[key + 1] - times[key]));
+}
+
+// samples an animation into per channel cursors and a local matrix per skeleton node.
+struct AnimationSampler {
+	int clip = -1; // animation the cursors belong to.
+	std::vector<int> cursors; // 3 per channel: position, rotation, scale.
+
+	void reset(const Animation& animation, int Clip) {
+		clip = Clip;
+		cursors.assign(animation.channels.size() * 3, 0);
+	}
+
+	// overwrites the locals of every animated node with the animation at time t (ticks).
+	// channel keys that are missing keep that part of the rest transform.
+	void sample(const Animation& animation, double t, std::vector<float>& locals, bool useCursor = true) {
+		for (size_t c = 0; c < animation.channels.size(); c++) {
+			const AnimationChannel& channel = animation.channels[c];
+			float* local = &locals[channel.node * 16];
+
+			const float* rest = channel.rest;
+
+			aiVector3D position(rest[0], rest[1], rest[2]);
+			if (!channel.positionTimes.empty()) {
+				int& cursor = cursors[c * 3 + 0];
+				float f = animation_find_key(channel.positionTimes, t, cursor, useCursor);
+				const float* a = &channel.positions[cursor * 3];
+				const float* b = cursor + 1 < (int)channel.positionTimes.size() ? a + 3 : a;
+				position = aiVector3D(a[0] + (b[0] - a[0]) * f, a[1] + (b[1] - a[1]) * f, a[2] + (b[2] - a[2]) * f);
+			}
+
+			aiQuaternion rotation(rest[3], rest[4], rest[5], rest[6]);
+			if (!channel.rotationTimes.empty()) {
+				int& cursor = cursors[c * 3 + 1];
+				float f = animation_find_key(channel.rotationTimes, t, cursor, useCursor);
+				const float* a = &channel.rotations[cursor * 4];
+				const float* b = cursor + 1 < (int)channel.rotationTimes.size() ? a + 4 : a;
+				aiQuaternion qa(a[0], a[1], a[2], a[3]);
+				aiQuaternion qb(b[0], b[1], b[2], b[3]);
+				aiQuaternion::Interpolate(rotation, qa, qb, f);
+				rotation.Normalize();
+			}
+
+			aiVector3D scaling(rest[7], rest[8], rest[9]);
+			if (!channel.scaleTimes.empty()) {
+				int& cursor = cursors[c * 3 + 2];
+				float f = animation_find_key(channel.scaleTimes, t, cursor, useCursor);
+				const float* a = &channel.scales[cursor * 3];
+				const float* b = cursor + 1 < (int)channel.scaleTimes.size() ? a + 3 : a;
+				scaling = aiVector3D(a[0] + (b[0] - a[0]) * f, a[1] + (b[1] - a[1]) * f, a[2] + (b[2] - a[2]) * f);
+			}
+
+			matrix_to_column_major(aiMatrix4x4(scaling, rotation, position), local);
+		}
+	}
+};
+
+// seconds to ticks, either looped over the duration or clamped to it.
+double animation_ticks(const Animation& animation, double seconds, bool loop) {
+	double ticks = seconds * animation.ticksPerSecond;
+	if (animation.duration <= 0) {
+		return 0;
+	}
+	if (loop) {
+		ticks = std::fmod(ticks, animation.duration);
+		return ticks < 0 ? ticks + animation.duration : ticks;
+	}
+	return std::min(std::max(ticks, 0.0), animation.duration);
+}
+
+// plays the animation forward over kAnimationBenchmarkFrames frames, and returns the throughput in channels per
+// millisecond. useCursor false measures the plain binary search for comparison.
+double benchmark_animation_sampler(const Animation& animation, const Skeleton& skeleton, bool useCursor) {
+	AnimationSampler sampler;
+	sampler.reset(animation, 0);
+	std::vector<float> locals = skeleton.nodeLocals;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int frame = 0; frame < kAnimationBenchmarkFrames; frame++) {
+		double t = animation.duration * frame / (kAnimationBenchmarkFrames - 1);
+		sampler.sample(animation, t, locals, useCursor);
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	double channels = (double)animation.channels.size() * kAnimationBenchmarkFrames;
+	return ms > 0 ? channels / ms : 0;
+}
+
+// the animated copy of an output mesh, updated in place every cook.
+struct AnimatedMesh {
+	std::string key; // lod key, lod and skinning mode the copy was made for, empty if it has to be rebuilt.
+	Mesh mesh;
+	std::vector<int> vertexOffsets; // first vertex of each source mesh, plus a trailing entry.
+	std::vector<float> appliedWorlds; // 16 per source mesh, the node world the vertices were last transformed with.
+	std::vector<float> restWorlds; // 16 per skeleton node, world matrices of the rest pose.
+
+	void clear() {
+		key.clear();
+		mesh = Mesh();
+		vertexOffsets.clear();
+		appliedWorlds.clear();
+		restWorlds.clear();
+	}
+};
+
+// makes a fresh animated copy of rest. source meshes are contiguous vertex ranges (MeshId_Data only ever goes up).
+void animated_mesh_reset(AnimatedMesh& animated, const Mesh& rest, const Skeleton& skeleton, const std::string& key) {
+	animated.key = key;
+	animated.mesh = rest;
+
+	int meshCount = (int)skeleton.meshNodes.size();
+	animated.vertexOffsets.assign(meshCount + 1, (int)rest.Position_Data.size());
+	for (int v = (int)rest.MeshId_Data.size() - 1; v >= 0; v--) {
+		animated.vertexOffsets[rest.MeshId_Data[v]] = v;
+	}
+	for (int meshId = meshCount - 1; meshId >= 0; meshId--) {
+		animated.vertexOffsets[meshId] = std::min(animated.vertexOffsets[meshId], animated.vertexOffsets[meshId + 1]);
+	}
+
+	skeleton_worlds(skeleton, skeleton.nodeLocals, animated.restWorlds);
+	animated.appliedWorlds.assign(meshCount * 16, 0.0f);
+	for (int meshId = 0; meshId < meshCount; meshId++) {
+		int node = skeleton.meshNodes[meshId];
+		if (node >= 0) {
+			std::copy(&animated.restWorlds[node * 16], &animated.restWorlds[node * 16] + 16, &animated.appliedWorlds[meshId * 16]);
+		}
+	}
+}
+
+// re-transforms the source meshes whose node moved since the last call, from rest into the animated copy, with
+// world(animated) * inverse(world(rest)). dirtyMeshes marks source meshes whose rest data changed (morph targets), they
+// are redone even if their node didn't move, or just copied if they don't follow a node.
+// returns how many source meshes were touched.
+int animated_mesh_update(AnimatedMesh& animated, const Mesh& rest, const Skeleton& skeleton, const std::vector<float>& worlds,
+	const std::vector<char>& dirtyMeshes) {
+	int meshCount = (int)skeleton.meshNodes.size();
+	bool hasBitangents = rest.Bitangent_Data.size() == rest.Position_Data.size() * 3;
+	bool hasTbnQuat = rest.TbnQuat_Data.size() == rest.Position_Data.size() * 4 && hasBitangents;
+	std::atomic<int> touched(0);
+
+	parallel_for(meshCount, [&](int meshId) {
+		int node = skeleton.meshNodes[meshId];
+		int begin = animated.vertexOffsets[meshId];
+		int end = animated.vertexOffsets[meshId + 1];
+		bool dirty = meshId < (int)dirtyMeshes.size() && dirtyMeshes[meshId];
+		if (begin == end || (node < 0 && !dirty)) {
+			return;
+		}
+
+		Mesh& mesh = animated.mesh;
+		if (node < 0) {
+			std::copy(rest.Position_Data.begin() + begin, rest.Position_Data.begin() + end, mesh.Position_Data.begin() + begin);
+			std::copy(rest.Normal_Data.begin() + begin, rest.Normal_Data.begin() + end, mesh.Normal_Data.begin() + begin);
+			if (hasTbnQuat) {
+				std::copy(rest.TbnQuat_Data.begin() + begin * 4, rest.TbnQuat_Data.begin() + end * 4, mesh.TbnQuat_Data.begin() + begin * 4);
+			}
+			touched++;
+			return;
+		}
+
+		const float* world = &worlds[node * 16];
+		float* applied = &animated.appliedWorlds[meshId * 16];
+		if (!dirty && std::equal(world, world + 16, applied)) {
+			return;
+		}
+		std::copy(world, world + 16, applied);
+		touched++;
+
+		// delta from the rest pose the vertices were flattened with, to the animated pose.
+		const float* r = &animated.restWorlds[node * 16];
+		aiMatrix4x4 inverseRest(
+			r[0], r[4], r[8], r[12],
+			r[1], r[5], r[9], r[13],
+			r[2], r[6], r[10], r[14],
+			r[3], r[7], r[11], r[15]);
+		inverseRest.Inverse();
+		float inverseRestColumns[16];
+		matrix_to_column_major(inverseRest, inverseRestColumns);
+
+		float delta[16];
+		multiply_matrices(world, inverseRestColumns, delta);
+		MeshInstance transform;
+		aiMatrix4x4 deltaRows(
+			delta[0], delta[4], delta[8], delta[12],
+			delta[1], delta[5], delta[9], delta[13],
+			delta[2], delta[6], delta[10], delta[14],
+			delta[3], delta[7], delta[11], delta[15]);
+		mesh_instance_set_matrix(transform, deltaRows);
+
+		// Position and Vector are plain 3 float structs, same layout as aiVector3D.
+		int count = end - begin;
+		transform_points((const aiVector3D*)&rest.Position_Data[begin].x, nullptr, count, transform.world, &mesh.Position_Data[begin].x, 3);
+		transform_directions((const aiVector3D*)&rest.Normal_Data[begin].x, nullptr, count, transform.normalMatrix, &mesh.Normal_Data[begin].x, 3);
+
+		// tangents are 4 wide, so they don't fit transform_directions.
+		for (int v = begin; v < end; v++) {
+			float* out[2] = { &mesh.Tangent_Data[v * 4], hasBitangents ? &mesh.Bitangent_Data[v * 3] : nullptr };
+			const float* in[2] = { &rest.Tangent_Data[v * 4], hasBitangents ? &rest.Bitangent_Data[v * 3] : nullptr };
+			for (int k = 0; k < 2; k++) {
+				if (out[k] == nullptr) {
+					continue;
+				}
+				float x = in[k][0], y = in[k][1], z = in[k][2];
+				for (int row = 0; row < 3; row++) {
+					out[k][row] = delta[row] * x + delta[4 + row] * y + delta[8 + row] * z;
+				}
+				skin_normalize(out[k]);
+			}
+
+			if (hasTbnQuat) {
+				const float* tangent = &mesh.Tangent_Data[v * 4];
+				const float* bitangent = &mesh.Bitangent_Data[v * 3];
+				const Vector& normal = mesh.Normal_Data[v];
+				tbn_to_quat(
+					tangent[0], tangent[1], tangent[2], tangent[3],
+					bitangent[0], bitangent[1], bitangent[2],
+					normal.x, normal.y, normal.z, &mesh.TbnQuat_Data[v * 4]
+				);
+			}
+		}
+	});
+
+	return touched;
+}
+
+// instance table for a pose, same layout as Mesh::Instance_Data.
+void animated_instance_table(const Mesh& rest, const Skeleton& skeleton, const std::vector<float>& worlds, std::vector<float>& table) {
+	table = rest.Instance_Data;
+	for (size_t row = 0; row < skeleton.instanceNodes.size() && (row + 1) * 10 <= table.size(); row++) {
+		int node = skeleton.instanceNodes[row];
+		if (node >= 0) {
+			decompose_transform(&worlds[node * 16], &table[row * 10 + 0], &table[row * 10 + 3], &table[row * 10 + 6]);
+		}
+	}
+}
@@ -0,0 +1,509 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <thread>
+
+#include "DataAndTypes.h"
+#include "Parallel.h"
+
+/*
+Bounding volume hierarchy over the final triangles, for fast ray and closest point queries against the imported geometry.
+
+Built top down with a binned surface area heuristic (SAH). The tree is stored depth first, so the first child of a node
+is always the next node, and the second child is stored as an offset relative to the node. That makes every subtree
+position independent, so the top of the tree can be built on several threads and the pieces just appended together.
+
+Triangle ids returned by the queries are primitive numbers in the sop (the index of the triangle in FaceIndex_Data).
+*/
+
+const int kBvhBins = 16;
+const int kBvhMaxLeafTris = 8;
+const int kBvhParallelMinTris = 20000; // below this, spawning a thread for a subtree costs more than it saves.
+
+struct BvhNode {
+	float boundsMin[3];
+	float boundsMax[3];
+	int32_t first; // leaf: first entry in Bvh::triangles. interior: unused.
+	int32_t count; // leaf: number of triangles. interior: 0.
+	int32_t secondChild; // interior: offset from this node to its second child, the first child is the next node.
+};
+
+struct Bvh {
+	std::vector<BvhNode> nodes;
+	std::vector<int32_t> triangles; // triangle ids, in leaf order.
+	std::vector<float> vertices; // 9 floats per triangle, in leaf order, so traversal doesn't have to go through the index buffer.
+
+	bool empty() const {
+		return nodes.empty();
+	}
+};
+
+struct BvhHit {
+	int32_t triangle = -1; // -1 if nothing was hit.
+	float t = FLT_MAX; // ray: distance along the (normalized) direction. closest point: distance to the point.
+	float position[3] = { 0, 0, 0 };
+	float normal[3] = { 0, 0, 0 }; // geometric normal of the triangle that was hit.
+};
+
+struct BvhBuildData {
+	const float* triMin; // bounds and centroids of all the triangles, 3 floats each.
+	const float* triMax;
+	const float* centroids;
+	int32_t* triangles; // shared array that every subtree partitions its own range of.
+};
+
+void bvh_grow(float bmin[3], float bmax[3], const float pmin[3], const float pmax[3]) {
+	for (int a = 0; a < 3; a++) {
+		bmin[a] = std::min(bmin[a], pmin[a]);
+		bmax[a] = std::max(bmax[a], pmax[a]);
+	}
+}
+
+float bvh_area(const float bmin[3], const float bmax[3]) {
+	float d[3] = { bmax[0] - bmin[0], bmax[1] - bmin[1], bmax[2] - bmin[2] };
+	if (d[0] < 0) {
+		return 0;
+	}
+	return 2 * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+}
+
+// builds the subtree for triangles[begin, end) and appends it to nodes. depth limits how many threads get spawned.
+void bvh_build_range(const BvhBuildData& data, int begin, int end, int depth, std::vector<BvhNode>& nodes) {
+	BvhNode node;
+	float centroidMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float centroidMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (int a = 0; a < 3; a++) {
+		node.boundsMin[a] = FLT_MAX;
+		node.boundsMax[a] = -FLT_MAX;
+	}
+	for (int i = begin; i < end; i++) {
+		int32_t tri = data.triangles[i];
+		bvh_grow(node.boundsMin, node.boundsMax, &data.triMin[tri * 3], &data.triMax[tri * 3]);
+		bvh_grow(centroidMin, centroidMax, &data.centroids[tri * 3], &data.centroids[tri * 3]);
+	}
+
+	int count = end - begin;
+	node.first = begin;
+	node.count = count;
+	node.secondChild = 0;
+
+	if (count <= 2) {
+		nodes.push_back(node);
+		return;
+	}
+
+	// find the cheapest split plane over all 3 axes, with the triangles binned by centroid.
+	int bestAxis = -1;
+	int bestBin = 0;
+	float bestCost = FLT_MAX;
+
+	for (int axis = 0; axis < 3; axis++) {
+		float extent = centroidMax[axis] - centroidMin[axis];
+		if (extent <= 0) {
+			continue;
+		}
+		float scale = kBvhBins / extent;
+
+		int binCount[kBvhBins] = {};
+		float binMin[kBvhBins][3];
+		float binMax[kBvhBins][3];
+		for (int b = 0; b < kBvhBins; b++) {
+			for (int a = 0; a < 3; a++) {
+				binMin[b][a] = FLT_MAX;
+				binMax[b][a] = -FLT_MAX;
+			}
+		}
+
+		for (int i = begin; i < end; i++) {
+			int32_t tri = data.triangles[i];
+			int b = std::min(kBvhBins - 1, (int)((data.centroids[tri * 3 + axis] - centroidMin[axis]) * scale));
+			binCount[b]++;
+			bvh_grow(binMin[b], binMax[b], &data.triMin[tri * 3], &data.triMax[tri * 3]);
+		}
+
+		// sweep from the right to get the cost of everything right of each plane, then from the left.
+		float rightArea[kBvhBins];
+		int rightCount[kBvhBins];
+		float sweepMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float sweepMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		int sweepCount = 0;
+		for (int b = kBvhBins - 1; b > 0; b--) {
+			bvh_grow(sweepMin, sweepMax, binMin[b], binMax[b]);
+			sweepCount += binCount[b];
+			rightArea[b] = bvh_area(sweepMin, sweepMax);
+			rightCount[b] = sweepCount;
+		}
+
+		for (int a = 0; a < 3; a++) {
+			sweepMin[a] = FLT_MAX;
+			sweepMax[a] = -FLT_MAX;
+		}
+		sweepCount = 0;
+		for (int b = 0; b < kBvhBins - 1; b++) {
+			bvh_grow(sweepMin, sweepMax, binMin[b], binMax[b]);
+			sweepCount += binCount[b];
+			if (sweepCount == 0 || rightCount[b + 1] == 0) {
+				continue;
+			}
+			float cost = sweepCount * bvh_area(sweepMin, sweepMax) + rightCount[b + 1] * rightArea[b + 1];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+			}
+		}
+	}
+
+	// keep it as a leaf if splitting doesn't pay off, as long as the leaf isn't too big.
+	float leafCost = count * bvh_area(node.boundsMin, node.boundsMax);
+	if (count <= kBvhMaxLeafTris && (bestAxis == -1 || bestCost >= leafCost)) {
+		nodes.push_back(node);
+		return;
+	}
+
+	int mid;
+	if (bestAxis == -1) {
+		// all centroids are in the same spot, just split the range in half.
+		mid = begin + count / 2;
+	}
+	else {
+		float scale = kBvhBins / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+		float splitMin = centroidMin[bestAxis];
+		int32_t* split = std::partition(data.triangles + begin, data.triangles + end, [&](int32_t tri) {
+			int b = std::min(kBvhBins - 1, (int)((data.centroids[tri * 3 + bestAxis] - splitMin) * scale));
+			return b <= bestBin;
+		});
+		mid = (int)(split - data.triangles);
+	}
+
+	node.first = 0;
+	node.count = 0;
+	size_t nodeIndex = nodes.size();
+	nodes.push_back(node);
+
+	// the two halves work on separate ranges of the triangle array, so they can be built at the same time.
+	// each one goes into its own list, which is then appended, that's fine since subtrees are position independent.
+	if (depth > 0 && count >= kBvhParallelMinTris) {
+		std::vector<BvhNode> left;
+		std::vector<BvhNode> right;
+		std::thread leftThread([&]() { bvh_build_range(data, begin, mid, depth - 1, left); });
+		bvh_build_range(data, mid, end, depth - 1, right);
+		leftThread.join();
+
+		nodes[nodeIndex].secondChild = 1 + (int32_t)left.size();
+		nodes.insert(nodes.end(), left.begin(), left.end());
+		nodes.insert(nodes.end(), right.begin(), right.end());
+		return;
+	}
+
+	bvh_build_range(data, begin, mid, 0, nodes);
+	nodes[nodeIndex].secondChild = (int32_t)(nodes.size() - nodeIndex);
+	bvh_build_range(data, mid, end, 0, nodes);
+}
+
+// builds a bvh over the given triangles.
+void build_bvh(Bvh& bvh, const std::vector<int32_t>& indices, const std::vector<Position>& positions) {
+	int numTris = (int)indices.size() / 3;
+
+	bvh.nodes.clear();
+	bvh.triangles.resize(numTris);
+	bvh.vertices.clear();
+	if (numTris == 0) {
+		return;
+	}
+
+	std::vector<float> triMin(numTris * 3);
+	std::vector<float> triMax(numTris * 3);
+	std::vector<float> centroids(numTris * 3);
+
+	// per triangle bounds, split into chunks for the worker threads.
+	const int chunkSize = 4096;
+	int numChunks = (numTris + chunkSize - 1) / chunkSize;
+	parallel_for(numChunks, [&](int chunk) {
+		int end = std::min(numTris, (chunk + 1) * chunkSize);
+		for (int tri = chunk * chunkSize; tri < end; tri++) {
+			const Position& p0 = positions[indices[tri * 3 + 0]];
+			const Position& p1 = positions[indices[tri * 3 + 1]];
+			const Position& p2 = positions[indices[tri * 3 + 2]];
+			triMin[tri * 3 + 0] = std::min(p0.x, std::min(p1.x, p2.x));
+			triMin[tri * 3 + 1] = std::min(p0.y, std::min(p1.y, p2.y));
+			triMin[tri * 3 + 2] = std::min(p0.z, std::min(p1.z, p2.z));
+			triMax[tri * 3 + 0] = std::max(p0.x, std::max(p1.x, p2.x));
+			triMax[tri * 3 + 1] = std::max(p0.y, std::max(p1.y, p2.y));
+			triMax[tri * 3 + 2] = std::max(p0.z, std::max(p1.z, p2.z));
+			for (int a = 0; a < 3; a++) {
+				centroids[tri * 3 + a] = (triMin[tri * 3 + a] + triMax[tri * 3 + a]) * 0.5f;
+			}
+			bvh.triangles[tri] = tri;
+		}
+	});
+
+	// every level of threads doubles the thread count, so stop once there's one per worker.
+	int depth = 0;
+	while ((1 << depth) < worker_count()) {
+		depth++;
+	}
+
+	BvhBuildData data = { triMin.data(), triMax.data(), centroids.data(), bvh.triangles.data() };
+	bvh.nodes.reserve(numTris / 2);
+	bvh_build_range(data, 0, numTris, depth, bvh.nodes);
+
+	bvh.vertices.resize(numTris * 9);
+	for (int i = 0; i < numTris; i++) {
+		int32_t tri = bvh.triangles[i];
+		for (int k = 0; k < 3; k++) {
+			const Position& p = positions[indices[tri * 3 + k]];
+			bvh.vertices[i * 9 + k * 3 + 0] = p.x;
+			bvh.vertices[i * 9 + k * 3 + 1] = p.y;
+			bvh.vertices[i * 9 + k * 3 + 2] = p.z;
+		}
+	}
+}
+
+// slab test, returns the entry distance or FLT_MAX if the box is missed (or further than maxT).
+float bvh_ray_box(const BvhNode& node, const float origin[3], const float invDir[3], float maxT) {
+	float tMin = 0;
+	float tMax = maxT;
+	for (int a = 0; a < 3; a++) {
+		float t0 = (node.boundsMin[a] - origin[a]) * invDir[a];
+		float t1 = (node.boundsMax[a] - origin[a]) * invDir[a];
+		if (t0 > t1) {
+			std::swap(t0, t1);
+		}
+		tMin = std::max(tMin, t0);
+		tMax = std::min(tMax, t1);
+	}
+	return tMin <= tMax ? tMin : FLT_MAX;
+}
+
+// moller trumbore, two sided. returns the distance along the ray or FLT_MAX.
+float bvh_ray_triangle(const float* v, const float origin[3], const float dir[3]) {
+	float e1[3] = { v[3] - v[0], v[4] - v[1], v[5] - v[2] };
+	float e2[3] = { v[6] - v[0], v[7] - v[1], v[8] - v[2] };
+	float p[3];
+	cross(dir, e2, p);
+	float det = dot(e1, p);
+	if (std::fabs(det) < 1e-12f) {
+		return FLT_MAX;
+	}
+	float invDet = 1 / det;
+	float s[3] = { origin[0] - v[0], origin[1] - v[1], origin[2] - v[2] };
+	float u = dot(s, p) * invDet;
+	if (u < 0 || u > 1) {
+		return FLT_MAX;
+	}
+	float q[3];
+	cross(s, e1, q);
+	float w = dot(dir, q) * invDet;
+	if (w < 0 || u + w > 1) {
+		return FLT_MAX;
+	}
+	float t = dot(e2, q) * invDet;
+	return t >= 0 ? t : FLT_MAX;
+}
+
+void bvh_triangle_normal(const float* v, float normal[3]) {
+	float e1[3] = { v[3] - v[0], v[4] - v[1], v[5] - v[2] };
+	float e2[3] = { v[6] - v[0], v[7] - v[1], v[8] - v[2] };
+	cross(e1, e2, normal);
+	if (length(normal) > 0) {
+		normalize(normal);
+	}
+}
+
+// closest hit along the ray. the direction doesn't have to be normalized, t is returned in world units either way.
+BvhHit bvh_raycast(const Bvh& bvh, const float origin[3], const float direction[3], float maxDistance = FLT_MAX) {
+	BvhHit hit;
+	float dir[3] = { direction[0], direction[1], direction[2] };
+	if (bvh.empty() || length(dir) == 0) {
+		return hit;
+	}
+	normalize(dir);
+	float invDir[3] = { 1 / dir[0], 1 / dir[1], 1 / dir[2] };
+
+	int bestIndex = -1;
+	float bestT = maxDistance;
+
+	std::vector<int> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (!stack.empty()) {
+		int nodeIndex = stack.back();
+		stack.pop_back();
+		const BvhNode& node = bvh.nodes[nodeIndex];
+		if (bvh_ray_box(node, origin, invDir, bestT) == FLT_MAX) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (int i = node.first; i < node.first + node.count; i++) {
+				float t = bvh_ray_triangle(&bvh.vertices[i * 9], origin, dir);
+				if (t < bestT) {
+					bestT = t;
+					bestIndex = i;
+				}
+			}
+			continue;
+		}
+
+		// visit the nearer child first, so bestT shrinks quickly and prunes more of the far side.
+		int first = nodeIndex + 1;
+		int second = nodeIndex + node.secondChild;
+		float tFirst = bvh_ray_box(bvh.nodes[first], origin, invDir, bestT);
+		float tSecond = bvh_ray_box(bvh.nodes[second], origin, invDir, bestT);
+		if (tFirst > tSecond) {
+			std::swap(first, second);
+			std::swap(tFirst, tSecond);
+		}
+		if (tSecond != FLT_MAX) {
+			stack.push_back(second);
+		}
+		if (tFirst != FLT_MAX) {
+			stack.push_back(first);
+		}
+	}
+
+	if (bestIndex != -1) {
+		hit.triangle = bvh.triangles[bestIndex];
+		hit.t = bestT;
+		for (int a = 0; a < 3; a++) {
+			hit.position[a] = origin[a] + dir[a] * bestT;
+		}
+		bvh_triangle_normal(&bvh.vertices[bestIndex * 9], hit.normal);
+	}
+	return hit;
+}
+
+// squared distance from a point to a box, 0 if it's inside.
+float bvh_point_box_distance2(const BvhNode& node, const float point[3]) {
+	float d2 = 0;
+	for (int a = 0; a < 3; a++) {
+		float d = std::max(std::max(node.boundsMin[a] - point[a], 0.0f), point[a] - node.boundsMax[a]);
+		d2 += d * d;
+	}
+	return d2;
+}
+
+// closest point on a triangle, from Ericson's Real-Time Collision Detection.
+void bvh_closest_point_triangle(const float* v, const float p[3], float result[3]) {
+	const float* a = &v[0];
+	const float* b = &v[3];
+	const float* c = &v[6];
+	float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	float ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+
+	auto set = [&](float wa, float wb, float wc) {
+		for (int k = 0; k < 3; k++) {
+			result[k] = a[k] * wa + b[k] * wb + c[k] * wc;
+		}
+	};
+
+	float d1 = dot(ab, ap);
+	float d2 = dot(ac, ap);
+	if (d1 <= 0 && d2 <= 0) { set(1, 0, 0); return; }
+
+	float bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+	float d3 = dot(ab, bp);
+	float d4 = dot(ac, bp);
+	if (d3 >= 0 && d4 <= d3) { set(0, 1, 0); return; }
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+		float w = d1 / (d1 - d3);
+		set(1 - w, w, 0);
+		return;
+	}
+
+	float cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+	float d5 = dot(ab, cp);
+	float d6 = dot(ac, cp);
+	if (d6 >= 0 && d5 <= d6) { set(0, 0, 1); return; }
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+		float w = d2 / (d2 - d6);
+		set(1 - w, 0, w);
+		return;
+	}
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+		float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		set(0, 1 - w, w);
+		return;
+	}
+
+	float denom = 1 / (va + vb + vc);
+	float wb = vb * denom;
+	float wc = vc * denom;
+	set(1 - wb - wc, wb, wc);
+}
+
+// closest point on the surface to the given point. hit.t is the distance to it.
+BvhHit bvh_closest_point(const Bvh& bvh, const float point[3], float maxDistance = FLT_MAX) {
+	BvhHit hit;
+	if (bvh.empty()) {
+		return hit;
+	}
+
+	int bestIndex = -1;
+	float bestD2 = maxDistance == FLT_MAX ? FLT_MAX : maxDistance * maxDistance;
+	float bestPoint[3] = { 0, 0, 0 };
+
+	std::vector<int> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (!stack.empty()) {
+		int nodeIndex = stack.back();
+		stack.pop_back();
+		const BvhNode& node = bvh.nodes[nodeIndex];
+		if (bvh_point_box_distance2(node, point) >= bestD2) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (int i = node.first; i < node.first + node.count; i++) {
+				float closest[3];
+				bvh_closest_point_triangle(&bvh.vertices[i * 9], point, closest);
+				float d[3] = { closest[0] - point[0], closest[1] - point[1], closest[2] - point[2] };
+				float d2 = dot(d, d);
+				if (d2 < bestD2) {
+					bestD2 = d2;
+					bestIndex = i;
+					bestPoint[0] = closest[0]; bestPoint[1] = closest[1]; bestPoint[2] = closest[2];
+				}
+			}
+			continue;
+		}
+
+		int first = nodeIndex + 1;
+		int second = nodeIndex + node.secondChild;
+		float dFirst = bvh_point_box_distance2(bvh.nodes[first], point);
+		float dSecond = bvh_point_box_distance2(bvh.nodes[second], point);
+		if (dFirst > dSecond) {
+			std::swap(first, second);
+			std::swap(dFirst, dSecond);
+		}
+		if (dSecond < bestD2) {
+			stack.push_back(second);
+		}
+		if (dFirst < bestD2) {
+			stack.push_back(first);
+		}
+	}
+
+	if (bestIndex != -1) {
+		hit.triangle = bvh.triangles[bestIndex];
+		hit.t = std::sqrt(bestD2);
+		hit.position[0] = bestPoint[0]; hit.position[1] = bestPoint[1]; hit.position[2] = bestPoint[2];
+		bvh_triangle_normal(&bvh.vertices[bestIndex * 9], hit.normal);
+	}
+	return hit;
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <climits>
+#include <vector>
+#include <array>
+
+#include "DataAndTypes.h"
+#include "Mesh_Overdraw.h"
+#include "Mesh_Simplify.h"
+#include "Mesh_Meshlets.h"
+#include "Mesh_Bvh.h"
+#include "Mesh_Animation.h"
+#include "Mesh_Morph.h"
+#include "Trace.h"
+
+// everything we keep around between cooks, so parameters that don't affect the import don't have to redo it.
+class MeshCache {
+public:
+	// key of the import/flatten parameters the cached mesh was built with, empty when nothing is cached.
+	std::string flattenKey;
+
+	// file the cached mesh was read from, the current frame in sequence mode, and the topology hash of that frame
+	// (only computed in sequence mode).
+	std::string file;
+	uint64_t topologyHash = 0;
+
+	// sequence cache frame the cached mesh's positions and normals were decoded from, INT_MIN if none.
+	int cacheFrame = INT_MIN;
+
+	// key of the LOD/overdraw parameters the cached lods were built with.
+	std::string lodKey;
+
+	// the flattened full resolution mesh.
+	Mesh mesh;
+
+	// one entry per LOD level. level 0 only has FaceIndex_Data filled in and uses the vertex data of mesh above,
+	// every level after that is a compacted standalone mesh.
+	std::vector<Mesh> lods;
+
+	// per LOD level: acmr before, acmr after, overdraw before, overdraw after.
+	std::vector<std::array<float, 4>> lodStats;
+
+	// per LOD level: meshlets and the meshlet id of every point, empty when meshlets are off.
+	std::vector<std::vector<Meshlet>> lodMeshlets;
+	std::vector<std::vector<int32_t>> lodPointClusters;
+
+	// per LOD level: bvh for ray / closest point queries, only built once a query needs it.
+	std::vector<Bvh> lodBvhs;
+	std::vector<char> lodBvhPosed; // the bvh was built over a deformed pose instead of the rest pose.
+
+	// animation playback: key cursors, the morphed and the animated copy of the output mesh.
+	AnimationSampler sampler;
+	MorphedMesh morphed;
+	AnimatedMesh animated;
+
+	void clear() {
+		flattenKey.clear();
+		file.clear();
+		topologyHash = 0;
+		cacheFrame = INT_MIN;
+		lodKey.clear();
+		mesh = Mesh();
+		lods.clear();
+		lodStats.clear();
+		lodMeshlets.clear();
+		lodPointClusters.clear();
+		lodBvhs.clear();
+		lodBvhPosed.clear();
+		sampler = AnimationSampler();
+		morphed.clear();
+		animated.clear();
+	}
+};
+
+// generates all the LOD levels from the cached mesh, then optionally applies overdraw ordering and builds meshlets for each of them.
+// maxMeshletVertices of 0 means no meshlets.
+void build_lods(MeshCache& cache, int levels, double ratio, const SimplifyOptions& options, int overdrawOrdering, float overdrawThreshold, int overdrawStats,
+	int maxMeshletVertices, int maxMeshletTriangles) {
+	cache.lods.clear();
+	cache.lodStats.clear();
+	cache.lodMeshlets.clear();
+	cache.lodPointClusters.clear();
+	cache.lodBvhs.clear();
+	cache.lodBvhPosed.clear();
+
+	// level 0 is the full mesh as flattened.
+	Mesh level0;
+	level0.FaceIndex_Data = cache.mesh.FaceIndex_Data;
+	level0.numTris = cache.mesh.numTris;
+	level0.MeshFace_Offsets = cache.mesh.MeshFace_Offsets;
+	cache.lods.push_back(std::move(level0));
+
+	if (levels > 1) {
+		// simplification works on the welded index buffer, otherwise split vertices (ie. from mikktspace) look like open edges.
+		std::vector<int32_t> welded = weld_remap(cache.mesh);
+		std::vector<int32_t> indices = cache.mesh.FaceIndex_Data;
+		for (int32_t& index : indices) {
+			index = welded[index];
+		}
+
+		for (int level = 1; level < levels; level++) {
+			TraceScope span("simplify");
+			size_t targetTris = (size_t)(indices.size() / 3 * ratio);
+			indices = simplify_mesh(indices, cache.mesh, targetTris, options);
+			cache.lods.push_back(compact_mesh(cache.mesh, indices));
+		}
+	}
+
+	for (size_t level = 0; level < cache.lods.size(); level++) {
+		Mesh& lod = cache.lods[level];
+		const Mesh& vertexData = level == 0 ? cache.mesh : lod;
+		int vertexCount = (int)vertexData.Position_Data.size();
+
+		std::array<float, 4> stats = { 0, 0, 0, 0 };
+
+		if (overdrawStats) {
+			stats[0] = compute_acmr(lod.FaceIndex_Data, vertexCount);
+			stats[2] = analyze_overdraw(lod.FaceIndex_Data, vertexData.Position_Data).overdraw;
+		}
+
+		// ordering is done per source mesh, so the triangles of a mesh stay together for the meshlets and groups.
+		if (overdrawOrdering) {
+			int meshCount = (int)lod.MeshFace_Offsets.size() - 1;
+			parallel_for(meshCount, [&](int meshId) {
+				auto first = lod.FaceIndex_Data.begin() + lod.MeshFace_Offsets[meshId] * 3;
+				auto last = lod.FaceIndex_Data.begin() + lod.MeshFace_Offsets[meshId + 1] * 3;
+				std::vector<int32_t> meshIndices(first, last);
+				optimize_overdraw(meshIndices, vertexData.Position_Data, overdrawThreshold);
+				std::copy(meshIndices.begin(), meshIndices.end(), first);
+			});
+		}
+
+		if (overdrawStats) {
+			stats[1] = compute_acmr(lod.FaceIndex_Data, vertexCount);
+			stats[3] = analyze_overdraw(lod.FaceIndex_Data, vertexData.Position_Data).overdraw;
+		}
+
+		cache.lodStats.push_back(stats);
+
+		std::vector<Meshlet> meshlets;
+		std::vector<int32_t> pointClusters;
+		if (maxMeshletVertices > 0) {
+			build_meshlets(meshlets, pointClusters, lod.FaceIndex_Data, vertexData.Position_Data, lod.MeshFace_Offsets, maxMeshletVertices, maxMeshletTriangles);
+		}
+		cache.lodMeshlets.push_back(std::move(meshlets));
+		cache.lodPointClusters.push_back(std::move(pointClusters));
+	}
+
+	cache.lodBvhs.resize(cache.lods.size());
+	cache.lodBvhPosed.resize(cache.lods.size());
+}
+
+// after the vertices of the cached mesh were replaced in place (a sequence frame with the same topology), copies them
+// into the compacted LOD levels and refreshes everything that depends on positions, but keeps all the index buffers.
+// the overdraw stats are left as measured on the first frame.
+void update_lod_vertices(MeshCache& cache) {
+	const Mesh& mesh = cache.mesh;
+	bool hasTbnQuat = mesh.TbnQuat_Data.size() == mesh.Position_Data.size() * 4;
+
+	for (size_t level = 1; level < cache.lods.size(); level++) {
+		Mesh& lod = cache.lods[level];
+		parallel_for((int)lod.SourceVertex_Data.size(), [&](int v) {
+			int32_t source = lod.SourceVertex_Data[v];
+			lod.Position_Data[v] = mesh.Position_Data[source];
+			lod.Normal_Data[v] = mesh.Normal_Data[source];
+			std::copy(&mesh.Tangent_Data[source * 4], &mesh.Tangent_Data[source * 4] + 4, &lod.Tangent_Data[v * 4]);
+			std::copy(&mesh.Bitangent_Data[source * 3], &mesh.Bitangent_Data[source * 3] + 3, &lod.Bitangent_Data[v * 3]);
+			if (hasTbnQuat) {
+				std::copy(&mesh.TbnQuat_Data[source * 4], &mesh.TbnQuat_Data[source * 4] + 4, &lod.TbnQuat_Data[v * 4]);
+			}
+		});
+	}
+
+	for (size_t level = 0; level < cache.lods.size(); level++) {
+		const Mesh& vertexData = level == 0 ? mesh : cache.lods[level];
+		for (Meshlet& meshlet : cache.lodMeshlets[level]) {
+			meshlet_bounds(meshlet, cache.lods[level].FaceIndex_Data, vertexData.Position_Data);
+		}
+	}
+
+	// the bvhs are rebuilt when the next query needs them, the deformed copies on the next cook.
+	cache.lodBvhs.assign(cache.lods.size(), Bvh());
+	cache.lodBvhPosed.assign(cache.lods.size(), 0);
+	cache.morphed.key.clear();
+	cache.animated.key.clear();
+}
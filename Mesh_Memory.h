@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "DataAndTypes.h"
+#include "Mesh_Cache.h"
+
+/*
+Memory accounting, so the Info CHOP can tell which sop holds how much, and the Memory Budget can be enforced.
+
+Sizes are vector capacities, what is actually allocated, not what is in use. the aiScene is only alive during an import,
+so it counts towards the peak but not the current total, its size is assimp's own estimate (Importer::GetMemoryRequirements).
+the sequence cache is memory mapped, the os pages it in and out as it likes, so it isn't counted.
+*/
+
+template <typename T>
+size_t vector_bytes(const std::vector<T>& values) {
+	return values.capacity() * sizeof(T);
+}
+
+size_t strings_bytes(const std::vector<std::string>& values) {
+	size_t bytes = vector_bytes(values);
+	for (const std::string& value : values) {
+		bytes += value.capacity() > 15 ? value.capacity() + 1 : 0; // short strings live inside std::string.
+	}
+	return bytes;
+}
+
+size_t morph_targets_bytes(const std::vector<MorphTarget>& targets) {
+	size_t bytes = vector_bytes(targets);
+	for (const MorphTarget& target : targets) {
+		bytes += vector_bytes(target.vertices) + vector_bytes(target.positionDeltas) + vector_bytes(target.normalDeltas);
+	}
+	return bytes;
+}
+
+size_t mesh_bytes(const Mesh& mesh) {
+	size_t bytes = vector_bytes(mesh.Position_Data) + vector_bytes(mesh.Normal_Data) + vector_bytes(mesh.Uv_Data)
+		+ vector_bytes(mesh.Color_Data) + vector_bytes(mesh.Tangent_Data) + vector_bytes(mesh.Bitangent_Data)
+		+ vector_bytes(mesh.TbnQuat_Data) + vector_bytes(mesh.FaceIndex_Data) + vector_bytes(mesh.MeshId_Data)
+		+ vector_bytes(mesh.MeshFace_Offsets) + vector_bytes(mesh.JointIndex_Data) + vector_bytes(mesh.JointWeight_Data)
+		+ vector_bytes(mesh.SourceVertex_Data) + strings_bytes(mesh.NodeName_Data) + strings_bytes(mesh.MeshName_Data)
+		+ vector_bytes(mesh.Instance_Data) + morph_targets_bytes(mesh.morphTargets);
+
+	const Skeleton& skeleton = mesh.skeleton;
+	bytes += strings_bytes(skeleton.nodeNames) + vector_bytes(skeleton.nodeParents) + vector_bytes(skeleton.nodeLocals)
+		+ vector_bytes(skeleton.jointNodes) + vector_bytes(skeleton.jointBinds) + vector_bytes(skeleton.meshNodes)
+		+ vector_bytes(skeleton.instanceNodes);
+
+	bytes += vector_bytes(mesh.animations);
+	for (const Animation& animation : mesh.animations) {
+		bytes += vector_bytes(animation.channels);
+		for (const AnimationChannel& channel : animation.channels) {
+			bytes += vector_bytes(channel.positionTimes) + vector_bytes(channel.positions) + vector_bytes(channel.rotationTimes)
+				+ vector_bytes(channel.rotations) + vector_bytes(channel.scaleTimes) + vector_bytes(channel.scales);
+		}
+	}
+	return bytes;
+}
+
+// fills in what the cache holds, per pool (MemoryMesh, MemoryLods, MemoryDeform, MemoryBvh). the other pools are left alone.
+void cache_memory(const MeshCache& cache, size_t* bytes) {
+	bytes[MemoryMesh] = mesh_bytes(cache.mesh);
+
+	size_t lods = vector_bytes(cache.lods) + vector_bytes(cache.lodStats) + vector_bytes(cache.lodMeshlets) + vector_bytes(cache.lodPointClusters);
+	for (const Mesh& lod : cache.lods) {
+		lods += mesh_bytes(lod);
+	}
+	for (size_t level = 0; level < cache.lodMeshlets.size(); level++) {
+		lods += vector_bytes(cache.lodMeshlets[level]);
+	}
+	for (size_t level = 0; level < cache.lodPointClusters.size(); level++) {
+		lods += vector_bytes(cache.lodPointClusters[level]);
+	}
+	bytes[MemoryLods] = lods;
+
+	const MorphedMesh& morphed = cache.morphed;
+	const AnimatedMesh& animated = cache.animated;
+	bytes[MemoryDeform] = vector_bytes(cache.sampler.cursors)
+		+ mesh_bytes(morphed.mesh) + morph_targets_bytes(morphed.targets) + vector_bytes(morphed.slotVertices)
+		+ vector_bytes(morphed.accumulators) + vector_bytes(morphed.weights)
+		+ mesh_bytes(animated.mesh) + vector_bytes(animated.vertexOffsets) + vector_bytes(animated.appliedWorlds) + vector_bytes(animated.restWorlds);
+
+	size_t bvhs = vector_bytes(cache.lodBvhs);
+	for (const Bvh& bvh : cache.lodBvhs) {
+		bvhs += vector_bytes(bvh.nodes) + vector_bytes(bvh.triangles) + vector_bytes(bvh.vertices);
+	}
+	bytes[MemoryBvh] = bvhs;
+}
+
+// the filament attribute buffers emit_mesh expands into, they keep their capacity between cooks.
+size_t filament_scratch_bytes(const FilamentScratch& scratch) {
+	return vector_bytes(scratch.expandedPositions) + vector_bytes(scratch.expandedColors) + vector_bytes(scratch.expandedUvs0)
+		+ vector_bytes(scratch.debugging);
+}
+
+void release_filament_scratch(FilamentScratch& scratch) {
+	scratch = FilamentScratch();
+}
+
+// everything but the scene, which is gone by the time anyone asks.
+size_t memory_held(const size_t* bytes) {
+	size_t total = 0;
+	for (int pool = 0; pool < NumMemoryPools; pool++) {
+		total += pool == MemoryScene ? 0 : bytes[pool];
+	}
+	return total;
+}
+
+std::string memory_mb_string(size_t bytes) {
+	char text[32];
+	snprintf(text, sizeof(text), "%.1f MB", bytes / (1024.0 * 1024.0));
+	return text;
+}
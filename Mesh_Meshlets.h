@@ -0,0 +1,191 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+#include "DataAndTypes.h"
+#include "Parallel.h"
+
+/*
+Meshlet (cluster) builder, for GPU driven culling in custom glsl pipelines.
+
+The index buffer of each source mesh is scanned in order and cut into meshlets whenever the next triangle would push the
+meshlet over the vertex or triangle limit. Since the index buffer is already in vertex cache order (ImproveCacheLocality),
+this keeps meshlets spatially coherent, and it means every meshlet is a contiguous range of primitives in the sop.
+
+Every meshlet gets a bounding sphere and a normal cone. The cone follows meshoptimizer's convention, a meshlet can be
+backface culled when:
+	dot(center - cameraPosition, coneAxis) >= coneCutoff * length(center - cameraPosition) + radius
+a coneCutoff of 1 means the normals are spread too wide to ever cull the meshlet.
+*/
+
+struct Meshlet {
+	int32_t meshId = 0; // source mesh the meshlet belongs to.
+	int32_t triangleOffset = 0; // first primitive of the meshlet.
+	int32_t triangleCount = 0;
+	int32_t vertexCount = 0;
+	float center[3] = { 0, 0, 0 };
+	float radius = 0;
+	float coneAxis[3] = { 0, 0, 0 };
+	float coneCutoff = 1;
+};
+
+// fills in the bounding sphere and normal cone of a meshlet from its triangles.
+void meshlet_bounds(Meshlet& meshlet, const std::vector<int32_t>& indices, const std::vector<Position>& positions) {
+	float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	float axis[3] = { 0, 0, 0 };
+
+	int start = meshlet.triangleOffset * 3;
+	int end = (meshlet.triangleOffset + meshlet.triangleCount) * 3;
+
+	std::vector<float> normals;
+	normals.reserve(meshlet.triangleCount * 3);
+
+	for (int i = start; i < end; i += 3) {
+		const Position& p0 = positions[indices[i + 0]];
+		const Position& p1 = positions[indices[i + 1]];
+		const Position& p2 = positions[indices[i + 2]];
+
+		const Position* p[3] = { &p0, &p1, &p2 };
+		for (int k = 0; k < 3; k++) {
+			minP[0] = std::min(minP[0], p[k]->x); maxP[0] = std::max(maxP[0], p[k]->x);
+			minP[1] = std::min(minP[1], p[k]->y); maxP[1] = std::max(maxP[1], p[k]->y);
+			minP[2] = std::min(minP[2], p[k]->z); maxP[2] = std::max(maxP[2], p[k]->z);
+		}
+
+		float e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+		float e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+		float n[3];
+		cross(e1, e2, n);
+		float area = length(n);
+		if (area == 0) {
+			continue;
+		}
+
+		// axis is area weighted, the per triangle normals used for the cutoff are not.
+		axis[0] += n[0]; axis[1] += n[1]; axis[2] += n[2];
+		normals.push_back(n[0] / area);
+		normals.push_back(n[1] / area);
+		normals.push_back(n[2] / area);
+	}
+
+	// sphere around the center of the bounds, cheap and tight enough for culling.
+	meshlet.center[0] = (minP[0] + maxP[0]) * 0.5f;
+	meshlet.center[1] = (minP[1] + maxP[1]) * 0.5f;
+	meshlet.center[2] = (minP[2] + maxP[2]) * 0.5f;
+
+	float radius2 = 0;
+	for (int i = start; i < end; i++) {
+		const Position& p = positions[indices[i]];
+		float d[3] = { p.x - meshlet.center[0], p.y - meshlet.center[1], p.z - meshlet.center[2] };
+		radius2 = std::max(radius2, dot(d, d));
+	}
+	meshlet.radius = std::sqrt(radius2);
+
+	float axisLength = length(axis);
+	if (axisLength == 0 || normals.empty()) {
+		meshlet.coneCutoff = 1;
+		return;
+	}
+	meshlet.coneAxis[0] = axis[0] / axisLength;
+	meshlet.coneAxis[1] = axis[1] / axisLength;
+	meshlet.coneAxis[2] = axis[2] / axisLength;
+
+	// the widest normal decides the cone angle.
+	float minDot = 1;
+	for (size_t i = 0; i < normals.size(); i += 3) {
+		minDot = std::min(minDot, dot(meshlet.coneAxis, &normals[i]));
+	}
+
+	// if the normals spread over more than ~85 degrees from the axis, the cone is useless for culling.
+	if (minDot <= 0.1f) {
+		meshlet.coneCutoff = 1;
+		return;
+	}
+
+	// cos(angle + 90) expressed with the spread, so the test above is a plain dot product on the gpu.
+	meshlet.coneCutoff = std::sqrt(1 - minDot * minDot);
+}
+
+// builds meshlets for every source mesh in parallel. meshFaceOffsets gives the triangle range of each source mesh in indices.
+// pointClusters gets the id of the (first) meshlet that uses each point, since a point shared by two meshlets can only hold one.
+void build_meshlets(std::vector<Meshlet>& meshlets, std::vector<int32_t>& pointClusters,
+	const std::vector<int32_t>& indices, const std::vector<Position>& positions, const std::vector<int>& meshFaceOffsets,
+	int maxVertices, int maxTriangles) {
+
+	int meshCount = (int)meshFaceOffsets.size() - 1;
+	std::vector<std::vector<Meshlet>> perMesh(std::max(meshCount, 0));
+
+	maxVertices = std::max(maxVertices, 3);
+	maxTriangles = std::max(maxTriangles, 1);
+
+	parallel_for(meshCount, [&](int meshId) {
+		std::vector<Meshlet>& result = perMesh[meshId];
+
+		// small local list of the vertices in the current meshlet, linear search is fine at these sizes.
+		std::vector<int32_t> used;
+		used.reserve(maxVertices);
+
+		Meshlet current;
+		current.meshId = meshId;
+		current.triangleOffset = meshFaceOffsets[meshId];
+
+		for (int tri = meshFaceOffsets[meshId]; tri < meshFaceOffsets[meshId + 1]; tri++) {
+			int newVertices = 0;
+			for (int k = 0; k < 3; k++) {
+				int32_t v = indices[tri * 3 + k];
+				if (std::find(used.begin(), used.end(), v) == used.end()) {
+					newVertices++;
+				}
+			}
+
+			// flush the current meshlet if this triangle doesn't fit.
+			if (current.triangleCount > 0 && ((int)used.size() + newVertices > maxVertices || current.triangleCount + 1 > maxTriangles)) {
+				current.vertexCount = (int32_t)used.size();
+				result.push_back(current);
+
+				current = Meshlet();
+				current.meshId = meshId;
+				current.triangleOffset = tri;
+				used.clear();
+			}
+
+			for (int k = 0; k < 3; k++) {
+				int32_t v = indices[tri * 3 + k];
+				if (std::find(used.begin(), used.end(), v) == used.end()) {
+					used.push_back(v);
+				}
+			}
+			current.triangleCount++;
+		}
+
+		if (current.triangleCount > 0) {
+			current.vertexCount = (int32_t)used.size();
+			result.push_back(current);
+		}
+
+		for (Meshlet& meshlet : result) {
+			meshlet_bounds(meshlet, indices, positions);
+		}
+	});
+
+	meshlets.clear();
+	for (const std::vector<Meshlet>& meshMeshlets : perMesh) {
+		meshlets.insert(meshlets.end(), meshMeshlets.begin(), meshMeshlets.end());
+	}
+
+	// points are never shared between source meshes, so this could be done per mesh too, but it's a cheap linear pass.
+	pointClusters.assign(positions.size(), -1);
+	for (int cluster = 0; cluster < (int)meshlets.size(); cluster++) {
+		const Meshlet& meshlet = meshlets[cluster];
+		for (int i = meshlet.triangleOffset * 3; i < (meshlet.triangleOffset + meshlet.triangleCount) * 3; i++) {
+			if (pointClusters[indices[i]] == -1) {
+				pointClusters[indices[i]] = cluster;
+			}
+		}
+	}
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+#include "DataAndTypes.h"
+#include "Mesh_Transform.h"
+
+/*
+Morph targets (blendshapes).
+
+flatten_scene turns every aiAnimMesh into a sparse MorphTarget: the flattened vertices it moves, with their position and
+normal deltas in world space (aiAnimMesh stores replacement positions, the delta is taken against the base mesh). targets
+with the same name on different meshes (ie. a face and its teeth) are merged, so one weight drives both.
+
+Every cook the weights are compared against the last ones. only the vertices of targets that have, or had, a non zero
+weight are reset to the rest data and re-accumulated, zero weight targets are skipped entirely. the accumulation is
+4 wide sse, one op per vertex for the positions and one for the normals.
+*/
+
+// deltas smaller than this are treated as not moving the vertex.
+const float kMorphEpsilon = 1e-7f;
+
+// builds the world space deltas of one aiAnimMesh of an instance. vtxStart is the first vertex of the instance in the
+// flattened mesh, whose (already transformed) normals the normal deltas are taken against.
+void gather_morph_deltas(const aiMesh* source, const aiAnimMesh* animMesh, const MeshInstance& instance, const unsigned int* gather,
+	int numVerts, int vtxStart, const Mesh& mesh, MorphTarget& target) {
+
+	if (!animMesh->HasPositions() || animMesh->mNumVertices != source->mNumVertices) {
+		return;
+	}
+	bool hasNormals = animMesh->HasNormals() && source->HasNormals();
+
+	const float* w = instance.world;
+	const float* n = instance.normalMatrix;
+	for (int v = 0; v < numVerts; v++) {
+		unsigned int i = gather ? gather[v] : v;
+
+		aiVector3D d = animMesh->mVertices[i] - source->mVertices[i];
+		float position[3] = {
+			w[0] * d.x + w[4] * d.y + w[8] * d.z,
+			w[1] * d.x + w[5] * d.y + w[9] * d.z,
+			w[2] * d.x + w[6] * d.y + w[10] * d.z,
+		};
+
+		float normal[3] = { 0, 0, 0 };
+		if (hasNormals) {
+			const aiVector3D& m = animMesh->mNormals[i];
+			float morphed[3] = {
+				n[0] * m.x + n[3] * m.y + n[6] * m.z,
+				n[1] * m.x + n[4] * m.y + n[7] * m.z,
+				n[2] * m.x + n[5] * m.y + n[8] * m.z,
+			};
+			float len = std::sqrt(morphed[0] * morphed[0] + morphed[1] * morphed[1] + morphed[2] * morphed[2]);
+			if (len > 0) {
+				const Vector& base = mesh.Normal_Data[vtxStart + v];
+				normal[0] = morphed[0] / len - base.x;
+				normal[1] = morphed[1] / len - base.y;
+				normal[2] = morphed[2] / len - base.z;
+			}
+		}
+
+		float size = std::fabs(position[0]) + std::fabs(position[1]) + std::fabs(position[2])
+			+ std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+		if (size <= kMorphEpsilon) {
+			continue;
+		}
+
+		target.vertices.push_back(vtxStart + v);
+		target.positionDeltas.insert(target.positionDeltas.end(), { position[0], position[1], position[2], 0.0f });
+		target.normalDeltas.insert(target.normalDeltas.end(), { normal[0], normal[1], normal[2], 0.0f });
+	}
+}
+
+// the morphed copy of an output mesh. targets are remapped to slots, one per vertex moved by any target, so the
+// accumulators only cover those vertices.
+struct MorphedMesh {
+	std::string key; // lod key and lod the copy was made for, empty if it has to be rebuilt.
+	Mesh mesh;
+	std::vector<MorphTarget> targets; // vertices are slots here, not vertex indices.
+	std::vector<int32_t> slotVertices; // output mesh vertex of every slot.
+	std::vector<float> accumulators; // 8 per slot, position xyz_ then normal xyz_.
+	std::vector<float> weights; // weights of the last update.
+
+	void clear() {
+		key.clear();
+		mesh = Mesh();
+		targets.clear();
+		slotVertices.clear();
+		accumulators.clear();
+		weights.clear();
+	}
+};
+
+// makes a fresh morphed copy of rest, with the targets of the flattened mesh remapped to rest's vertices.
+// rest is either the flattened mesh itself, or a compacted mesh (LOD, preview) that knows its SourceVertex_Data.
+void morphed_mesh_reset(MorphedMesh& morphed, const Mesh& rest, const std::vector<MorphTarget>& targets, const std::string& key) {
+	morphed.clear();
+	morphed.key = key;
+	morphed.mesh = rest;
+
+	// flattened vertex -> rest vertex, only needed for compacted meshes.
+	std::vector<int32_t> remap;
+	if (!rest.SourceVertex_Data.empty()) {
+		int32_t maxSource = 0;
+		for (int32_t source : rest.SourceVertex_Data) {
+			maxSource = std::max(maxSource, source);
+		}
+		remap.assign(maxSource + 1, -1);
+		for (int32_t v = 0; v < (int32_t)rest.SourceVertex_Data.size(); v++) {
+			remap[rest.SourceVertex_Data[v]] = v;
+		}
+	}
+
+	std::vector<int32_t> vertexSlots(rest.Position_Data.size(), -1);
+	for (const MorphTarget& target : targets) {
+		MorphTarget local;
+		local.name = target.name;
+		local.defaultWeight = target.defaultWeight;
+		for (size_t i = 0; i < target.vertices.size(); i++) {
+			int32_t v = target.vertices[i];
+			if (!remap.empty()) {
+				v = v < (int32_t)remap.size() ? remap[v] : -1;
+			}
+			if (v < 0 || v >= (int32_t)vertexSlots.size()) {
+				continue; // dropped by the LOD.
+			}
+			if (vertexSlots[v] == -1) {
+				vertexSlots[v] = (int32_t)morphed.slotVertices.size();
+				morphed.slotVertices.push_back(v);
+			}
+			local.vertices.push_back(vertexSlots[v]);
+			local.positionDeltas.insert(local.positionDeltas.end(), &target.positionDeltas[i * 4], &target.positionDeltas[i * 4] + 4);
+			local.normalDeltas.insert(local.normalDeltas.end(), &target.normalDeltas[i * 4], &target.normalDeltas[i * 4] + 4);
+		}
+		morphed.targets.push_back(std::move(local));
+	}
+
+	morphed.accumulators.assign(morphed.slotVertices.size() * 8, 0.0f);
+	morphed.weights.assign(targets.size(), 0.0f);
+}
+
+// applies new weights to the morphed copy. dirtyMeshes is set for every source mesh that had vertices rewritten.
+// returns false if the weights didn't change, and nothing was touched.
+bool morphed_mesh_update(MorphedMesh& morphed, const Mesh& rest, const std::vector<float>& weights, std::vector<char>& dirtyMeshes) {
+	if (weights == morphed.weights) {
+		return false;
+	}
+
+	int numTargets = (int)morphed.targets.size();
+	std::vector<char> active(numTargets);
+	for (int t = 0; t < numTargets; t++) {
+		active[t] = weights[t] != 0 || morphed.weights[t] != 0;
+	}
+
+	// reset the vertices of every target that is or was active to the rest data.
+	for (int t = 0; t < numTargets; t++) {
+		if (!active[t]) {
+			continue;
+		}
+		for (int32_t slot : morphed.targets[t].vertices) {
+			const Position& p = rest.Position_Data[morphed.slotVertices[slot]];
+			const Vector& n = rest.Normal_Data[morphed.slotVertices[slot]];
+			float* acc = &morphed.accumulators[slot * 8];
+			acc[0] = p.x; acc[1] = p.y; acc[2] = p.z; acc[3] = 0;
+			acc[4] = n.x; acc[5] = n.y; acc[6] = n.z; acc[7] = 0;
+		}
+	}
+
+	// accumulate the non zero targets.
+	for (int t = 0; t < numTargets; t++) {
+		float weight = weights[t];
+		if (weight == 0) {
+			continue;
+		}
+		const MorphTarget& target = morphed.targets[t];
+		int count = (int)target.vertices.size();
+		const float* positionDeltas = target.positionDeltas.data();
+		const float* normalDeltas = target.normalDeltas.data();
+
+#ifdef TDASSIMP_SSE
+		__m128 w = _mm_set1_ps(weight);
+		for (int i = 0; i < count; i++) {
+			float* acc = &morphed.accumulators[target.vertices[i] * 8];
+			_mm_storeu_ps(acc, _mm_add_ps(_mm_loadu_ps(acc), _mm_mul_ps(w, _mm_loadu_ps(positionDeltas + i * 4))));
+			_mm_storeu_ps(acc + 4, _mm_add_ps(_mm_loadu_ps(acc + 4), _mm_mul_ps(w, _mm_loadu_ps(normalDeltas + i * 4))));
+		}
+#else
+		for (int i = 0; i < count; i++) {
+			float* acc = &morphed.accumulators[target.vertices[i] * 8];
+			for (int k = 0; k < 4; k++) {
+				acc[k] += weight * positionDeltas[i * 4 + k];
+				acc[4 + k] += weight * normalDeltas[i * 4 + k];
+			}
+		}
+#endif
+	}
+
+	// write the touched vertices back, normals renormalized.
+	Mesh& mesh = morphed.mesh;
+	bool hasTbnQuat = mesh.TbnQuat_Data.size() == mesh.Position_Data.size() * 4 && mesh.Bitangent_Data.size() == mesh.Position_Data.size() * 3;
+	for (int t = 0; t < numTargets; t++) {
+		if (!active[t]) {
+			continue;
+		}
+		for (int32_t slot : morphed.targets[t].vertices) {
+			int32_t v = morphed.slotVertices[slot];
+			const float* acc = &morphed.accumulators[slot * 8];
+			mesh.Position_Data[v] = Position(acc[0], acc[1], acc[2]);
+
+			float len = std::sqrt(acc[4] * acc[4] + acc[5] * acc[5] + acc[6] * acc[6]);
+			mesh.Normal_Data[v] = len > 0 ? Vector(acc[4] / len, acc[5] / len, acc[6] / len) : rest.Normal_Data[v];
+
+			// the targets only move the normal, the rest tangent is turned to follow it.
+			if (hasTbnQuat) {
+				const Vector& morphedNormal = mesh.Normal_Data[v];
+				float normal[3] = { morphedNormal.x, morphedNormal.y, morphedNormal.z };
+				orthogonal_tbn_to_quat(normal, &mesh.Tangent_Data[v * 4], &mesh.Bitangent_Data[v * 3], &mesh.TbnQuat_Data[v * 4]);
+			}
+
+			int32_t meshId = mesh.MeshId_Data[v];
+			if (meshId < (int32_t)dirtyMeshes.size()) {
+				dirtyMeshes[meshId] = 1;
+			}
+		}
+	}
+
+	morphed.weights = weights;
+	return true;
+}
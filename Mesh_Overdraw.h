@@ -0,0 +1,339 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+#include "DataAndTypes.h"
+
+/*
+Overdraw aware triangle ordering, based on the "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+paper by Sander, Nehab and Barczak (tipsify is what assimp's ImproveCacheLocality step is roughly based on, this is
+the second half of that paper).
+
+The idea is pretty simple:
+1. simulate a post transform vertex cache over the final index buffer, and cut it up into clusters wherever the cache
+   would be flushed anyways (hard boundaries), and again wherever the running ACMR of the cluster is within the
+   tolerance of that clusters ACMR (soft boundaries). the tolerance is what lets the user trade cache efficiency for overdraw.
+2. sort the clusters so the ones that face "outwards" from the center of the mesh get drawn first, since from most
+   viewpoints those are the ones that will occlude the rest of the mesh.
+
+The small cpu rasterizer at the bottom is used to measure the overdraw from the 6 axis aligned view directions,
+so we can report before/after numbers to the info chop without needing a GPU.
+*/
+
+// size of the fifo cache we simulate, 16 is a reasonable middle ground for most modern hardware.
+const int kOverdrawCacheSize = 16;
+
+// resolution of the cpu rasterizer used to measure overdraw.
+const int kOverdrawViewport = 256;
+
+struct OverdrawStats {
+	unsigned int pixelsCovered = 0; // number of pixels that had at least one fragment written.
+	unsigned int pixelsShaded = 0; // number of fragments that passed the depth test.
+	float overdraw = 0; // pixelsShaded / pixelsCovered, 1.0 is perfect.
+};
+
+// returns the number of cache misses that this triangle causes, and updates the simulated cache timestamps.
+unsigned int overdraw_update_cache(int32_t a, int32_t b, int32_t c, std::vector<unsigned int>& cacheTimestamps, unsigned int& timestamp) {
+	unsigned int misses = 0;
+	int32_t tri[3] = { a, b, c };
+
+	for (int i = 0; i < 3; i++) {
+		// if the vertex was not used in the last kOverdrawCacheSize misses, it is no longer in the fifo.
+		if (timestamp - cacheTimestamps[tri[i]] > kOverdrawCacheSize) {
+			cacheTimestamps[tri[i]] = timestamp++;
+			misses++;
+		}
+	}
+
+	return misses;
+}
+
+// average cache miss ratio, ie. number of vertex shader invocations per triangle. 0.5 is ideal for a regular grid, 3.0 is the worst case.
+float compute_acmr(const std::vector<int32_t>& indices, int vertexCount) {
+	int faceCount = (int)indices.size() / 3;
+	if (faceCount == 0) {
+		return 0;
+	}
+
+	std::vector<unsigned int> cacheTimestamps(vertexCount, 0);
+	unsigned int timestamp = kOverdrawCacheSize + 1;
+	unsigned int misses = 0;
+
+	for (int i = 0; i < faceCount; i++) {
+		misses += overdraw_update_cache(indices[i * 3 + 0], indices[i * 3 + 1], indices[i * 3 + 2], cacheTimestamps, timestamp);
+	}
+
+	return (float)misses / (float)faceCount;
+}
+
+// hard boundaries are triangles where all 3 vertices miss the cache, which usually means we jumped to a new patch of the mesh.
+// returns the start triangle of each cluster, with a trailing entry equal to the face count.
+std::vector<int> overdraw_hard_boundaries(const std::vector<int32_t>& indices, int vertexCount) {
+	int faceCount = (int)indices.size() / 3;
+
+	std::vector<int> clusters;
+	std::vector<unsigned int> cacheTimestamps(vertexCount, 0);
+	unsigned int timestamp = kOverdrawCacheSize + 1;
+
+	for (int i = 0; i < faceCount; i++) {
+		unsigned int misses = overdraw_update_cache(indices[i * 3 + 0], indices[i * 3 + 1], indices[i * 3 + 2], cacheTimestamps, timestamp);
+
+		if (i == 0 || misses == 3) {
+			clusters.push_back(i);
+		}
+	}
+
+	clusters.push_back(faceCount);
+	return clusters;
+}
+
+// soft boundaries split the hard clusters further, whenever the running ACMR of the cluster is within threshold of the clusters own ACMR.
+// a threshold of 1.0 keeps the cache efficiency intact, larger values allow more (smaller) clusters which sort better.
+std::vector<int> overdraw_soft_boundaries(const std::vector<int32_t>& indices, int vertexCount, const std::vector<int>& hardClusters, float threshold) {
+	std::vector<int> clusters;
+	std::vector<unsigned int> cacheTimestamps(vertexCount, 0);
+	unsigned int timestamp = 0;
+
+	for (size_t it = 0; it + 1 < hardClusters.size(); it++) {
+		int start = hardClusters[it];
+		int end = hardClusters[it + 1];
+
+		// measure the ACMR of the whole cluster with a cold cache.
+		timestamp += kOverdrawCacheSize + 1;
+		unsigned int clusterMisses = 0;
+		for (int i = start; i < end; i++) {
+			clusterMisses += overdraw_update_cache(indices[i * 3 + 0], indices[i * 3 + 1], indices[i * 3 + 2], cacheTimestamps, timestamp);
+		}
+		float clusterThreshold = threshold * ((float)clusterMisses / (float)(end - start));
+
+		// now walk it again, and cut a new cluster every time the running ACMR is good enough.
+		clusters.push_back(start);
+		timestamp += kOverdrawCacheSize + 1;
+		unsigned int runningMisses = 0;
+		unsigned int runningFaces = 0;
+
+		for (int i = start; i < end; i++) {
+			runningMisses += overdraw_update_cache(indices[i * 3 + 0], indices[i * 3 + 1], indices[i * 3 + 2], cacheTimestamps, timestamp);
+			runningFaces += 1;
+
+			if ((float)runningMisses / (float)runningFaces <= clusterThreshold && i + 1 < end) {
+				clusters.push_back(i + 1);
+
+				// each new cluster starts with a cold cache, since that's what happens when they get reordered.
+				timestamp += kOverdrawCacheSize + 1;
+				runningMisses = 0;
+				runningFaces = 0;
+			}
+		}
+	}
+
+	clusters.push_back((int)indices.size() / 3);
+	return clusters;
+}
+
+// reorders the triangles in indices in place to reduce overdraw. positions are indexed by the values in indices.
+// threshold is the ACMR tolerance, ie. 1.05 allows the ACMR to get up to 5% worse in exchange for less overdraw.
+void optimize_overdraw(std::vector<int32_t>& indices, const std::vector<Position>& positions, float threshold) {
+	int faceCount = (int)indices.size() / 3;
+	int vertexCount = (int)positions.size();
+	if (faceCount == 0) {
+		return;
+	}
+
+	std::vector<int> hardClusters = overdraw_hard_boundaries(indices, vertexCount);
+	std::vector<int> clusters = overdraw_soft_boundaries(indices, vertexCount, hardClusters, std::max(threshold, 1.0f));
+	int clusterCount = (int)clusters.size() - 1;
+
+	// area weighted centroid of the whole mesh, this is what we measure "outwards" against.
+	double meshCentroid[3] = { 0, 0, 0 };
+	double meshArea = 0;
+
+	// per cluster, area weighted centroid and summed (area weighted) normal.
+	std::vector<float> clusterData(clusterCount * 6, 0.0f);
+
+	for (int cluster = 0; cluster < clusterCount; cluster++) {
+		double clusterCentroid[3] = { 0, 0, 0 };
+		double clusterNormal[3] = { 0, 0, 0 };
+		double clusterArea = 0;
+
+		for (int i = clusters[cluster]; i < clusters[cluster + 1]; i++) {
+			const Position& p0 = positions[indices[i * 3 + 0]];
+			const Position& p1 = positions[indices[i * 3 + 1]];
+			const Position& p2 = positions[indices[i * 3 + 2]];
+
+			float e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+			float e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+			float n[3];
+			cross(e1, e2, n);
+			float area = length(n);
+
+			clusterCentroid[0] += (p0.x + p1.x + p2.x) * (area / 3);
+			clusterCentroid[1] += (p0.y + p1.y + p2.y) * (area / 3);
+			clusterCentroid[2] += (p0.z + p1.z + p2.z) * (area / 3);
+			clusterNormal[0] += n[0];
+			clusterNormal[1] += n[1];
+			clusterNormal[2] += n[2];
+			clusterArea += area;
+		}
+
+		meshCentroid[0] += clusterCentroid[0];
+		meshCentroid[1] += clusterCentroid[1];
+		meshCentroid[2] += clusterCentroid[2];
+		meshArea += clusterArea;
+
+		double inverseArea = clusterArea == 0 ? 0 : 1.0 / clusterArea;
+		double normalLength = std::sqrt(clusterNormal[0] * clusterNormal[0] + clusterNormal[1] * clusterNormal[1] + clusterNormal[2] * clusterNormal[2]);
+		double inverseNormalLength = normalLength == 0 ? 0 : 1.0 / normalLength;
+
+		clusterData[cluster * 6 + 0] = (float)(clusterCentroid[0] * inverseArea);
+		clusterData[cluster * 6 + 1] = (float)(clusterCentroid[1] * inverseArea);
+		clusterData[cluster * 6 + 2] = (float)(clusterCentroid[2] * inverseArea);
+		clusterData[cluster * 6 + 3] = (float)(clusterNormal[0] * inverseNormalLength);
+		clusterData[cluster * 6 + 4] = (float)(clusterNormal[1] * inverseNormalLength);
+		clusterData[cluster * 6 + 5] = (float)(clusterNormal[2] * inverseNormalLength);
+	}
+
+	double inverseMeshArea = meshArea == 0 ? 0 : 1.0 / meshArea;
+	float center[3] = { (float)(meshCentroid[0] * inverseMeshArea), (float)(meshCentroid[1] * inverseMeshArea), (float)(meshCentroid[2] * inverseMeshArea) };
+
+	// sort key is how far the cluster sits "in front" of the mesh center along its own normal.
+	std::vector<float> sortKeys(clusterCount);
+	std::vector<int> order(clusterCount);
+	for (int cluster = 0; cluster < clusterCount; cluster++) {
+		const float* data = &clusterData[cluster * 6];
+		float offset[3] = { data[0] - center[0], data[1] - center[1], data[2] - center[2] };
+		sortKeys[cluster] = dot(offset, data + 3);
+		order[cluster] = cluster;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](int a, int b) { return sortKeys[a] > sortKeys[b]; });
+
+	// finally rebuild the index buffer in cluster order.
+	std::vector<int32_t> sorted;
+	sorted.reserve(indices.size());
+	for (int cluster : order) {
+		sorted.insert(sorted.end(), indices.begin() + clusters[cluster] * 3, indices.begin() + clusters[cluster + 1] * 3);
+	}
+
+	indices.swap(sorted);
+}
+
+// rasterizes a single triangle into the depth buffer, with backface culling and a less-than depth test.
+void overdraw_rasterize(std::vector<float>& depthBuffer, std::vector<unsigned char>& coverage, OverdrawStats& stats,
+	float ax, float ay, float az, float bx, float by, float bz, float cx, float cy, float cz) {
+
+	// signed area, anything not counter clockwise on screen is back facing.
+	float area = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+	if (area <= 0) {
+		return;
+	}
+
+	int minX = std::max(0, (int)std::floor(std::min(ax, std::min(bx, cx))));
+	int minY = std::max(0, (int)std::floor(std::min(ay, std::min(by, cy))));
+	int maxX = std::min(kOverdrawViewport - 1, (int)std::ceil(std::max(ax, std::max(bx, cx))));
+	int maxY = std::min(kOverdrawViewport - 1, (int)std::ceil(std::max(ay, std::max(by, cy))));
+
+	float inverseArea = 1.0f / area;
+
+	for (int y = minY; y <= maxY; y++) {
+		for (int x = minX; x <= maxX; x++) {
+			// sample at the pixel center.
+			float px = x + 0.5f;
+			float py = y + 0.5f;
+
+			float w0 = (cx - bx) * (py - by) - (cy - by) * (px - bx);
+			float w1 = (ax - cx) * (py - cy) - (ay - cy) * (px - cx);
+			float w2 = (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+
+			if (w0 < 0 || w1 < 0 || w2 < 0) {
+				continue;
+			}
+
+			float z = (w0 * az + w1 * bz + w2 * cz) * inverseArea;
+			int pixel = y * kOverdrawViewport + x;
+
+			if (z < depthBuffer[pixel]) {
+				depthBuffer[pixel] = z;
+				stats.pixelsShaded++;
+
+				if (coverage[pixel] == 0) {
+					coverage[pixel] = 1;
+					stats.pixelsCovered++;
+				}
+			}
+		}
+	}
+}
+
+// rasterizes the mesh in index order looking down axis (0 x, 1 y, 2 z) from the + side (side 0) or the - side (side 1),
+// and adds its pixels to stats. minP and scale normalize the mesh into the unit cube.
+void overdraw_view(const std::vector<int32_t>& indices, const std::vector<Position>& positions, const float* minP, float scale,
+	int axis, int side, OverdrawStats& stats) {
+
+	std::vector<float> depthBuffer(kOverdrawViewport * kOverdrawViewport, FLT_MAX);
+	std::vector<unsigned char> coverage(kOverdrawViewport * kOverdrawViewport, (unsigned char)0);
+
+	// camera sits on the +axis (side 0) or -axis (side 1) looking back at the mesh.
+	// the screen u axis is mirrored for the back view so the winding stays consistent with the view direction.
+	int uAxis = (axis + 1) % 3;
+	int vAxis = (axis + 2) % 3;
+	float sign = side == 0 ? 1.0f : -1.0f;
+
+	int faceCount = (int)indices.size() / 3;
+	for (int i = 0; i < faceCount; i++) {
+		float s[3][3];
+		for (int k = 0; k < 3; k++) {
+			const Position& p = positions[indices[i * 3 + k]];
+			float n[3] = { (p.x - minP[0]) * scale, (p.y - minP[1]) * scale, (p.z - minP[2]) * scale };
+
+			float u = side == 0 ? n[uAxis] : 1.0f - n[uAxis];
+			s[k][0] = u * (kOverdrawViewport - 1);
+			s[k][1] = n[vAxis] * (kOverdrawViewport - 1);
+			s[k][2] = -sign * n[axis]; // closer to the camera is smaller.
+		}
+
+		overdraw_rasterize(depthBuffer, coverage, stats,
+			s[0][0], s[0][1], s[0][2],
+			s[1][0], s[1][1], s[1][2],
+			s[2][0], s[2][1], s[2][2]);
+	}
+}
+
+// bounds of the positions, and the uniform scale that fits them into the unit cube (so we don't skew the triangles).
+void overdraw_bounds(const std::vector<Position>& positions, float* minP, float* maxP, float& scale) {
+	minP[0] = minP[1] = minP[2] = FLT_MAX;
+	maxP[0] = maxP[1] = maxP[2] = -FLT_MAX;
+	for (const Position& p : positions) {
+		minP[0] = std::min(minP[0], p.x); maxP[0] = std::max(maxP[0], p.x);
+		minP[1] = std::min(minP[1], p.y); maxP[1] = std::max(maxP[1], p.y);
+		minP[2] = std::min(minP[2], p.z); maxP[2] = std::max(maxP[2], p.z);
+	}
+	float extent = std::max(maxP[0] - minP[0], std::max(maxP[1] - minP[1], maxP[2] - minP[2]));
+	scale = extent > 0 ? 1.0f / extent : 0.0f;
+}
+
+// measures overdraw by rasterizing the mesh in index order from the 6 axis aligned view directions.
+OverdrawStats analyze_overdraw(const std::vector<int32_t>& indices, const std::vector<Position>& positions) {
+	OverdrawStats stats;
+
+	int faceCount = (int)indices.size() / 3;
+	if (faceCount == 0 || positions.empty()) {
+		return stats;
+	}
+
+	float minP[3], maxP[3], scale;
+	overdraw_bounds(positions, minP, maxP, scale);
+
+	for (int axis = 0; axis < 3; axis++) {
+		for (int side = 0; side < 2; side++) {
+			overdraw_view(indices, positions, minP, scale, axis, side, stats);
+		}
+	}
+
+	stats.overdraw = stats.pixelsCovered == 0 ? 0 : (float)stats.pixelsShaded / (float)stats.pixelsCovered;
+	return stats;
+}
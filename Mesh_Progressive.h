@@ -0,0 +1,200 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <array>
+#include <algorithm>
+
+#include "DataAndTypes.h"
+#include "Mesh_Simplify.h"
+#include "Mesh_Transform.h"
+#include "Trace.h"
+#include "LogRing.h"
+
+// defined in TdAssimp.cpp.
+void flatten_scene(const aiScene* scene, Mesh& mesh, const FlattenOptions& options);
+
+/*
+Progressive loading, for very large files where the full import takes seconds.
+
+The file is loaded on a background thread in two stages:
+1. the file is read with only the post processing steps we can't do without (triangulate, normals), flattened, and every
+   n-th triangle is kept, so the preview has at most previewTris triangles.
+2. the rest of the post processing steps are applied to the same scene (no second parse), and the full mesh is flattened.
+
+The sop polls take() every cook and swaps in whatever stage finished last, and keeps asking for cooks while loading().
+*/
+
+// post processing steps the preview is read with, every other step is applied afterwards.
+const unsigned int kProgressivePreviewFlags = aiProcess_Triangulate | aiProcess_GenNormals;
+
+class ProgressiveLoader {
+public:
+	enum Stage { None = 0, Preview = 1, Full = 2 };
+
+	// the load logs to log.
+	ProgressiveLoader(LogRing* log) : myLog(log) {}
+
+	~ProgressiveLoader() {
+		cancel();
+		if (myThread.joinable()) {
+			myThread.join();
+		}
+	}
+
+	// key of the import parameters the current (or last) load was started with, empty if there is nothing to keep.
+	const std::string& key() const {
+		return myKey;
+	}
+
+	// true from start() until the last stage was taken, or the load failed or was cancelled and the thread is done.
+	bool loading() const {
+		std::lock_guard<std::mutex> lock(myMutex);
+		return myRunning || myPendingStage != None;
+	}
+
+	// true while the background thread is still running, a new load can only be started once this is false.
+	bool busy() const {
+		return myRunning;
+	}
+
+	// starts a new load. the caller makes sure busy() is false first.
+	void start(const std::string& key, const std::string& file, unsigned int flags, const FlattenOptions& options, int previewTris) {
+
+		if (myThread.joinable()) {
+			myThread.join();
+		}
+
+		myKey = key;
+		myError.clear();
+		myPendingStage = None;
+		myCancelled = false;
+		myRunning = true;
+
+		myThread = std::thread([=]() {
+			load(file, flags, options, previewTris);
+			myRunning = false;
+		});
+	}
+
+	// the running load (if any) finishes in the background, but its results are thrown away.
+	void cancel() {
+		std::lock_guard<std::mutex> lock(myMutex);
+		myCancelled = true;
+		myKey.clear();
+		myPendingStage = None;
+		myPendingMesh = Mesh();
+	}
+
+	// moves the newest finished stage into mesh and returns which one it was, or None if nothing new finished.
+	// error is set if the load failed.
+	Stage take(Mesh& mesh, std::string& error) {
+		std::lock_guard<std::mutex> lock(myMutex);
+		error = myError;
+		Stage stage = myPendingStage;
+		if (stage != None) {
+			mesh = std::move(myPendingMesh);
+			myPendingMesh = Mesh();
+			myPendingStage = None;
+		}
+		return stage;
+	}
+
+private:
+	void publish(Mesh& mesh, Stage stage) {
+		std::lock_guard<std::mutex> lock(myMutex);
+		if (myCancelled) {
+			return;
+		}
+		myPendingMesh = std::move(mesh);
+		myPendingStage = stage;
+	}
+
+	void load(const std::string& file, unsigned int flags, const FlattenOptions& options, int previewTris) {
+
+		trace_thread_name("progressive load");
+		LogScope logScope(myLog);
+
+		Assimp::Importer importer;
+		importer.SetPropertyString(AI_CONFIG_PP_OG_EXCLUDE_LIST, optimize_graph_keep_list(options));
+
+		auto readStart = std::chrono::high_resolution_clock::now();
+		const aiScene* scene = importer.ReadFile(file, kProgressivePreviewFlags);
+		trace_span("read", readStart, file.c_str());
+		if (nullptr == scene) {
+			std::lock_guard<std::mutex> lock(myMutex);
+			if (!myCancelled) {
+				myError = "3D file does not exist or failed to load.";
+			}
+			return;
+		}
+
+		// preview, the assimp tangents are good enough for it even if the full mesh uses mikktspace.
+		{
+			FlattenOptions previewOptions = options;
+			previewOptions.DoMikktSpaceTangents = 0;
+
+			Mesh mesh;
+			flatten_scene(scene, mesh, previewOptions);
+
+			int numTris = (int)mesh.FaceIndex_Data.size() / 3;
+			int stride = std::max(1, (numTris + previewTris - 1) / std::max(previewTris, 1));
+
+			std::vector<int32_t> indices;
+			indices.reserve((numTris / stride + 1) * 3);
+			for (int tri = 0; tri < numTris; tri += stride) {
+				indices.insert(indices.end(), mesh.FaceIndex_Data.begin() + tri * 3, mesh.FaceIndex_Data.begin() + tri * 3 + 3);
+			}
+
+			Mesh preview = stride > 1 ? compact_mesh(mesh, indices) : std::move(mesh);
+			if (stride > 1) {
+				preview.Instance_Data = mesh.Instance_Data;
+				preview.numSkippedMeshes = mesh.numSkippedMeshes;
+				preview.numSkippedVertices = mesh.numSkippedVertices;
+				preview.skeleton = mesh.skeleton;
+				preview.animations = mesh.animations;
+				preview.morphTargets = mesh.morphTargets;
+			}
+			publish(preview, Preview);
+		}
+
+		if (myCancelled) {
+			return;
+		}
+
+		auto postProcessStart = std::chrono::high_resolution_clock::now();
+		scene = importer.ApplyPostProcessing(flags & ~kProgressivePreviewFlags);
+		trace_span("postprocess", postProcessStart);
+		if (nullptr == scene) {
+			std::lock_guard<std::mutex> lock(myMutex);
+			if (!myCancelled) {
+				myError = "3D file failed post processing.";
+			}
+			return;
+		}
+
+		if (myCancelled) {
+			return;
+		}
+
+		Mesh mesh;
+		flatten_scene(scene, mesh, options);
+		publish(mesh, Full);
+	}
+
+	std::thread myThread;
+	LogRing* myLog;
+	mutable std::mutex myMutex;
+	std::atomic<bool> myRunning{ false };
+	std::atomic<bool> myCancelled{ false };
+
+	// main thread only.
+	std::string myKey;
+
+	// guarded by myMutex.
+	std::string myError;
+	Stage myPendingStage = None;
+	Mesh myPendingMesh;
+};
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <chrono>
+
+#include "DataAndTypes.h"
+#include "Mesh_Overdraw.h"
+#include "Parallel.h"
+
+/*
+Quality report of the mesh the sop outputs, to compare post processing presets on an asset with numbers.
+
+- acmr / atvr: vertex shader invocations per triangle / per referenced vertex, with a simulated fifo post transform cache
+  of the given size. 0.5 acmr and 1.0 atvr are ideal, 3.0 acmr is every vertex missing.
+- vertex_reuse: triangle corners per referenced vertex, how often the index buffer reuses a vertex. ~6 for a closed
+  smooth mesh, 1 if nothing is shared.
+- duplicate_vertex_ratio: vertices that are exact copies of an other vertex (position, normal, uv, color), ie. what
+  Join Identical Vertices would still merge.
+- degenerate_triangles: triangles with a repeated index or zero area.
+- bytes_per_vertex: attribute bytes handed to the sop per point, everything but the index buffer.
+- overdraw: the overdraw estimate of Mesh_Overdraw.h, from the 6 axis views.
+
+The overdraw views, the cache simulation and the vertex / triangle scans are independent, so they run as separate tasks
+of one parallel_for.
+*/
+
+struct MeshQuality {
+	int cacheSize = 0;
+	int vertices = 0;
+	int triangles = 0;
+	float acmr = 0;
+	float atvr = 0;
+	float vertexReuse = 0;
+	float duplicateRatio = 0;
+	int degenerates = 0;
+	float boundsMin[3] = { 0, 0, 0 };
+	float boundsMax[3] = { 0, 0, 0 };
+	float bytesPerVertex = 0;
+	float overdraw = 0;
+	double ms = 0;
+};
+
+// misses of a fifo cache of cacheSize entries over the index buffer, and how many distinct vertices it references.
+void quality_cache(const std::vector<int32_t>& indices, int vertexCount, int cacheSize, unsigned int& misses, unsigned int& referenced) {
+	// a vertex is in the cache if it went in less than cacheSize misses ago.
+	std::vector<unsigned int> cacheTimestamps(vertexCount, 0);
+	unsigned int timestamp = (unsigned int)cacheSize + 1;
+	misses = 0;
+	referenced = 0;
+	for (int32_t index : indices) {
+		if (cacheTimestamps[index] == 0) {
+			referenced++;
+		}
+		if (timestamp - cacheTimestamps[index] > (unsigned int)cacheSize) {
+			cacheTimestamps[index] = timestamp++;
+			misses++;
+		}
+	}
+}
+
+// number of vertices that have an exact copy with a lower index.
+int quality_duplicates(const Mesh& mesh) {
+	int vertexCount = (int)mesh.Position_Data.size();
+	bool hasNormals = (int)mesh.Normal_Data.size() == vertexCount;
+	bool hasUvs = (int)mesh.Uv_Data.size() == vertexCount;
+	bool hasColors = (int)mesh.Color_Data.size() == vertexCount;
+
+	// the attributes of a vertex as one block of floats, so two vertices compare (and hash) as raw bytes.
+	const int maxFloats = 3 + 3 + 3 + 4;
+	auto pack = [&](int v, float* key) {
+		int n = 0;
+		key[n++] = mesh.Position_Data[v].x; key[n++] = mesh.Position_Data[v].y; key[n++] = mesh.Position_Data[v].z;
+		if (hasNormals) { key[n++] = mesh.Normal_Data[v].x; key[n++] = mesh.Normal_Data[v].y; key[n++] = mesh.Normal_Data[v].z; }
+		if (hasUvs) { key[n++] = mesh.Uv_Data[v].u; key[n++] = mesh.Uv_Data[v].v; key[n++] = mesh.Uv_Data[v].w; }
+		if (hasColors) { key[n++] = mesh.Color_Data[v].r; key[n++] = mesh.Color_Data[v].g; key[n++] = mesh.Color_Data[v].b; key[n++] = mesh.Color_Data[v].a; }
+		return n;
+	};
+
+	std::unordered_multimap<uint64_t, int> seen;
+	seen.reserve(vertexCount);
+	int duplicates = 0;
+	float key[maxFloats];
+	float other[maxFloats];
+	for (int v = 0; v < vertexCount; v++) {
+		int n = pack(v, key);
+
+		// fnv-1a over the bytes, -0 and 0 hash differently but that only costs a missed duplicate.
+		uint64_t hash = 1469598103934665603ull;
+		const unsigned char* bytes = (const unsigned char*)key;
+		for (size_t b = 0; b < n * sizeof(float); b++) {
+			hash = (hash ^ bytes[b]) * 1099511628211ull;
+		}
+
+		bool duplicate = false;
+		auto range = seen.equal_range(hash);
+		for (auto it = range.first; it != range.second && !duplicate; ++it) {
+			pack(it->second, other);
+			duplicate = memcmp(key, other, n * sizeof(float)) == 0;
+		}
+		if (duplicate) {
+			duplicates++;
+		}
+		else {
+			seen.emplace(hash, v);
+		}
+	}
+	return duplicates;
+}
+
+// triangles with a repeated index, or an area too small to cover anything.
+int quality_degenerates(const std::vector<int32_t>& indices, const std::vector<Position>& positions) {
+	int degenerates = 0;
+	int faceCount = (int)indices.size() / 3;
+	for (int i = 0; i < faceCount; i++) {
+		int32_t a = indices[i * 3 + 0];
+		int32_t b = indices[i * 3 + 1];
+		int32_t c = indices[i * 3 + 2];
+		if (a == b || b == c || a == c) {
+			degenerates++;
+			continue;
+		}
+		const Position& pa = positions[a];
+		const Position& pb = positions[b];
+		const Position& pc = positions[c];
+		float e0[3] = { pb.x - pa.x, pb.y - pa.y, pb.z - pa.z };
+		float e1[3] = { pc.x - pa.x, pc.y - pa.y, pc.z - pa.z };
+		float n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+		if (n[0] * n[0] + n[1] * n[1] + n[2] * n[2] <= FLT_MIN) {
+			degenerates++;
+		}
+	}
+	return degenerates;
+}
+
+// analyzes the triangles in indices of mesh, attributeBytes is what was handed to the sop for the points.
+MeshQuality analyze_quality(const Mesh& mesh, const std::vector<int32_t>& indices, int cacheSize, size_t attributeBytes) {
+	auto start = std::chrono::high_resolution_clock::now();
+	MeshQuality quality;
+	quality.cacheSize = std::max(1, cacheSize);
+	quality.vertices = (int)mesh.Position_Data.size();
+	quality.triangles = (int)indices.size() / 3;
+	if (quality.vertices == 0 || quality.triangles == 0) {
+		return quality;
+	}
+
+	float scale = 0;
+	overdraw_bounds(mesh.Position_Data, quality.boundsMin, quality.boundsMax, scale);
+
+	// tasks 0 - 5 are the overdraw views, then the cache, the duplicates and the degenerates.
+	OverdrawStats views[6];
+	unsigned int misses = 0;
+	unsigned int referenced = 0;
+	int duplicates = 0;
+	parallel_for(9, [&](int task) {
+		if (task < 6) {
+			overdraw_view(indices, mesh.Position_Data, quality.boundsMin, scale, task / 2, task % 2, views[task]);
+		}
+		else if (task == 6) {
+			quality_cache(indices, quality.vertices, quality.cacheSize, misses, referenced);
+		}
+		else if (task == 7) {
+			duplicates = quality_duplicates(mesh);
+		}
+		else {
+			quality.degenerates = quality_degenerates(indices, mesh.Position_Data);
+		}
+	});
+
+	OverdrawStats overdraw;
+	for (const OverdrawStats& view : views) {
+		overdraw.pixelsCovered += view.pixelsCovered;
+		overdraw.pixelsShaded += view.pixelsShaded;
+	}
+	quality.overdraw = overdraw.pixelsCovered == 0 ? 0 : (float)overdraw.pixelsShaded / (float)overdraw.pixelsCovered;
+
+	quality.acmr = (float)misses / (float)quality.triangles;
+	quality.atvr = referenced == 0 ? 0 : (float)misses / (float)referenced;
+	quality.vertexReuse = referenced == 0 ? 0 : (float)indices.size() / (float)referenced;
+	quality.duplicateRatio = (float)duplicates / (float)quality.vertices;
+	quality.bytesPerVertex = (float)attributeBytes / (float)quality.vertices;
+	quality.ms = elapsed_ms(start);
+	return quality;
+}
+
+// the report as metric / value rows for the info DAT.
+std::vector<std::pair<std::string, std::string>> quality_rows(const MeshQuality& quality) {
+	auto number = [](double value) {
+		char text[32];
+		snprintf(text, sizeof(text), "%g", value);
+		return std::string(text);
+	};
+	return {
+		{ "cache_size", number(quality.cacheSize) },
+		{ "vertices", number(quality.vertices) },
+		{ "triangles", number(quality.triangles) },
+		{ "acmr", number(quality.acmr) },
+		{ "atvr", number(quality.atvr) },
+		{ "vertex_reuse", number(quality.vertexReuse) },
+		{ "duplicate_vertex_ratio", number(quality.duplicateRatio) },
+		{ "degenerate_triangles", number(quality.degenerates) },
+		{ "bounds_min_x", number(quality.boundsMin[0]) },
+		{ "bounds_min_y", number(quality.boundsMin[1]) },
+		{ "bounds_min_z", number(quality.boundsMin[2]) },
+		{ "bounds_max_x", number(quality.boundsMax[0]) },
+		{ "bounds_max_y", number(quality.boundsMax[1]) },
+		{ "bounds_max_z", number(quality.boundsMax[2]) },
+		{ "bytes_per_vertex", number(quality.bytesPerVertex) },
+		{ "overdraw", number(quality.overdraw) },
+		{ "analysis_ms", number(quality.ms) },
+	};
+}
@@ -0,0 +1,346 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+#include <climits>
+
+#include "DataAndTypes.h"
+#include "Mesh_Transform.h"
+#include "Trace.h"
+#include "LogRing.h"
+
+// defined in TdAssimp.cpp.
+void flatten_scene(const aiScene* scene, Mesh& mesh, const FlattenOptions& options);
+std::vector<MeshInstance> flatten_instances(const aiScene* scene, const FlattenOptions& options, Mesh& mesh,
+	std::vector<const aiNode*>& referenceNodes);
+
+/*
+File sequences, ie. a simulation cached out as mesh.0001.obj, mesh.0002.obj ...
+
+The File parameter is the pattern, a run of # is replaced by the zero padded frame (mesh.####.obj), otherwise the last
+number in the file name before the extension is (mesh.0001.obj plays mesh.0002.obj on frame 2, keeping the padding,
+and anim.0001.md2 keeps its extension).
+
+Every frame is still read by assimp, but if it has the same topology as the cached frame (same meshes, vertex counts,
+triangles and uvs) only the positions and normals are copied into the cached mesh. the flattening, mikktspace, LOD
+simplification, overdraw ordering and meshlets of the first frame are all kept.
+
+With prefetching on, the next frames in the playback direction are read and flattened on worker threads ahead of time,
+into a ring of slots (frame modulo the ring size), so a cook only has to copy the vertices of a ready frame.
+*/
+
+// file of a frame of the sequence pattern.
+std::string sequence_file(const std::string& pattern, int frame) {
+	size_t nameStart = pattern.find_last_of("/\\");
+	nameStart = nameStart == std::string::npos ? 0 : nameStart + 1;
+
+	// a run of #, or else the last run of digits in the file name, left of the extension (.md2, .x3d, .3ds ...).
+	size_t last = pattern.find_last_of('#');
+	if (last == std::string::npos || last < nameStart) {
+		size_t extension = pattern.find_last_of('.');
+		if (extension == std::string::npos || extension < nameStart) {
+			extension = pattern.size();
+		}
+		last = extension == nameStart ? std::string::npos : pattern.find_last_of("0123456789", extension - 1);
+		if (last == std::string::npos || last < nameStart) {
+			return pattern;
+		}
+	}
+	char digit = pattern[last];
+	size_t first = last;
+	while (first > nameStart && (digit == '#' ? pattern[first - 1] == '#' : isdigit((unsigned char)pattern[first - 1]))) {
+		first--;
+	}
+
+	char number[32];
+	snprintf(number, sizeof(number), "%0*d", (int)(last - first + 1), frame);
+	return pattern.substr(0, first) + number + pattern.substr(last + 1);
+}
+
+// fnv-1a, over raw bytes.
+inline void hash_bytes(uint64_t& hash, const void* data, size_t size) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+}
+
+// everything that decides the flattened vertex and index layout of a scene: which meshes are flattened (and mirrored),
+// their vertex counts, triangles and uvs. positions, normals and node transforms are left out, they are what a
+// sequence is allowed to change.
+uint64_t scene_topology_hash(const aiScene* scene, const std::vector<MeshInstance>& instances) {
+	uint64_t hash = 14695981039346656037ull;
+	for (const MeshInstance& instance : instances) {
+		const aiMesh* source = scene->mMeshes[instance.meshIndex];
+		uint32_t header[5] = { (uint32_t)instance.meshIndex, (uint32_t)instance.mirrored, source->mNumVertices, source->mNumFaces,
+			(uint32_t)source->HasNormals() };
+		hash_bytes(hash, header, sizeof(header));
+
+		for (unsigned int face_index = 0; face_index < source->mNumFaces; face_index++) {
+			const aiFace& face = source->mFaces[face_index];
+			hash_bytes(hash, &face.mNumIndices, sizeof(face.mNumIndices));
+			hash_bytes(hash, face.mIndices, face.mNumIndices * sizeof(unsigned int));
+		}
+		if (source->HasTextureCoords(0)) {
+			hash_bytes(hash, source->mTextureCoords[0], source->mNumVertices * sizeof(aiVector3D));
+		}
+	}
+	return hash;
+}
+
+// copies the vertex data of a sequence frame with the same topology into mesh. returns false if the layout differs.
+bool sequence_copy_vertices(const Mesh& frame, Mesh& mesh) {
+	if (frame.Position_Data.size() != mesh.Position_Data.size() || frame.TbnQuat_Data.size() != mesh.TbnQuat_Data.size()) {
+		return false;
+	}
+	mesh.Position_Data = frame.Position_Data;
+	mesh.Normal_Data = frame.Normal_Data;
+	mesh.Tangent_Data = frame.Tangent_Data;
+	mesh.Bitangent_Data = frame.Bitangent_Data;
+	mesh.TbnQuat_Data = frame.TbnQuat_Data;
+	mesh.Instance_Data = frame.Instance_Data;
+	return true;
+}
+
+// rough size of the vertex and index data of a mesh, for the prefetch memory budget.
+size_t sequence_frame_bytes(const Mesh& mesh) {
+	return mesh.Position_Data.size() * sizeof(Position) + mesh.Normal_Data.size() * sizeof(Vector)
+		+ mesh.Color_Data.size() * sizeof(Color) + mesh.Uv_Data.size() * sizeof(TexCoord)
+		+ (mesh.Tangent_Data.size() + mesh.Bitangent_Data.size() + mesh.TbnQuat_Data.size()) * sizeof(float)
+		+ (mesh.FaceIndex_Data.size() + mesh.MeshId_Data.size()) * sizeof(int32_t)
+		+ (mesh.JointIndex_Data.size() + mesh.JointWeight_Data.size()) * 4;
+}
+
+class SequencePrefetcher {
+public:
+	// the workers log to log.
+	SequencePrefetcher(LogRing* log) : myLog(log) {}
+
+	~SequencePrefetcher() {
+		stop();
+	}
+
+	// true while there are worker threads, they might be logging.
+	bool busy() const {
+		return !myThreads.empty();
+	}
+
+	// (re)starts the workers for a sequence. if anything changed, every prefetched frame is dropped.
+	void configure(const std::string& key, const std::string& pattern, unsigned int flags, const FlattenOptions& options,
+		int depth, size_t budget) {
+
+		if (busy() && key == myKey && depth == (int)mySlots.size() && budget == myBudget) {
+			return;
+		}
+		stop();
+
+		myKey = key;
+		myPattern = pattern;
+		myFlags = flags;
+		myOptions = options;
+		myBudget = budget;
+		myFrameBytes = 0;
+		mySlots.assign(depth, Slot());
+
+		int numThreads = std::min(depth, std::max(1, (int)std::thread::hardware_concurrency() / 2));
+		for (int t = 0; t < numThreads; t++) {
+			myThreads.emplace_back([this]() { work(); });
+		}
+	}
+
+	// joins the workers, the frames they were reading are thrown away.
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(myMutex);
+			myStopping = true;
+			myQueue.clear();
+		}
+		myCondition.notify_all();
+		for (std::thread& thread : myThreads) {
+			thread.join();
+		}
+		myThreads.clear();
+		mySlots.clear();
+		myKey.clear();
+		myStopping = false;
+	}
+
+	// schedules the frames after frame in direction (1 or -1) that aren't ready or being read yet, nearest first, as far
+	// as the ring and the memory budget allow. frames that fell out of the window are dropped.
+	void request(int frame, int direction) {
+		{
+			std::lock_guard<std::mutex> lock(myMutex);
+			int depth = (int)mySlots.size();
+			myQueue.clear();
+
+			// frames that are not read yet are assumed to be as big as the last one.
+			size_t used = 0;
+			for (int k = 1; k <= depth; k++) {
+				int next = frame + direction * k;
+				Slot& slot = mySlots[slot_index(next)];
+				bool kept = slot.frame == next && slot.state != Slot::Empty;
+
+				used += kept && slot.state == Slot::Ready ? slot.bytes : myFrameBytes;
+				if (k > 1 && used > myBudget) {
+					slot = Slot();
+					continue;
+				}
+
+				if (!kept) {
+					slot = Slot();
+					slot.frame = next;
+					slot.state = Slot::Queued;
+				}
+				if (slot.state == Slot::Queued) {
+					myQueue.push_back(next);
+				}
+			}
+		}
+		myCondition.notify_all();
+	}
+
+	// moves frame out of the ring if it was prefetched. a frame that is being read right now is waited for, since that's
+	// always quicker than reading it again. decodeMs is how long reading and flattening it took.
+	bool take(int frame, Mesh& mesh, uint64_t& topologyHash, double& decodeMs) {
+		std::unique_lock<std::mutex> lock(myMutex);
+		if (mySlots.empty()) {
+			return false;
+		}
+		Slot& slot = mySlots[slot_index(frame)];
+		if (slot.frame != frame) {
+			return false;
+		}
+		if (slot.state == Slot::Queued) {
+			slot = Slot();
+			return false;
+		}
+		myCondition.wait(lock, [&]() { return slot.frame != frame || slot.state != Slot::Loading || myStopping; });
+		if (slot.frame != frame || slot.state != Slot::Ready) {
+			return false;
+		}
+
+		mesh = std::move(slot.mesh);
+		topologyHash = slot.topologyHash;
+		decodeMs = slot.decodeMs;
+		slot = Slot();
+		return true;
+	}
+
+	// memory held by the frames that are ready, as counted against the budget.
+	size_t bytes() const {
+		std::lock_guard<std::mutex> lock(myMutex);
+		size_t total = 0;
+		for (const Slot& slot : mySlots) {
+			total += slot.state == Slot::Ready ? slot.bytes : 0;
+		}
+		return total;
+	}
+
+	// frames that are ready to be taken.
+	int ready() const {
+		std::lock_guard<std::mutex> lock(myMutex);
+		int count = 0;
+		for (const Slot& slot : mySlots) {
+			count += slot.state == Slot::Ready;
+		}
+		return count;
+	}
+
+private:
+	struct Slot {
+		enum State { Empty, Queued, Loading, Ready };
+		int frame = INT_MIN;
+		State state = Empty;
+		Mesh mesh;
+		uint64_t topologyHash = 0;
+		double decodeMs = 0;
+		size_t bytes = 0;
+	};
+
+	int slot_index(int frame) const {
+		int depth = (int)mySlots.size();
+		return ((frame % depth) + depth) % depth;
+	}
+
+	void work() {
+		LogScope logScope(myLog);
+		std::unique_lock<std::mutex> lock(myMutex);
+		while (true) {
+			myCondition.wait(lock, [&]() { return myStopping || !myQueue.empty(); });
+			if (myStopping) {
+				return;
+			}
+			int frame = myQueue.front();
+			myQueue.pop_front();
+
+			Slot& slot = mySlots[slot_index(frame)];
+			if (slot.frame != frame || slot.state != Slot::Queued) {
+				continue;
+			}
+			slot.state = Slot::Loading;
+			lock.unlock();
+
+			trace_thread_name("prefetch");
+			auto start = std::chrono::high_resolution_clock::now();
+			Mesh mesh;
+			uint64_t topologyHash = 0;
+			bool loaded = false;
+			{
+				Assimp::Importer importer;
+				importer.SetPropertyString(AI_CONFIG_PP_OG_EXCLUDE_LIST, optimize_graph_keep_list(myOptions));
+				const aiScene* scene = importer.ReadFile(sequence_file(myPattern, frame), myFlags);
+				if (scene) {
+					Mesh instanceTable;
+					std::vector<const aiNode*> referenceNodes;
+					topologyHash = scene_topology_hash(scene, flatten_instances(scene, myOptions, instanceTable, referenceNodes));
+					flatten_scene(scene, mesh, myOptions);
+					loaded = true;
+				}
+			}
+			double decodeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			trace_span("prefetch frame", start, sequence_file(myPattern, frame).c_str());
+
+			lock.lock();
+			// dropped while it was being read (out of the window, or taken as a miss), or the file failed to load.
+			if (slot.frame != frame || slot.state != Slot::Loading || !loaded) {
+				if (slot.frame == frame) {
+					slot = Slot();
+				}
+			}
+			else {
+				slot.mesh = std::move(mesh);
+				slot.topologyHash = topologyHash;
+				slot.decodeMs = decodeMs;
+				slot.bytes = sequence_frame_bytes(slot.mesh);
+				myFrameBytes = slot.bytes;
+				slot.state = Slot::Ready;
+			}
+			myCondition.notify_all();
+		}
+	}
+
+	std::vector<std::thread> myThreads;
+	LogRing* myLog;
+
+	// set by configure() before the workers start, read only while they run.
+	std::string myKey;
+	std::string myPattern;
+	unsigned int myFlags = 0;
+	FlattenOptions myOptions;
+	size_t myBudget = 0;
+
+	// guarded by myMutex.
+	mutable std::mutex myMutex;
+	std::condition_variable myCondition;
+	bool myStopping = false;
+	std::vector<Slot> mySlots;
+	std::deque<int> myQueue;
+	size_t myFrameBytes = 0;
+};
@@ -0,0 +1,594 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <climits>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else // macOS
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "DataAndTypes.h"
+#include "Mesh_Transform.h"
+#include "Mesh_Sequence.h"
+#include "Parallel.h"
+#include "Trace.h"
+
+// defined in TdAssimp.cpp.
+bool flatten_positions(const aiScene* scene, Mesh& mesh, const FlattenOptions& options);
+
+/*
+Sequence cache, a compact file with the positions and normals of every frame of a sequence, so it can be played back
+without assimp. the topology, uvs etc. still come from the first frame of the sequence, read the normal way.
+
+Positions are quantized to a grid (step from the bounding box of the first frame and the number of bits asked for),
+normals to octahedral coordinates with 16 bits each. every keyframe (every n-th frame) stores the quantized values as
+deltas to the previous vertex, every other frame as deltas to the same vertex in the frame before. so playing from any
+frame only needs its keyframe and the frames between, and a static part of a sequence costs almost nothing.
+
+The deltas are zigzag encoded and bit packed in blocks of 128 with their own bit width (1 byte per block), in 4
+interleaved lanes, so a block unpacks with plain 4 wide sse shifts. everything is 4 byte aligned in the file.
+
+layout:
+	SequenceCacheHeader
+	frames: uint32 keyframe flag, then the 5 streams (px py pz nu nv): a bit width per block padded to 4 bytes, and
+	        bits * 4 uint32 per block.
+	index: frameCount + 1 uint64 file offsets, the last is the end of the last frame.
+
+The reader memory maps the file, and decodes frames in order from the last decoded frame if it can.
+*/
+
+const uint32_t kSequenceCacheMagic = 0x43534454; // "TDSC"
+const uint32_t kSequenceCacheVersion = 1;
+const int kSequenceCacheBlock = 128;
+const int kSequenceCacheStreams = 5;
+const float kSequenceCacheNormalScale = 32767.0f;
+
+struct SequenceCacheHeader {
+	uint32_t magic = kSequenceCacheMagic;
+	uint32_t version = kSequenceCacheVersion;
+	uint32_t vertexCount = 0;
+	uint32_t frameCount = 0;
+	int32_t firstFrame = 0;
+	uint32_t keyframeInterval = 1;
+	uint64_t topologyHash = 0; // scene_topology_hash of the frames, the mesh it's played on has to match.
+	float origin[3] = { 0, 0, 0 };
+	float step = 1; // size of one position quantization step.
+	uint64_t indexOffset = 0;
+};
+
+inline uint32_t zigzag_encode(int32_t v) {
+	return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+inline int32_t zigzag_decode(uint32_t v) {
+	return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// octahedral encoding of a unit vector, both coordinates in -1..1.
+inline void oct_encode(const Vector& n, int32_t& u, int32_t& v) {
+	float sum = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+	float x = sum > 0 ? n.x / sum : 0;
+	float y = sum > 0 ? n.y / sum : 0;
+	if (n.z < 0) {
+		float ox = (1 - std::fabs(y)) * (x >= 0 ? 1 : -1);
+		float oy = (1 - std::fabs(x)) * (y >= 0 ? 1 : -1);
+		x = ox;
+		y = oy;
+	}
+	u = (int32_t)std::lround(x * kSequenceCacheNormalScale);
+	v = (int32_t)std::lround(y * kSequenceCacheNormalScale);
+}
+
+inline Vector oct_decode(int32_t u, int32_t v) {
+	float x = u / kSequenceCacheNormalScale;
+	float y = v / kSequenceCacheNormalScale;
+	float z = 1 - std::fabs(x) - std::fabs(y);
+	if (z < 0) {
+		float ox = (1 - std::fabs(y)) * (x >= 0 ? 1 : -1);
+		float oy = (1 - std::fabs(x)) * (y >= 0 ? 1 : -1);
+		x = ox;
+		y = oy;
+	}
+	float len = std::sqrt(x * x + y * y + z * z);
+	return len > 0 ? Vector(x / len, y / len, z / len) : Vector(0, 0, 1);
+}
+
+// packs 128 values of bits bits into bits * 4 words. value i goes to lane i % 4, the lanes are interleaved word by word.
+void pack_block(const uint32_t* values, int bits, uint32_t* words) {
+	if (bits == 0) {
+		return;
+	}
+	std::fill(words, words + bits * 4, 0u);
+	for (int i = 0; i < kSequenceCacheBlock; i++) {
+		int lane = i & 3;
+		int pos = (i >> 2) * bits;
+		int word = pos >> 5;
+		int shift = pos & 31;
+		words[word * 4 + lane] |= values[i] << shift;
+		if (shift + bits > 32) {
+			words[(word + 1) * 4 + lane] |= values[i] >> (32 - shift);
+		}
+	}
+}
+
+// unpacks a block packed by pack_block.
+void unpack_block(const uint32_t* words, int bits, uint32_t* values) {
+	if (bits == 0) {
+		std::fill(values, values + kSequenceCacheBlock, 0u);
+		return;
+	}
+#ifdef TDASSIMP_SSE
+	const __m128i mask = _mm_set1_epi32(bits == 32 ? -1 : (int)((1u << bits) - 1));
+	for (int slot = 0; slot < kSequenceCacheBlock / 4; slot++) {
+		int pos = slot * bits;
+		int word = pos >> 5;
+		int shift = pos & 31;
+		__m128i r = _mm_srl_epi32(_mm_loadu_si128((const __m128i*)(words + word * 4)), _mm_cvtsi32_si128(shift));
+		if (shift + bits > 32) {
+			r = _mm_or_si128(r, _mm_sll_epi32(_mm_loadu_si128((const __m128i*)(words + word * 4 + 4)), _mm_cvtsi32_si128(32 - shift)));
+		}
+		_mm_storeu_si128((__m128i*)(values + slot * 4), _mm_and_si128(r, mask));
+	}
+#else
+	uint32_t mask = bits == 32 ? 0xffffffffu : (1u << bits) - 1;
+	for (int i = 0; i < kSequenceCacheBlock; i++) {
+		int lane = i & 3;
+		int pos = (i >> 2) * bits;
+		int word = pos >> 5;
+		int shift = pos & 31;
+		uint32_t v = words[word * 4 + lane] >> shift;
+		if (shift + bits > 32) {
+			v |= words[(word + 1) * 4 + lane] << (32 - shift);
+		}
+		values[i] = v & mask;
+	}
+#endif
+}
+
+// appends one stream of deltas, zigzag encoded and bit packed.
+void encode_stream(const std::vector<int32_t>& deltas, std::vector<uint32_t>& out) {
+	int count = (int)deltas.size();
+	int numBlocks = (count + kSequenceCacheBlock - 1) / kSequenceCacheBlock;
+
+	size_t widthsStart = out.size();
+	out.resize(out.size() + (numBlocks + 3) / 4, 0u);
+
+	uint32_t values[kSequenceCacheBlock];
+	for (int block = 0; block < numBlocks; block++) {
+		uint32_t all = 0;
+		for (int i = 0; i < kSequenceCacheBlock; i++) {
+			int index = block * kSequenceCacheBlock + i;
+			values[i] = index < count ? zigzag_encode(deltas[index]) : 0;
+			all |= values[i];
+		}
+		int bits = 0;
+		while (bits < 32 && (all >> bits) != 0) {
+			bits++;
+		}
+
+		((uint8_t*)&out[widthsStart])[block] = (uint8_t)bits;
+		size_t wordsStart = out.size();
+		out.resize(out.size() + bits * 4);
+		pack_block(values, bits, &out[wordsStart]);
+	}
+}
+
+// decodes one stream into state. keyframes replace state (the deltas are to the previous vertex), other frames add the
+// deltas to it. returns the first word after the stream, or nullptr if it would read past end.
+const uint32_t* decode_stream(const uint32_t* data, const uint32_t* end, bool keyframe, std::vector<int32_t>& state) {
+	int count = (int)state.size();
+	int numBlocks = (count + kSequenceCacheBlock - 1) / kSequenceCacheBlock;
+
+	const uint8_t* widths = (const uint8_t*)data;
+	const uint32_t* words = data + (numBlocks + 3) / 4;
+	if (words > end) {
+		return nullptr;
+	}
+
+	alignas(16) uint32_t values[kSequenceCacheBlock];
+	int32_t previous = 0;
+	for (int block = 0; block < numBlocks; block++) {
+		int bits = widths[block];
+		if (bits > 32 || words + bits * 4 > end) {
+			return nullptr;
+		}
+		unpack_block(words, bits, values);
+		words += bits * 4;
+
+		int first = block * kSequenceCacheBlock;
+		int blockCount = std::min(kSequenceCacheBlock, count - first);
+		int32_t* dst = &state[first];
+
+		if (keyframe) {
+			for (int i = 0; i < blockCount; i++) {
+				previous += zigzag_decode(values[i]);
+				dst[i] = previous;
+			}
+			continue;
+		}
+
+		int i = 0;
+#ifdef TDASSIMP_SSE
+		const __m128i one = _mm_set1_epi32(1);
+		for (; i + 4 <= blockCount; i += 4) {
+			__m128i v = _mm_load_si128((const __m128i*)(values + i));
+			__m128i delta = _mm_xor_si128(_mm_srli_epi32(v, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, one)));
+			__m128i* p = (__m128i*)(dst + i);
+			_mm_storeu_si128(p, _mm_add_epi32(_mm_loadu_si128(p), delta));
+		}
+#endif
+		for (; i < blockCount; i++) {
+			dst[i] += zigzag_decode(values[i]);
+		}
+	}
+	return words;
+}
+
+// writes a sequence cache frame by frame.
+class SequenceCacheWriter {
+public:
+	// positionBits sets the position precision, relative to the largest side of the first frame's bounding box.
+	bool open(const std::string& path, int firstFrame, int keyframeInterval, int positionBits, uint64_t topologyHash) {
+		myFile.open(path, std::ios::binary | std::ios::trunc);
+		if (!myFile) {
+			return false;
+		}
+		myPath = path;
+		myHeader = SequenceCacheHeader();
+		myHeader.firstFrame = firstFrame;
+		myHeader.keyframeInterval = (uint32_t)std::max(keyframeInterval, 1);
+		myHeader.topologyHash = topologyHash;
+		myPositionBits = std::min(std::max(positionBits, 8), 24);
+		myOffsets.clear();
+		myFile.write((const char*)&myHeader, sizeof(myHeader));
+		return true;
+	}
+
+	bool is_open() const {
+		return myFile.is_open();
+	}
+
+	// closes the file without the index and deletes it, so a cache that didn't get all its frames is never played.
+	void discard() {
+		myFile.close();
+		std::remove(myPath.c_str());
+	}
+
+	// adds the next frame, with the same vertex count as the first one.
+	bool add_frame(const Mesh& mesh) {
+		int count = (int)mesh.Position_Data.size();
+		if (myOffsets.empty()) {
+			Position lo = count ? mesh.Position_Data[0] : Position(0, 0, 0);
+			Position hi = lo;
+			for (const Position& p : mesh.Position_Data) {
+				lo = Position(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+				hi = Position(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+			}
+			float extent = std::max(std::max(hi.x - lo.x, hi.y - lo.y), hi.z - lo.z);
+			myHeader.vertexCount = (uint32_t)count;
+			myHeader.origin[0] = lo.x;
+			myHeader.origin[1] = lo.y;
+			myHeader.origin[2] = lo.z;
+			myHeader.step = extent > 0 ? extent / (float)((1 << myPositionBits) - 1) : 1.0f;
+			myPrevious.assign(kSequenceCacheStreams, std::vector<int32_t>(count, 0));
+		}
+		if (count != (int)myHeader.vertexCount) {
+			return false;
+		}
+
+		// quantize.
+		std::vector<std::vector<int32_t>> current(kSequenceCacheStreams, std::vector<int32_t>(count));
+		parallel_for((count + 4095) / 4096, [&](int chunk) {
+			int end = std::min(count, (chunk + 1) * 4096);
+			for (int v = chunk * 4096; v < end; v++) {
+				const Position& p = mesh.Position_Data[v];
+				current[0][v] = (int32_t)std::lround((p.x - myHeader.origin[0]) / myHeader.step);
+				current[1][v] = (int32_t)std::lround((p.y - myHeader.origin[1]) / myHeader.step);
+				current[2][v] = (int32_t)std::lround((p.z - myHeader.origin[2]) / myHeader.step);
+				oct_encode(mesh.Normal_Data[v], current[3][v], current[4][v]);
+			}
+		});
+
+		bool keyframe = myOffsets.size() % myHeader.keyframeInterval == 0;
+		std::vector<uint32_t> words(1, keyframe ? 1u : 0u);
+		std::vector<int32_t> deltas(count);
+		for (int stream = 0; stream < kSequenceCacheStreams; stream++) {
+			const std::vector<int32_t>& values = current[stream];
+			for (int v = 0; v < count; v++) {
+				deltas[v] = keyframe ? values[v] - (v > 0 ? values[v - 1] : 0) : values[v] - myPrevious[stream][v];
+			}
+			encode_stream(deltas, words);
+		}
+		myPrevious.swap(current);
+
+		myOffsets.push_back((uint64_t)myFile.tellp());
+		myFile.write((const char*)words.data(), words.size() * sizeof(uint32_t));
+		return (bool)myFile;
+	}
+
+	// writes the frame index and the final header. returns the file size, or 0 if writing failed.
+	uint64_t close() {
+		myOffsets.push_back((uint64_t)myFile.tellp());
+		myHeader.frameCount = (uint32_t)myOffsets.size() - 1;
+		myHeader.indexOffset = myOffsets.back();
+		myFile.write((const char*)myOffsets.data(), myOffsets.size() * sizeof(uint64_t));
+		uint64_t size = (uint64_t)myFile.tellp();
+		myFile.seekp(0);
+		myFile.write((const char*)&myHeader, sizeof(myHeader));
+		bool ok = (bool)myFile;
+		myFile.close();
+		return ok ? size : 0;
+	}
+
+private:
+	std::ofstream myFile;
+	std::string myPath;
+	SequenceCacheHeader myHeader;
+	int myPositionBits = 16;
+	std::vector<uint64_t> myOffsets;
+	std::vector<std::vector<int32_t>> myPrevious;
+};
+
+// read only memory mapping of a whole file.
+class MappedFile {
+public:
+	~MappedFile() {
+		close();
+	}
+
+	bool open(const std::string& path) {
+		close();
+#ifdef _WIN32
+		myFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (myFile == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER size;
+		GetFileSizeEx(myFile, &size);
+		mySize = (size_t)size.QuadPart;
+		myMapping = mySize ? CreateFileMappingA(myFile, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+		myData = myMapping ? (const uint8_t*)MapViewOfFile(myMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else // macOS
+		myFile = ::open(path.c_str(), O_RDONLY);
+		if (myFile < 0) {
+			return false;
+		}
+		struct stat info;
+		fstat(myFile, &info);
+		mySize = (size_t)info.st_size;
+		void* data = mySize ? mmap(nullptr, mySize, PROT_READ, MAP_PRIVATE, myFile, 0) : MAP_FAILED;
+		myData = data != MAP_FAILED ? (const uint8_t*)data : nullptr;
+#endif
+		if (!myData) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close() {
+#ifdef _WIN32
+		if (myData) {
+			UnmapViewOfFile(myData);
+		}
+		if (myMapping) {
+			CloseHandle(myMapping);
+		}
+		if (myFile != INVALID_HANDLE_VALUE) {
+			CloseHandle(myFile);
+		}
+		myMapping = nullptr;
+		myFile = INVALID_HANDLE_VALUE;
+#else // macOS
+		if (myData) {
+			munmap((void*)myData, mySize);
+		}
+		if (myFile >= 0) {
+			::close(myFile);
+		}
+		myFile = -1;
+#endif
+		myData = nullptr;
+		mySize = 0;
+	}
+
+	const uint8_t* data() const {
+		return myData;
+	}
+
+	size_t size() const {
+		return mySize;
+	}
+
+private:
+	const uint8_t* myData = nullptr;
+	size_t mySize = 0;
+#ifdef _WIN32
+	HANDLE myFile = INVALID_HANDLE_VALUE;
+	HANDLE myMapping = nullptr;
+#else // macOS
+	int myFile = -1;
+#endif
+};
+
+// plays back a sequence cache.
+class SequenceCacheReader {
+public:
+	// path of the open cache, empty if none is open.
+	const std::string& path() const {
+		return myPath;
+	}
+
+	const SequenceCacheHeader& header() const {
+		return myHeader;
+	}
+
+	bool open(const std::string& path, std::string& error) {
+		close();
+		if (!myFile.open(path)) {
+			error = "Sequence cache can't be opened.";
+			return false;
+		}
+
+		// the header and the frame index have to make sense before anything is decoded.
+		bool valid = myFile.size() >= sizeof(SequenceCacheHeader);
+		if (valid) {
+			memcpy(&myHeader, myFile.data(), sizeof(myHeader));
+			valid = myHeader.magic == kSequenceCacheMagic && myHeader.version == kSequenceCacheVersion && myHeader.frameCount > 0
+				&& myHeader.keyframeInterval > 0
+				&& myHeader.indexOffset + (myHeader.frameCount + 1) * sizeof(uint64_t) <= myFile.size();
+		}
+		if (valid) {
+			myOffsets.resize(myHeader.frameCount + 1);
+			memcpy(myOffsets.data(), myFile.data() + myHeader.indexOffset, myOffsets.size() * sizeof(uint64_t));
+			for (uint32_t frame = 0; frame < myHeader.frameCount && valid; frame++) {
+				valid = myOffsets[frame] % 4 == 0 && myOffsets[frame] + 4 <= myOffsets[frame + 1]
+					&& myOffsets[frame + 1] <= myHeader.indexOffset;
+			}
+		}
+		if (!valid) {
+			close();
+			error = "Sequence cache is damaged or not a sequence cache.";
+			return false;
+		}
+
+		myPath = path;
+		myState.assign(kSequenceCacheStreams, std::vector<int32_t>(myHeader.vertexCount, 0));
+		return true;
+	}
+
+	void close() {
+		myFile.close();
+		myPath.clear();
+		myHeader = SequenceCacheHeader();
+		myOffsets.clear();
+		myState.clear();
+		myDecoded = -1;
+	}
+
+	// decodes the positions and normals of frame (clamped to the cached range) into mesh, which has to have the cache's
+	// vertex count. plays forward from the last decoded frame if it's between frame and its keyframe.
+	bool decode(int frame, Mesh& mesh) {
+		TraceScope span("cache decode", myPath.c_str());
+		if (mesh.Position_Data.size() != myHeader.vertexCount) {
+			return false;
+		}
+		int index = std::min(std::max(frame - myHeader.firstFrame, 0), (int)myHeader.frameCount - 1);
+		int keyframe = index - index % (int)myHeader.keyframeInterval;
+		int start = myDecoded >= keyframe && myDecoded <= index ? myDecoded + 1 : keyframe;
+
+		for (int current = start; current <= index; current++) {
+			const uint32_t* data = (const uint32_t*)(myFile.data() + myOffsets[current]);
+			const uint32_t* end = (const uint32_t*)(myFile.data() + myOffsets[current + 1]);
+			bool isKeyframe = data[0] != 0;
+			data++;
+			for (int stream = 0; stream < kSequenceCacheStreams && data; stream++) {
+				data = decode_stream(data, end, isKeyframe, myState[stream]);
+			}
+			if (!data) {
+				myDecoded = -1;
+				return false;
+			}
+			myDecoded = current;
+		}
+
+		int count = (int)myHeader.vertexCount;
+		bool hasTbnQuat = mesh.TbnQuat_Data.size() == mesh.Position_Data.size() * 4 && mesh.Bitangent_Data.size() == mesh.Position_Data.size() * 3;
+		parallel_for((count + 4095) / 4096, [&](int chunk) {
+			int end = std::min(count, (chunk + 1) * 4096);
+			for (int v = chunk * 4096; v < end; v++) {
+				mesh.Position_Data[v] = Position(
+					myHeader.origin[0] + myState[0][v] * myHeader.step,
+					myHeader.origin[1] + myState[1][v] * myHeader.step,
+					myHeader.origin[2] + myState[2][v] * myHeader.step);
+				mesh.Normal_Data[v] = oct_decode(myState[3][v], myState[4][v]);
+
+				// only the normals are cached, the tangents are the first frame's.
+				if (hasTbnQuat) {
+					const Vector& decoded = mesh.Normal_Data[v];
+					float normal[3] = { decoded.x, decoded.y, decoded.z };
+					orthogonal_tbn_to_quat(normal, &mesh.Tangent_Data[v * 4], &mesh.Bitangent_Data[v * 3], &mesh.TbnQuat_Data[v * 4]);
+				}
+			}
+		});
+		return true;
+	}
+
+private:
+	MappedFile myFile;
+	std::string myPath;
+	SequenceCacheHeader myHeader;
+	std::vector<uint64_t> myOffsets;
+	std::vector<std::vector<int32_t>> myState; // quantized values of the last decoded frame, one vector per stream.
+	int myDecoded = -1; // index of the last decoded frame, -1 if the state is not valid.
+};
+
+// reads frames first to last of a sequence and writes them to a sequence cache. every frame has to have the topology
+// of the first one. returns the size of the cache, or 0 and sets error.
+uint64_t write_sequence_cache(const std::string& path, const std::string& pattern, int firstFrame, int lastFrame,
+	unsigned int flags, const FlattenOptions& options, int keyframeInterval, int positionBits, std::string& error) {
+
+	SequenceCacheWriter writer;
+	Mesh mesh;
+	uint64_t topologyHash = 0;
+
+	TraceScope span("cache write", path.c_str());
+	for (int frame = firstFrame; frame <= lastFrame; frame++) {
+		TraceScope frameSpan("cache frame", sequence_file(pattern, frame).c_str());
+		Assimp::Importer importer;
+		importer.SetPropertyString(AI_CONFIG_PP_OG_EXCLUDE_LIST, optimize_graph_keep_list(options));
+		const aiScene* scene = importer.ReadFile(sequence_file(pattern, frame), flags);
+		if (nullptr == scene) {
+			error = "Sequence cache: frame " + std::to_string(frame) + " does not exist or failed to load.";
+			break;
+		}
+
+		Mesh instanceTable;
+		std::vector<const aiNode*> referenceNodes;
+		uint64_t hash = scene_topology_hash(scene, flatten_instances(scene, options, instanceTable, referenceNodes));
+
+		if (frame == firstFrame) {
+			flatten_scene(scene, mesh, options);
+			topologyHash = hash;
+			if (!writer.open(path, firstFrame, keyframeInterval, positionBits, topologyHash)) {
+				error = "Sequence cache can't be written.";
+				return 0;
+			}
+		}
+		else if (hash != topologyHash || !flatten_positions(scene, mesh, options)) {
+			error = "Sequence cache: frame " + std::to_string(frame) + " has a different topology than the first frame.";
+			break;
+		}
+
+		if (!writer.add_frame(mesh)) {
+			error = "Sequence cache can't be written.";
+			break;
+		}
+	}
+
+	if (!writer.is_open()) {
+		return 0;
+	}
+	if (!error.empty()) {
+		writer.discard();
+		return 0;
+	}
+	uint64_t size = writer.close();
+	if (size == 0) {
+		error = "Sequence cache can't be written.";
+		std::remove(path.c_str());
+	}
+	return size;
+}
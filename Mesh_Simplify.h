@@ -0,0 +1,523 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+#include "DataAndTypes.h"
+#include "Parallel.h"
+
+/*
+Quadric error metric mesh simplification (Garland & Heckbert), used to generate the LOD levels.
+
+Like meshoptimizer's simplifier, this never creates new vertices, it only collapses an edge onto one of its existing
+end points. That means every LOD level can keep using the vertex data of the full resolution mesh, and simplifying is
+just a matter of producing a new (smaller) index buffer.
+
+A few rules keep the result clean:
+- vertices on open edges are locked. uv/normal seams show up as open edges since the two sides use different vertices,
+  so seams and mesh borders both stay put.
+- collapses that would flip a triangle are rejected.
+- the cost of a collapse is the positional quadric error, plus an attribute term for how much the normal and uv differ
+  between the two vertices, so we prefer to collapse across flat and evenly mapped areas.
+
+Big meshes are split into a grid of spatial partitions that are simplified in parallel, with the vertices shared between
+partitions locked. A final pass over the whole mesh then cleans up along the partition boundaries.
+*/
+
+// meshes smaller than this are not worth partitioning.
+const size_t kSimplifyPartitionMinTris = 100000;
+
+struct SimplifyOptions {
+	float normalWeight = 1.0f; // cost of collapsing across a normal change, 1 - dot(n0, n1).
+	float uvWeight = 1.0f; // cost of collapsing across a uv change, squared uv distance.
+};
+
+// symmetric 4x4 plane quadric, only the 10 unique coefficients are stored.
+struct Quadric {
+	float a00 = 0, a11 = 0, a22 = 0;
+	float a01 = 0, a02 = 0, a12 = 0;
+	float b0 = 0, b1 = 0, b2 = 0;
+	float c = 0;
+};
+
+void quadric_from_plane(Quadric& q, float a, float b, float c, float d, float weight) {
+	q.a00 = a * a * weight; q.a11 = b * b * weight; q.a22 = c * c * weight;
+	q.a01 = a * b * weight; q.a02 = a * c * weight; q.a12 = b * c * weight;
+	q.b0 = a * d * weight; q.b1 = b * d * weight; q.b2 = c * d * weight;
+	q.c = d * d * weight;
+}
+
+void quadric_add(Quadric& q, const Quadric& r) {
+	q.a00 += r.a00; q.a11 += r.a11; q.a22 += r.a22;
+	q.a01 += r.a01; q.a02 += r.a02; q.a12 += r.a12;
+	q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+	q.c += r.c;
+}
+
+// squared distance (area weighted) of the point from all the planes accumulated in the quadric.
+float quadric_error(const Quadric& q, const float p[3]) {
+	float rx = q.a00 * p[0] + q.a01 * p[1] + q.a02 * p[2];
+	float ry = q.a01 * p[0] + q.a11 * p[1] + q.a12 * p[2];
+	float rz = q.a02 * p[0] + q.a12 * p[1] + q.a22 * p[2];
+
+	float r = rx * p[0] + ry * p[1] + rz * p[2];
+	r += 2 * (q.b0 * p[0] + q.b1 * p[1] + q.b2 * p[2]);
+	r += q.c;
+
+	return std::fabs(r);
+}
+
+// merges vertices that are exact duplicates in every attribute, returns a remap table from vertex to its canonical copy.
+// the mikktspace path emits 3 unique vertices per triangle, so without this nothing there would be connected.
+std::vector<int32_t> weld_remap(const Mesh& mesh) {
+	int vertexCount = (int)mesh.Position_Data.size();
+	std::vector<int32_t> remap(vertexCount);
+
+	bool hasTbnQuat = mesh.TbnQuat_Data.size() == (size_t)vertexCount * 4;
+
+	auto hash_vertex = [&](int v) {
+		uint32_t h = 2166136261u;
+		auto mix = [&h](const void* data, size_t size) {
+			const unsigned char* bytes = (const unsigned char*)data;
+			for (size_t i = 0; i < size; i++) {
+				h = (h ^ bytes[i]) * 16777619u;
+			}
+		};
+		mix(&mesh.Position_Data[v], sizeof(Position));
+		mix(&mesh.Normal_Data[v], sizeof(Vector));
+		mix(&mesh.Uv_Data[v], sizeof(TexCoord));
+		mix(&mesh.MeshId_Data[v], sizeof(int32_t));
+		return h;
+	};
+
+	auto equal_vertex = [&](int a, int b) {
+		return memcmp(&mesh.Position_Data[a], &mesh.Position_Data[b], sizeof(Position)) == 0
+			&& memcmp(&mesh.Normal_Data[a], &mesh.Normal_Data[b], sizeof(Vector)) == 0
+			&& memcmp(&mesh.Uv_Data[a], &mesh.Uv_Data[b], sizeof(TexCoord)) == 0
+			&& mesh.MeshId_Data[a] == mesh.MeshId_Data[b]
+			&& memcmp(&mesh.Color_Data[a], &mesh.Color_Data[b], sizeof(Color)) == 0
+			&& memcmp(&mesh.Tangent_Data[a * 4], &mesh.Tangent_Data[b * 4], sizeof(float) * 4) == 0
+			&& memcmp(&mesh.Bitangent_Data[a * 3], &mesh.Bitangent_Data[b * 3], sizeof(float) * 3) == 0
+			&& (!hasTbnQuat || memcmp(&mesh.TbnQuat_Data[a * 4], &mesh.TbnQuat_Data[b * 4], sizeof(float) * 4) == 0);
+	};
+
+	// open addressing hash table, power of two size with at least 2x headroom.
+	size_t tableSize = 1;
+	while (tableSize < (size_t)vertexCount * 2) {
+		tableSize *= 2;
+	}
+	std::vector<int32_t> table(tableSize, -1);
+
+	for (int v = 0; v < vertexCount; v++) {
+		size_t slot = hash_vertex(v) & (tableSize - 1);
+
+		while (table[slot] != -1 && !equal_vertex(table[slot], v)) {
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		if (table[slot] == -1) {
+			table[slot] = v;
+		}
+		remap[v] = table[slot];
+	}
+
+	return remap;
+}
+
+// simplifies a set of triangles down to (at most) targetTris. indices refer to the vertices of mesh, and the result does too.
+// vertices flagged in locked (if not empty) are never collapsed, that's how the partition boundaries are kept intact.
+std::vector<int32_t> simplify_cluster(const std::vector<int32_t>& clusterIndices, const Mesh& mesh, const std::vector<unsigned char>& locked, size_t targetTris, const SimplifyOptions& options) {
+
+	// work on a compact local copy of the vertices this cluster uses, so the cluster can be processed independently of the others.
+	std::vector<int32_t> vertices(clusterIndices);
+	std::sort(vertices.begin(), vertices.end());
+	vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+	int vertexCount = (int)vertices.size();
+
+	std::vector<int32_t> indices(clusterIndices.size());
+	for (size_t i = 0; i < clusterIndices.size(); i++) {
+		indices[i] = (int32_t)(std::lower_bound(vertices.begin(), vertices.end(), clusterIndices[i]) - vertices.begin());
+	}
+
+	// positions are normalized into the unit cube, float quadrics lose a lot of precision on far away geometry otherwise.
+	float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (int32_t v : vertices) {
+		const Position& p = mesh.Position_Data[v];
+		minP[0] = std::min(minP[0], p.x); maxP[0] = std::max(maxP[0], p.x);
+		minP[1] = std::min(minP[1], p.y); maxP[1] = std::max(maxP[1], p.y);
+		minP[2] = std::min(minP[2], p.z); maxP[2] = std::max(maxP[2], p.z);
+	}
+	float extent = std::max(maxP[0] - minP[0], std::max(maxP[1] - minP[1], maxP[2] - minP[2]));
+	float scale = extent > 0 ? 1.0f / extent : 0.0f;
+
+	std::vector<float> positions(vertexCount * 3);
+	for (int i = 0; i < vertexCount; i++) {
+		const Position& p = mesh.Position_Data[vertices[i]];
+		positions[i * 3 + 0] = (p.x - minP[0]) * scale;
+		positions[i * 3 + 1] = (p.y - minP[1]) * scale;
+		positions[i * 3 + 2] = (p.z - minP[2]) * scale;
+	}
+
+	// lock anything on an edge that isn't shared by exactly two triangles (borders, seams and non manifold edges).
+	std::vector<unsigned char> vertexLocked(vertexCount, 0);
+	for (int i = 0; i < vertexCount; i++) {
+		vertexLocked[i] = locked.empty() ? 0 : locked[vertices[i]];
+	}
+	{
+		std::vector<uint64_t> edges;
+		edges.reserve(indices.size());
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			for (int e = 0; e < 3; e++) {
+				uint32_t a = indices[i + e];
+				uint32_t b = indices[i + (e + 1) % 3];
+				edges.push_back(a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		for (size_t i = 0; i < edges.size();) {
+			size_t j = i;
+			while (j < edges.size() && edges[j] == edges[i]) {
+				j++;
+			}
+			if (j - i != 2) {
+				vertexLocked[edges[i] >> 32] = 1;
+				vertexLocked[edges[i] & 0xffffffff] = 1;
+			}
+			i = j;
+		}
+	}
+
+	// accumulate the area weighted plane of every triangle into its 3 vertices.
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		const float* p0 = &positions[indices[i + 0] * 3];
+		const float* p1 = &positions[indices[i + 1] * 3];
+		const float* p2 = &positions[indices[i + 2] * 3];
+
+		float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		float n[3];
+		cross(e1, e2, n);
+		float area = length(n);
+		if (area == 0) {
+			continue;
+		}
+		n[0] /= area; n[1] /= area; n[2] /= area;
+
+		Quadric q;
+		quadric_from_plane(q, n[0], n[1], n[2], -dot(n, p0), area);
+		quadric_add(quadrics[indices[i + 0]], q);
+		quadric_add(quadrics[indices[i + 1]], q);
+		quadric_add(quadrics[indices[i + 2]], q);
+	}
+
+	// cost of collapsing v onto t.
+	auto collapse_cost = [&](int32_t v, int32_t t) {
+		const float* pv = &positions[v * 3];
+		const float* pt = &positions[t * 3];
+		float d[3] = { pt[0] - pv[0], pt[1] - pv[1], pt[2] - pv[2] };
+		float edgeLength2 = dot(d, d);
+
+		const Vector& nv = mesh.Normal_Data[vertices[v]];
+		const Vector& nt = mesh.Normal_Data[vertices[t]];
+		float normalError = 1.0f - (nv.x * nt.x + nv.y * nt.y + nv.z * nt.z);
+
+		const TexCoord& uvv = mesh.Uv_Data[vertices[v]];
+		const TexCoord& uvt = mesh.Uv_Data[vertices[t]];
+		float uvError = (uvv.u - uvt.u) * (uvv.u - uvt.u) + (uvv.v - uvt.v) * (uvv.v - uvt.v);
+
+		return quadric_error(quadrics[v], pt) + edgeLength2 * (options.normalWeight * normalError + options.uvWeight * uvError);
+	};
+
+	struct Collapse {
+		int32_t v; // vertex that goes away.
+		int32_t t; // vertex it collapses onto.
+		float cost;
+	};
+
+	std::vector<int32_t> adjacencyOffsets;
+	std::vector<int32_t> adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned char> touched;
+
+	size_t triCount = indices.size() / 3;
+
+	while (triCount > targetTris) {
+
+		// vertex to triangle adjacency for the current index buffer, needed for the flip check.
+		adjacencyOffsets.assign(vertexCount + 1, 0);
+		for (int32_t v : indices) {
+			adjacencyOffsets[v + 1]++;
+		}
+		for (int v = 0; v < vertexCount; v++) {
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		}
+		adjacency.resize(indices.size());
+		{
+			std::vector<int32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++) {
+				adjacency[fill[indices[i]]++] = (int32_t)(i / 3);
+			}
+		}
+
+		// every interior edge shows up once as a < b, borders are locked so we don't need them.
+		collapses.clear();
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			for (int e = 0; e < 3; e++) {
+				int32_t a = indices[i + e];
+				int32_t b = indices[i + (e + 1) % 3];
+				if (a > b || (vertexLocked[a] && vertexLocked[b])) {
+					continue;
+				}
+
+				float costAB = vertexLocked[a] ? FLT_MAX : collapse_cost(a, b);
+				float costBA = vertexLocked[b] ? FLT_MAX : collapse_cost(b, a);
+				collapses.push_back(costAB <= costBA ? Collapse{ a, b, costAB } : Collapse{ b, a, costBA });
+			}
+		}
+
+		if (collapses.empty()) {
+			break;
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		// each collapse removes 2 triangles on a closed surface, so only do as many as we need this pass.
+		size_t collapsesNeeded = (triCount - targetTris) / 2 + 1;
+		size_t collapsesDone = 0;
+		touched.assign(vertexCount, 0);
+
+		for (const Collapse& c : collapses) {
+			if (touched[c.v] || touched[c.t]) {
+				continue;
+			}
+
+			// reject the collapse if any triangle around v (that doesn't contain t) would flip or fold over.
+			bool flips = false;
+			for (int32_t k = adjacencyOffsets[c.v]; k < adjacencyOffsets[c.v + 1] && !flips; k++) {
+				const int32_t* tri = &indices[adjacency[k] * 3];
+				if (tri[0] == c.t || tri[1] == c.t || tri[2] == c.t) {
+					continue;
+				}
+
+				const float* p[3];
+				const float* q[3];
+				for (int j = 0; j < 3; j++) {
+					p[j] = &positions[tri[j] * 3];
+					q[j] = tri[j] == c.v ? &positions[c.t * 3] : p[j];
+				}
+
+				float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+				float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+				float f1[3] = { q[1][0] - q[0][0], q[1][1] - q[0][1], q[1][2] - q[0][2] };
+				float f2[3] = { q[2][0] - q[0][0], q[2][1] - q[0][1], q[2][2] - q[0][2] };
+				float nOld[3], nNew[3];
+				cross(e1, e2, nOld);
+				cross(f1, f2, nNew);
+
+				// more than ~75 degrees of rotation counts as a flip.
+				flips = dot(nOld, nNew) <= 0.25f * length(nOld) * length(nNew);
+			}
+			if (flips) {
+				continue;
+			}
+
+			quadric_add(quadrics[c.t], quadrics[c.v]);
+
+			// rewrite the triangles around v right away, and keep the whole one ring out of any other collapse this pass.
+			for (int32_t k = adjacencyOffsets[c.v]; k < adjacencyOffsets[c.v + 1]; k++) {
+				int32_t* tri = &indices[adjacency[k] * 3];
+				for (int j = 0; j < 3; j++) {
+					touched[tri[j]] = 1;
+					if (tri[j] == c.v) {
+						tri[j] = c.t;
+					}
+				}
+			}
+
+			collapsesDone++;
+			if (collapsesDone >= collapsesNeeded) {
+				break;
+			}
+		}
+
+		if (collapsesDone == 0) {
+			break;
+		}
+
+		// drop the triangles that collapsed to a line.
+		size_t write = 0;
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			int32_t a = indices[i + 0], b = indices[i + 1], c = indices[i + 2];
+			if (a == b || b == c || a == c) {
+				continue;
+			}
+			indices[write++] = a;
+			indices[write++] = b;
+			indices[write++] = c;
+		}
+		indices.resize(write);
+		triCount = indices.size() / 3;
+	}
+
+	// back to the mesh's vertex numbering.
+	for (int32_t& index : indices) {
+		index = vertices[index];
+	}
+
+	return indices;
+}
+
+// simplifies the mesh (as described by indices) down to about targetTris triangles.
+// big meshes are partitioned spatially and the partitions simplified in parallel.
+std::vector<int32_t> simplify_mesh(const std::vector<int32_t>& indices, const Mesh& mesh, size_t targetTris, const SimplifyOptions& options) {
+	size_t triCount = indices.size() / 3;
+	if (targetTris >= triCount) {
+		return indices;
+	}
+
+	std::vector<int32_t> result;
+
+	int grid = triCount >= kSimplifyPartitionMinTris ? (int)std::ceil(std::cbrt(worker_count() * 2.0)) : 1;
+
+	if (grid <= 1) {
+		result = indices;
+	}
+	else {
+		float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (int32_t v : indices) {
+			const Position& p = mesh.Position_Data[v];
+			minP[0] = std::min(minP[0], p.x); maxP[0] = std::max(maxP[0], p.x);
+			minP[1] = std::min(minP[1], p.y); maxP[1] = std::max(maxP[1], p.y);
+			minP[2] = std::min(minP[2], p.z); maxP[2] = std::max(maxP[2], p.z);
+		}
+
+		// assign each triangle to the grid cell its centroid is in.
+		int cellCount = grid * grid * grid;
+		std::vector<std::vector<int32_t>> cellIndices(cellCount);
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			int cell[3];
+			for (int axis = 0; axis < 3; axis++) {
+				float centroid = 0;
+				for (int k = 0; k < 3; k++) {
+					const Position& p = mesh.Position_Data[indices[i + k]];
+					centroid += axis == 0 ? p.x : axis == 1 ? p.y : p.z;
+				}
+				centroid /= 3;
+				float size = maxP[axis] - minP[axis];
+				int c = size > 0 ? (int)((centroid - minP[axis]) / size * grid) : 0;
+				cell[axis] = std::min(std::max(c, 0), grid - 1);
+			}
+			std::vector<int32_t>& target = cellIndices[(cell[2] * grid + cell[1]) * grid + cell[0]];
+			target.insert(target.end(), indices.begin() + i, indices.begin() + i + 3);
+		}
+
+		// vertices used by more than one cell are locked, so the partitions can't pull apart from each other.
+		std::vector<int32_t> owner(mesh.Position_Data.size(), -1);
+		std::vector<unsigned char> locked(mesh.Position_Data.size(), 0);
+		for (int cell = 0; cell < cellCount; cell++) {
+			for (int32_t v : cellIndices[cell]) {
+				if (owner[v] == -1) {
+					owner[v] = cell;
+				}
+				else if (owner[v] != cell) {
+					locked[v] = 1;
+				}
+			}
+		}
+
+		double ratio = (double)targetTris / (double)triCount;
+		std::vector<std::vector<int32_t>> cellResults(cellCount);
+
+		parallel_for(cellCount, [&](int cell) {
+			if (cellIndices[cell].empty()) {
+				return;
+			}
+			size_t cellTarget = (size_t)(cellIndices[cell].size() / 3 * ratio);
+			cellResults[cell] = simplify_cluster(cellIndices[cell], mesh, locked, cellTarget, options);
+		});
+
+		for (const std::vector<int32_t>& cellResult : cellResults) {
+			result.insert(result.end(), cellResult.begin(), cellResult.end());
+		}
+	}
+
+	// a final pass over the whole mesh, which cleans up along the partition boundaries and hits the exact target.
+	std::vector<unsigned char> noLocks;
+	return simplify_cluster(result, mesh, noLocks, targetTris, options);
+}
+
+// reorders the triangles so they are grouped by source mesh again (the partitioned simplifier mixes them up),
+// and fills in offsets with the first triangle of each source mesh. the order within a mesh is kept.
+void group_by_mesh(std::vector<int32_t>& indices, const std::vector<int32_t>& meshIds, int meshCount, std::vector<int>& offsets) {
+	int triCount = (int)indices.size() / 3;
+
+	offsets.assign(meshCount + 1, 0);
+	for (int i = 0; i < triCount; i++) {
+		offsets[meshIds[indices[i * 3]] + 1]++;
+	}
+	for (int m = 0; m < meshCount; m++) {
+		offsets[m + 1] += offsets[m];
+	}
+
+	std::vector<int32_t> grouped(indices.size());
+	std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+	for (int i = 0; i < triCount; i++) {
+		int tri = fill[meshIds[indices[i * 3]]]++;
+		grouped[tri * 3 + 0] = indices[i * 3 + 0];
+		grouped[tri * 3 + 1] = indices[i * 3 + 1];
+		grouped[tri * 3 + 2] = indices[i * 3 + 2];
+	}
+
+	indices.swap(grouped);
+}
+
+// builds a standalone mesh that only contains the vertices used by indices, in the order they are first used.
+// triangles are grouped by source mesh, same as the flattened mesh.
+Mesh compact_mesh(const Mesh& mesh, const std::vector<int32_t>& indices) {
+	Mesh compact;
+
+	std::vector<int32_t> grouped(indices);
+	group_by_mesh(grouped, mesh.MeshId_Data, (int)mesh.MeshFace_Offsets.size() - 1, compact.MeshFace_Offsets);
+	compact.NodeName_Data = mesh.NodeName_Data;
+	compact.MeshName_Data = mesh.MeshName_Data;
+
+	bool hasJoints = mesh.JointIndex_Data.size() == mesh.Position_Data.size() * 4;
+
+	bool hasTbnQuat = mesh.TbnQuat_Data.size() == mesh.Position_Data.size() * 4;
+	std::vector<int32_t> remap(mesh.Position_Data.size(), -1);
+
+	compact.FaceIndex_Data.reserve(grouped.size());
+	for (int32_t v : grouped) {
+		if (remap[v] == -1) {
+			remap[v] = (int32_t)compact.Position_Data.size();
+
+			compact.MeshId_Data.push_back(mesh.MeshId_Data[v]);
+			compact.SourceVertex_Data.push_back(mesh.SourceVertex_Data.empty() ? v : mesh.SourceVertex_Data[v]);
+			compact.Position_Data.push_back(mesh.Position_Data[v]);
+			compact.Normal_Data.push_back(mesh.Normal_Data[v]);
+			compact.Uv_Data.push_back(mesh.Uv_Data[v]);
+			compact.Color_Data.push_back(mesh.Color_Data[v]);
+			compact.Tangent_Data.insert(compact.Tangent_Data.end(), mesh.Tangent_Data.begin() + v * 4, mesh.Tangent_Data.begin() + v * 4 + 4);
+			compact.Bitangent_Data.insert(compact.Bitangent_Data.end(), mesh.Bitangent_Data.begin() + v * 3, mesh.Bitangent_Data.begin() + v * 3 + 3);
+			if (hasJoints) {
+				compact.JointIndex_Data.insert(compact.JointIndex_Data.end(), mesh.JointIndex_Data.begin() + v * 4, mesh.JointIndex_Data.begin() + v * 4 + 4);
+				compact.JointWeight_Data.insert(compact.JointWeight_Data.end(), mesh.JointWeight_Data.begin() + v * 4, mesh.JointWeight_Data.begin() + v * 4 + 4);
+			}
+			if (hasTbnQuat) {
+				compact.TbnQuat_Data.insert(compact.TbnQuat_Data.end(), mesh.TbnQuat_Data.begin() + v * 4, mesh.TbnQuat_Data.begin() + v * 4 + 4);
+			}
+		}
+		compact.FaceIndex_Data.push_back(remap[v]);
+	}
+
+	compact.numTris = (int)grouped.size() / 3;
+	return compact;
+}
@@ -0,0 +1,349 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+
+#include "DataAndTypes.h"
+#include "Parallel.h"
+#include "Mesh_Transform.h"
+
+/*
+Skeletal skinning.
+
+flatten_scene collects a Skeleton from the aiBones of every mesh it converts, and packs the 4 strongest joint influences
+of every vertex into JointIndex_Data / JointWeight_Data (weights normalized, unused slots are joint 0 with weight 0).
+
+The vertices are flattened into world space, so the bind matrix of a joint is the aiBone offset matrix times the inverse
+world matrix of the mesh node, ie. it takes a flattened vertex back into bone space. the same bone used by meshes under
+different node transforms becomes separate joints.
+
+A pose is a local transform per skeleton node, skeleton_worlds turns it into world matrices, and skeleton_pose into
+one skin matrix per joint:
+	skin = world(joint node) * bind
+in the rest pose this is the identity (for the usual files where the bone offsets match the hierarchy), and the mesh
+comes out as flattened. skin_mesh is the CPU path, plain linear blend skinning of positions, normals and tangents.
+vertices with no weights at all (meshes without bones in a skinned scene) are left rigid.
+*/
+
+// number of joint influences kept per vertex, packed into one vec4 attribute.
+const int kSkinInfluences = 4;
+
+// vertices skinned per work item, small enough to balance, big enough to not be dominated by the counter.
+const int kSkinChunk = 4096;
+
+// assimp (row major) matrix to column major floats.
+void matrix_to_column_major(const aiMatrix4x4& m, float out[16]) {
+	const float rows[4][4] = {
+		{ m.a1, m.a2, m.a3, m.a4 },
+		{ m.b1, m.b2, m.b3, m.b4 },
+		{ m.c1, m.c2, m.c3, m.c4 },
+		{ m.d1, m.d2, m.d3, m.d4 },
+	};
+	for (int col = 0; col < 4; col++) {
+		for (int row = 0; row < 4; row++) {
+			out[col * 4 + row] = rows[row][col];
+		}
+	}
+}
+
+// out = a * b, all column major. out may not alias a or b.
+void multiply_matrices(const float a[16], const float b[16], float out[16]) {
+	for (int col = 0; col < 4; col++) {
+		for (int row = 0; row < 4; row++) {
+			out[col * 4 + row] =
+				a[0 * 4 + row] * b[col * 4 + 0] +
+				a[1 * 4 + row] * b[col * 4 + 1] +
+				a[2 * 4 + row] * b[col * 4 + 2] +
+				a[3 * 4 + row] * b[col * 4 + 3];
+		}
+	}
+}
+
+// adds a node and all its ancestors to the skeleton (ancestors first), and returns its index.
+int skeleton_add_node(Skeleton& skeleton, std::unordered_map<const aiNode*, int>& nodeIndex, const aiNode* node) {
+	auto found = nodeIndex.find(node);
+	if (found != nodeIndex.end()) {
+		return found->second;
+	}
+
+	int parent = node->mParent ? skeleton_add_node(skeleton, nodeIndex, node->mParent) : -1;
+
+	int index = (int)skeleton.nodeNames.size();
+	nodeIndex[node] = index;
+	skeleton.nodeNames.push_back(node->mName.C_Str());
+	skeleton.nodeParents.push_back(parent);
+	skeleton.nodeLocals.resize(skeleton.nodeLocals.size() + 16);
+	matrix_to_column_major(node->mTransformation, &skeleton.nodeLocals[index * 16]);
+	return index;
+}
+
+// builds the skeleton from the bones of every instance, and returns the joint index of every bone, per instance.
+// bones whose node can't be found get joint -1, and their weights are dropped.
+// nodeIndex gets the skeleton node of every aiNode added, so animated nodes can be added to the same skeleton later.
+std::vector<std::vector<int>> collect_skeleton(const aiScene* scene, const std::vector<MeshInstance>& instances, Skeleton& skeleton,
+	std::unordered_map<const aiNode*, int>& nodeIndex) {
+	skeleton = Skeleton();
+	nodeIndex.clear();
+	std::vector<std::vector<int>> boneJoints(instances.size());
+
+	for (size_t inst = 0; inst < instances.size(); inst++) {
+		const MeshInstance& instance = instances[inst];
+		const aiMesh* source = scene->mMeshes[instance.meshIndex];
+		if (!source->HasBones() || scene->mRootNode == nullptr) {
+			continue;
+		}
+
+		// world matrix of the mesh node, back to assimp's row major to invert it.
+		const float* w = instance.world;
+		aiMatrix4x4 inverseWorld(
+			w[0], w[4], w[8], w[12],
+			w[1], w[5], w[9], w[13],
+			w[2], w[6], w[10], w[14],
+			w[3], w[7], w[11], w[15]);
+		inverseWorld.Inverse();
+
+		for (unsigned int bone_index = 0; bone_index < source->mNumBones; bone_index++) {
+			const aiBone* bone = source->mBones[bone_index];
+			const aiNode* node = scene->mRootNode->FindNode(bone->mName);
+			if (node == nullptr) {
+				boneJoints[inst].push_back(-1);
+				continue;
+			}
+
+			int skeletonNode = skeleton_add_node(skeleton, nodeIndex, node);
+			float bind[16];
+			matrix_to_column_major(bone->mOffsetMatrix * inverseWorld, bind);
+
+			// meshes of one character usually share their joints, only add a new one if the bind differs.
+			int joint = -1;
+			for (int j = 0; j < (int)skeleton.jointNodes.size() && joint == -1; j++) {
+				if (skeleton.jointNodes[j] == skeletonNode && std::equal(bind, bind + 16, &skeleton.jointBinds[j * 16])) {
+					joint = j;
+				}
+			}
+			if (joint == -1) {
+				joint = (int)skeleton.jointNodes.size();
+				skeleton.jointNodes.push_back(skeletonNode);
+				skeleton.jointBinds.insert(skeleton.jointBinds.end(), bind, bind + 16);
+			}
+			boneJoints[inst].push_back(joint);
+		}
+	}
+
+	return boneJoints;
+}
+
+// packs the strongest kSkinInfluences joints of every vertex of an instance, normalized so the weights sum to 1.
+// gather is the assimp vertex of every output vertex (mikktspace corners), or nullptr if they map 1:1.
+void gather_skin_weights(const aiMesh* source, const std::vector<int>& boneJoints, const unsigned int* gather, int numVerts,
+	int32_t* jointIndices, float* jointWeights) {
+
+	std::vector<int32_t> indices(source->mNumVertices * kSkinInfluences, 0);
+	std::vector<float> weights(source->mNumVertices * kSkinInfluences, 0.0f);
+
+	for (unsigned int bone_index = 0; bone_index < source->mNumBones; bone_index++) {
+		int joint = boneJoints[bone_index];
+		if (joint < 0) {
+			continue;
+		}
+		const aiBone* bone = source->mBones[bone_index];
+		for (unsigned int i = 0; i < bone->mNumWeights; i++) {
+			const aiVertexWeight& weight = bone->mWeights[i];
+			if (weight.mVertexId >= source->mNumVertices) {
+				continue;
+			}
+			int32_t* vi = &indices[weight.mVertexId * kSkinInfluences];
+			float* vw = &weights[weight.mVertexId * kSkinInfluences];
+
+			// insertion into the sorted top list, the weakest falls off the end.
+			for (int k = 0; k < kSkinInfluences; k++) {
+				if (weight.mWeight > vw[k]) {
+					for (int m = kSkinInfluences - 1; m > k; m--) {
+						vw[m] = vw[m - 1];
+						vi[m] = vi[m - 1];
+					}
+					vw[k] = weight.mWeight;
+					vi[k] = joint;
+					break;
+				}
+			}
+		}
+	}
+
+	for (unsigned int v = 0; v < source->mNumVertices; v++) {
+		float* vw = &weights[v * kSkinInfluences];
+		float sum = vw[0] + vw[1] + vw[2] + vw[3];
+		if (sum > 0) {
+			for (int k = 0; k < kSkinInfluences; k++) {
+				vw[k] /= sum;
+			}
+		}
+	}
+
+	for (int v = 0; v < numVerts; v++) {
+		unsigned int i = gather ? gather[v] : v;
+		std::copy(&indices[i * kSkinInfluences], &indices[i * kSkinInfluences] + kSkinInfluences, jointIndices + v * kSkinInfluences);
+		std::copy(&weights[i * kSkinInfluences], &weights[i * kSkinInfluences] + kSkinInfluences, jointWeights + v * kSkinInfluences);
+	}
+}
+
+// world matrix of every skeleton node for a pose, locals holds 16 floats (column major) per skeleton node.
+void skeleton_worlds(const Skeleton& skeleton, const std::vector<float>& locals, std::vector<float>& worlds) {
+	int numNodes = (int)skeleton.nodeParents.size();
+	worlds.resize(numNodes * 16);
+
+	// parents always come first, so one pass is enough.
+	for (int node = 0; node < numNodes; node++) {
+		int parent = skeleton.nodeParents[node];
+		if (parent < 0) {
+			std::copy(&locals[node * 16], &locals[node * 16] + 16, &worlds[node * 16]);
+		}
+		else {
+			multiply_matrices(&worlds[parent * 16], &locals[node * 16], &worlds[node * 16]);
+		}
+	}
+}
+
+// skin matrix of every joint (16 floats each) from the world matrices of a pose.
+void skeleton_pose(const Skeleton& skeleton, const std::vector<float>& worlds, std::vector<float>& skinMatrices) {
+	int numJoints = (int)skeleton.jointNodes.size();
+	skinMatrices.resize(numJoints * 16);
+	for (int joint = 0; joint < numJoints; joint++) {
+		multiply_matrices(&worlds[skeleton.jointNodes[joint] * 16], &skeleton.jointBinds[joint * 16], &skinMatrices[joint * 16]);
+	}
+}
+
+// normalizes a 3 vector in place, leaves zero length vectors alone.
+inline void skin_normalize(float* v) {
+	float len2 = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+	if (len2 > 0) {
+		float inv = 1 / std::sqrt(len2);
+		v[0] *= inv;
+		v[1] *= inv;
+		v[2] *= inv;
+	}
+}
+
+// linear blend skinning of the vertices [begin, end), read from rest and written to mesh. the joint matrices of a vertex are blended first, then the
+// blended matrix is applied to the position and (upper 3x3) to the normal, tangent and bitangent.
+// the normal uses the blended matrix directly rather than its inverse transpose, fine unless joints scale non uniformly.
+void skin_range(const Mesh& rest, Mesh& mesh, const std::vector<float>& skinMatrices, int begin, int end) {
+	bool hasBitangents = mesh.Bitangent_Data.size() == mesh.Position_Data.size() * 3;
+
+	for (int v = begin; v < end; v++) {
+		const int32_t* joints = &rest.JointIndex_Data[v * kSkinInfluences];
+		const float* weights = &rest.JointWeight_Data[v * kSkinInfluences];
+		if (weights[0] + weights[1] + weights[2] + weights[3] == 0) {
+			continue;
+		}
+
+		const float* restPosition = &rest.Position_Data[v].x;
+		const float* restNormal = &rest.Normal_Data[v].x;
+		const float* restTangent = &rest.Tangent_Data[v * 4];
+		const float* restBitangent = hasBitangents ? &rest.Bitangent_Data[v * 3] : nullptr;
+		float* position = &mesh.Position_Data[v].x;
+		float* normal = &mesh.Normal_Data[v].x;
+		float* tangent = &mesh.Tangent_Data[v * 4];
+		float* bitangent = hasBitangents ? &mesh.Bitangent_Data[v * 3] : nullptr;
+
+#ifdef TDASSIMP_SSE
+		// one register per matrix column, blended with the weights.
+		__m128 c0 = _mm_setzero_ps(), c1 = _mm_setzero_ps(), c2 = _mm_setzero_ps(), c3 = _mm_setzero_ps();
+		for (int k = 0; k < kSkinInfluences; k++) {
+			if (weights[k] == 0) {
+				continue;
+			}
+			const float* m = &skinMatrices[joints[k] * 16];
+			__m128 w = _mm_set1_ps(weights[k]);
+			c0 = _mm_add_ps(c0, _mm_mul_ps(w, _mm_loadu_ps(m + 0)));
+			c1 = _mm_add_ps(c1, _mm_mul_ps(w, _mm_loadu_ps(m + 4)));
+			c2 = _mm_add_ps(c2, _mm_mul_ps(w, _mm_loadu_ps(m + 8)));
+			c3 = _mm_add_ps(c3, _mm_mul_ps(w, _mm_loadu_ps(m + 12)));
+		}
+
+		float result[4];
+		auto transform = [&](const float* in, bool point, float* out) {
+			__m128 r = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(c0, _mm_set1_ps(in[0])),
+				_mm_mul_ps(c1, _mm_set1_ps(in[1]))),
+				_mm_mul_ps(c2, _mm_set1_ps(in[2])));
+			if (point) {
+				r = _mm_add_ps(r, c3);
+			}
+			// the output is only 3 floats wide, so go through a temporary instead of a 4 wide store.
+			_mm_storeu_ps(result, r);
+			out[0] = result[0];
+			out[1] = result[1];
+			out[2] = result[2];
+		};
+#else
+		float blended[16] = { 0 };
+		for (int k = 0; k < kSkinInfluences; k++) {
+			if (weights[k] == 0) {
+				continue;
+			}
+			const float* m = &skinMatrices[joints[k] * 16];
+			for (int i = 0; i < 16; i++) {
+				blended[i] += weights[k] * m[i];
+			}
+		}
+
+		auto transform = [&](const float* in, bool point, float* out) {
+			float x = in[0], y = in[1], z = in[2];
+			for (int row = 0; row < 3; row++) {
+				out[row] = blended[row] * x + blended[4 + row] * y + blended[8 + row] * z + (point ? blended[12 + row] : 0);
+			}
+		};
+#endif
+
+		transform(restPosition, true, position);
+		transform(restNormal, false, normal);
+		skin_normalize(normal);
+		transform(restTangent, false, tangent);
+		skin_normalize(tangent);
+		if (bitangent) {
+			transform(restBitangent, false, bitangent);
+			skin_normalize(bitangent);
+		}
+	}
+}
+
+// skins every weighted vertex of rest into mesh (a copy of rest, or rest with other deformations applied to the
+// vertices without weights), split over the worker threads. the filament tbn quats are rebuilt from the skinned frame.
+void skin_mesh(const Mesh& rest, Mesh& mesh, const std::vector<float>& skinMatrices) {
+	int numVertices = (int)rest.Position_Data.size();
+	if (rest.JointIndex_Data.size() != (size_t)numVertices * kSkinInfluences || skinMatrices.empty()
+		|| mesh.Position_Data.size() != rest.Position_Data.size()) {
+		return;
+	}
+
+	bool hasTbnQuat = mesh.TbnQuat_Data.size() == (size_t)numVertices * 4 && mesh.Bitangent_Data.size() == (size_t)numVertices * 3;
+
+	int numChunks = (numVertices + kSkinChunk - 1) / kSkinChunk;
+	parallel_for(numChunks, [&](int chunk) {
+		int begin = chunk * kSkinChunk;
+		int end = std::min(begin + kSkinChunk, numVertices);
+		skin_range(rest, mesh, skinMatrices, begin, end);
+
+		if (hasTbnQuat) {
+			for (int v = begin; v < end; v++) {
+				const float* weights = &rest.JointWeight_Data[v * kSkinInfluences];
+				if (weights[0] + weights[1] + weights[2] + weights[3] == 0) {
+					continue;
+				}
+				const float* tangent = &mesh.Tangent_Data[v * 4];
+				const float* bitangent = &mesh.Bitangent_Data[v * 3];
+				const Vector& normal = mesh.Normal_Data[v];
+				tbn_to_quat(
+					tangent[0], tangent[1], tangent[2], tangent[3],
+					bitangent[0], bitangent[1], bitangent[2],
+					normal.x, normal.y, normal.z, &mesh.TbnQuat_Data[v * 4]
+				);
+			}
+		}
+	});
+}
@@ -0,0 +1,302 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <string>
+
+#include "DataAndTypes.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TDASSIMP_SSE 1
+#endif
+
+/*
+Scene graph transforms.
+
+Instead of aiProcess_PreTransformVertices (slow, and it copies every mesh once per node that uses it), we walk the node
+hierarchy once, collect every (node, mesh) reference with its world matrix, and flatten_scene transforms the vertices
+of each reference while it copies them out of assimp.
+*/
+
+// one mesh as referenced by one node, in the order they're found walking the hierarchy depth first.
+struct MeshInstance {
+	int meshIndex = 0; // index into scene->mMeshes.
+	const aiNode* node = nullptr; // node that references the mesh, nullptr if the scene has no hierarchy.
+	float world[16]; // world matrix, column major, so world[12..14] is the translation.
+	float normalMatrix[9]; // inverse transpose of the upper 3x3 of world, column major.
+	bool mirrored = false; // negative determinant, the triangle winding and tangent handedness have to be flipped.
+};
+
+// fills in the column major world / normal matrix of an instance from an assimp (row major) matrix.
+void mesh_instance_set_matrix(MeshInstance& instance, const aiMatrix4x4& m) {
+	const float rows[4][4] = {
+		{ m.a1, m.a2, m.a3, m.a4 },
+		{ m.b1, m.b2, m.b3, m.b4 },
+		{ m.c1, m.c2, m.c3, m.c4 },
+		{ m.d1, m.d2, m.d3, m.d4 },
+	};
+	for (int col = 0; col < 4; col++) {
+		for (int row = 0; row < 4; row++) {
+			instance.world[col * 4 + row] = rows[row][col];
+		}
+	}
+
+	// inverse transpose of the upper 3x3, which is the cofactor matrix divided by the determinant.
+	float cofactor[3][3];
+	for (int row = 0; row < 3; row++) {
+		for (int col = 0; col < 3; col++) {
+			int r0 = (row + 1) % 3, r1 = (row + 2) % 3;
+			int c0 = (col + 1) % 3, c1 = (col + 2) % 3;
+			cofactor[row][col] = rows[r0][c0] * rows[r1][c1] - rows[r0][c1] * rows[r1][c0];
+		}
+	}
+	float det = rows[0][0] * cofactor[0][0] + rows[0][1] * cofactor[0][1] + rows[0][2] * cofactor[0][2];
+	float invDet = det != 0 ? 1 / det : 0;
+
+	for (int col = 0; col < 3; col++) {
+		for (int row = 0; row < 3; row++) {
+			instance.normalMatrix[col * 3 + row] = cofactor[row][col] * invDet;
+		}
+	}
+	instance.mirrored = det < 0;
+}
+
+// glob match, * matches any run of characters and ? any single character.
+bool glob_match(const char* pattern, const char* name) {
+	const char* starPattern = nullptr;
+	const char* starName = nullptr;
+	while (*name) {
+		if (*pattern == '*') {
+			starPattern = pattern++;
+			starName = name;
+		}
+		else if (*pattern == '?' || *pattern == *name) {
+			pattern++;
+			name++;
+		}
+		else if (starPattern) {
+			// backtrack, let the last * swallow one more character.
+			pattern = starPattern + 1;
+			name = ++starName;
+		}
+		else {
+			return false;
+		}
+	}
+	while (*pattern == '*') {
+		pattern++;
+	}
+	return *pattern == 0;
+}
+
+// true if the name matches any of the space separated glob patterns.
+bool glob_match_any(const std::string& patterns, const std::string& name) {
+	size_t start = 0;
+	while (start < patterns.size()) {
+		size_t end = patterns.find(' ', start);
+		if (end == std::string::npos) {
+			end = patterns.size();
+		}
+		if (end > start && glob_match(patterns.substr(start, end - start).c_str(), name.c_str())) {
+			return true;
+		}
+		start = end + 1;
+	}
+	return false;
+}
+
+// name filters, a reference is kept if its node or mesh name is included, and neither of them is excluded.
+bool mesh_instance_included(const aiScene* scene, const MeshInstance& instance, const FlattenOptions& options) {
+	std::string meshName = scene->mMeshes[instance.meshIndex]->mName.C_Str();
+	std::string nodeName = instance.node ? instance.node->mName.C_Str() : "";
+
+	bool included = glob_match_any(options.Includenames, nodeName) || glob_match_any(options.Includenames, meshName);
+	bool excluded = glob_match_any(options.Excludenames, nodeName) || glob_match_any(options.Excludenames, meshName);
+	return included && !excluded;
+}
+
+// aiProcess_OptimizeGraph collapses nodes and loses their names, which would break the name filters.
+// every filter pattern without wildcards is a literal node name, and goes on AI_CONFIG_PP_OG_EXCLUDE_LIST so that node survives.
+std::string optimize_graph_keep_list(const FlattenOptions& options) {
+	std::string keep;
+	for (const std::string& patterns : { options.Includenames, options.Excludenames }) {
+		size_t start = 0;
+		while (start < patterns.size()) {
+			size_t end = patterns.find(' ', start);
+			if (end == std::string::npos) {
+				end = patterns.size();
+			}
+			std::string name = patterns.substr(start, end - start);
+			if (!name.empty() && name.find_first_of("*?'") == std::string::npos) {
+				keep += (keep.empty() ? "'" : " '") + name + "'";
+			}
+			start = end + 1;
+		}
+	}
+	return keep;
+}
+
+// walks the node hierarchy once and returns every mesh reference with its world matrix.
+// if the scene has no root node, every mesh is returned once, untransformed.
+std::vector<MeshInstance> collect_mesh_instances(const aiScene* scene) {
+	std::vector<MeshInstance> instances;
+
+	if (scene->mRootNode == nullptr) {
+		for (unsigned int mesh_index = 0; mesh_index < scene->mNumMeshes; mesh_index++) {
+			MeshInstance instance;
+			instance.meshIndex = mesh_index;
+			mesh_instance_set_matrix(instance, aiMatrix4x4());
+			instances.push_back(instance);
+		}
+		return instances;
+	}
+
+	// explicit stack instead of recursion, some files have very deep hierarchies.
+	// children are pushed in reverse so they come out in file order.
+	std::vector<std::pair<const aiNode*, aiMatrix4x4>> stack;
+	stack.push_back({ scene->mRootNode, scene->mRootNode->mTransformation });
+
+	while (!stack.empty()) {
+		const aiNode* node = stack.back().first;
+		aiMatrix4x4 world = stack.back().second;
+		stack.pop_back();
+
+		for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+			MeshInstance instance;
+			instance.meshIndex = node->mMeshes[i];
+			instance.node = node;
+			mesh_instance_set_matrix(instance, world);
+			instances.push_back(instance);
+		}
+
+		for (int i = (int)node->mNumChildren - 1; i >= 0; i--) {
+			stack.push_back({ node->mChildren[i], world * node->mChildren[i]->mTransformation });
+		}
+	}
+
+	return instances;
+}
+
+// splits a column major world matrix into translate, rotate (degrees, rotate order x y z like TD's default) and scale,
+// ie. world = T * Rz * Ry * Rx * S. a mirrored matrix gets a negative x scale.
+void decompose_transform(const float m[16], float translate[3], float rotate[3], float scale[3]) {
+	translate[0] = m[12];
+	translate[1] = m[13];
+	translate[2] = m[14];
+
+	float det = m[0] * (m[5] * m[10] - m[9] * m[6]) - m[4] * (m[1] * m[10] - m[9] * m[2]) + m[8] * (m[1] * m[6] - m[5] * m[2]);
+	for (int col = 0; col < 3; col++) {
+		scale[col] = length(&m[col * 4]);
+	}
+	if (det < 0) {
+		scale[0] = -scale[0];
+	}
+
+	// pure rotation, r[row][col].
+	float r[3][3];
+	for (int col = 0; col < 3; col++) {
+		for (int row = 0; row < 3; row++) {
+			r[row][col] = scale[col] != 0 ? m[col * 4 + row] / scale[col] : 0;
+		}
+	}
+
+	const float toDegrees = 180.0f / 3.14159265358979f;
+	float sy = std::max(-1.0f, std::min(1.0f, -r[2][0]));
+	rotate[1] = std::asin(sy) * toDegrees;
+	if (std::fabs(sy) < 0.9999f) {
+		rotate[0] = std::atan2(r[2][1], r[2][2]) * toDegrees;
+		rotate[2] = std::atan2(r[1][0], r[0][0]) * toDegrees;
+	}
+	else {
+		// gimbal lock, x and z rotate around the same axis, so put it all on x.
+		rotate[0] = std::atan2(-r[1][2], r[1][1]) * toDegrees;
+		rotate[2] = 0;
+	}
+}
+
+// transforms count points by the column major matrix m, writing xyz to out every outStride floats.
+// if indices isn't null, point i is read from in[indices[i]] (ie. to expand per face corner).
+void transform_points(const aiVector3D* in, const unsigned int* indices, int count, const float m[16], float* out, int outStride) {
+#ifdef TDASSIMP_SSE
+	const __m128 c0 = _mm_setr_ps(m[0], m[1], m[2], 0);
+	const __m128 c1 = _mm_setr_ps(m[4], m[5], m[6], 0);
+	const __m128 c2 = _mm_setr_ps(m[8], m[9], m[10], 0);
+	const __m128 c3 = _mm_setr_ps(m[12], m[13], m[14], 0);
+
+	for (int i = 0; i < count; i++) {
+		const aiVector3D& p = in[indices ? indices[i] : i];
+		__m128 r = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p.x)), _mm_mul_ps(c1, _mm_set1_ps(p.y))),
+			_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p.z)), c3));
+
+		float* dst = out + (size_t)i * outStride;
+		// a full 4 wide store spills into the next point, which is fine except for the very last one.
+		if (outStride >= 4 || i + 1 < count) {
+			_mm_storeu_ps(dst, r);
+		}
+		else {
+			_mm_storel_pi((__m64*)dst, r);
+			_mm_store_ss(dst + 2, _mm_movehl_ps(r, r));
+		}
+	}
+#else
+	for (int i = 0; i < count; i++) {
+		const aiVector3D& p = in[indices ? indices[i] : i];
+		float* dst = out + (size_t)i * outStride;
+		dst[0] = m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12];
+		dst[1] = m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13];
+		dst[2] = m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14];
+	}
+#endif
+}
+
+// transforms count directions by the column major 3x3 matrix m and normalizes them, same layout rules as transform_points.
+// zero length vectors stay zero.
+void transform_directions(const aiVector3D* in, const unsigned int* indices, int count, const float m[9], float* out, int outStride) {
+#ifdef TDASSIMP_SSE
+	const __m128 c0 = _mm_setr_ps(m[0], m[1], m[2], 0);
+	const __m128 c1 = _mm_setr_ps(m[3], m[4], m[5], 0);
+	const __m128 c2 = _mm_setr_ps(m[6], m[7], m[8], 0);
+
+	for (int i = 0; i < count; i++) {
+		const aiVector3D& v = in[indices ? indices[i] : i];
+		__m128 r = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(v.x)), _mm_mul_ps(c1, _mm_set1_ps(v.y))),
+			_mm_mul_ps(c2, _mm_set1_ps(v.z)));
+
+		// horizontal dot product, lane 3 is always 0.
+		__m128 sq = _mm_mul_ps(r, r);
+		__m128 sum = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+		sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+		__m128 len = _mm_sqrt_ps(sum);
+		__m128 nonzero = _mm_cmpgt_ps(len, _mm_setzero_ps());
+		r = _mm_and_ps(_mm_div_ps(r, len), nonzero);
+
+		float* dst = out + (size_t)i * outStride;
+		if (outStride >= 4 || i + 1 < count) {
+			_mm_storeu_ps(dst, r);
+		}
+		else {
+			_mm_storel_pi((__m64*)dst, r);
+			_mm_store_ss(dst + 2, _mm_movehl_ps(r, r));
+		}
+	}
+#else
+	for (int i = 0; i < count; i++) {
+		const aiVector3D& v = in[indices ? indices[i] : i];
+		float r[3] = {
+			m[0] * v.x + m[3] * v.y + m[6] * v.z,
+			m[1] * v.x + m[4] * v.y + m[7] * v.z,
+			m[2] * v.x + m[5] * v.y + m[8] * v.z,
+		};
+		float len = length(r);
+		float* dst = out + (size_t)i * outStride;
+		for (int k = 0; k < 3; k++) {
+			dst[k] = len > 0 ? r[k] / len : 0;
+		}
+	}
+#endif
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// number of worker threads we are willing to spin up for the heavier mesh processing stages.
+// hardware_concurrency can return 0 if it can't tell, so always assume at least 1.
+int worker_count() {
+	return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+// calls func(i) for every i in [0, count), spread over the worker threads.
+// work items are handed out one at a time from a shared counter, so uneven items (ie. meshes of very different sizes) still balance out.
+// func must be safe to call concurrently for different i.
+template <typename Func>
+void parallel_for(int count, Func func) {
+	int numThreads = std::min(worker_count(), count);
+
+	// not worth spinning up threads for a single item.
+	if (numThreads <= 1) {
+		for (int i = 0; i < count; i++) {
+			func(i);
+		}
+		return;
+	}
+
+	std::atomic<int> next(0);
+	auto worker = [&]() {
+		for (int i = next++; i < count; i = next++) {
+			func(i);
+		}
+	};
+
+	// the calling thread does its share of the work too.
+	std::vector<std::thread> threads;
+	for (int t = 1; t < numThreads; t++) {
+		threads.emplace_back(worker);
+	}
+	worker();
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
@@ -13,6 +13,20 @@
 */
 
 #include "DataAndTypes.h"
+#include "Mesh_Overdraw.h"
+#include "Mesh_Cache.h"
+#include "Mesh_Progressive.h"
+#include "Mesh_Transform.h"
+#include "Mesh_Skinning.h"
+#include "Mesh_Morph.h"
+#include "Mesh_Sequence.h"
+#include "Mesh_SequenceCache.h"
+#include "Mesh_Memory.h"
+#include "Mesh_Quality.h"
+#include "CookStats.h"
+#include "Trace.h"
+#include "LogRing.h"
+#include "ImportProfile.h"
 
 // These functions are basic C function, which the DLL loader can find
 // much easier than finding a C++ Class.
@@ -81,18 +95,72 @@ TdAssimp::TdAssimp(const OP_NodeInfo* info) : myNodeInfo(info)
 	myChopChanVal = 0;
 
 	myDat = "N/A";
+
+	myAcmrBefore = 0;
+	myAcmrAfter = 0;
+	myOverdrawBefore = 0;
+	myOverdrawAfter = 0;
+
+	myInfoLod = 0;
+
+	myQueryPending = false;
+
+	myProfileStepsPending = false;
+
+	myAnimating = false;
+	myAnimatedMeshes = 0;
+	myBenchmarkPending = false;
+	myBenchmarkCursor = 0;
+	myBenchmarkSearch = 0;
+
+	mySequencePositionsOnly = false;
+	mySequenceFrame = 0;
+	mySequenceDirection = 1;
+	myPrefetchDepth = 0;
+	myPrefetchMisses = 0;
+	mySequenceDecodeMs = 0;
+	myWriteCachePending = false;
+
+	std::fill(myStageMs, myStageMs + NumCookStages, 0.0f);
+	myEmittedVertices = 0;
+	myEmittedTriangles = 0;
+	myEmittedBytes = 0;
+
+	std::fill(myMemoryBytes, myMemoryBytes + NumMemoryPools, 0);
+	std::fill(myMemoryPeak, myMemoryPeak + NumMemoryPools, 0);
+	myMemoryPeakTotal = 0;
+
+	acquire_logger();
+	myCookStats = new CookStats();
+	myTrace = new TraceRegistration();
+	myLogRing = new LogRing();
+	myCache = new MeshCache();
+	myFilamentScratch = new FilamentScratch();
+	myLoader = new ProgressiveLoader(myLogRing);
+	myPrefetcher = new SequencePrefetcher(myLogRing);
+	myCacheReader = new SequenceCacheReader();
 }
 
 TdAssimp::~TdAssimp()
 {
-
+	delete myCacheReader;
+	delete myPrefetcher;
+	delete myLoader;
+	delete myFilamentScratch;
+	delete myCache;
+	delete myLogRing;
+	delete myCookStats;
+	delete myTrace;
+	release_logger();
 }
 
 void
 TdAssimp::getGeneralInfo(SOP_GeneralInfo* ginfo, const OP_Inputs* inputs, void* reserved)
 {
 	// This will cause the node to cook every frame
-	ginfo->cookEveryFrameIfAsked = false;
+	// only while a progressive load is running, so the finished stages get picked up as soon as they are ready,
+	// and while an animation is playing.
+	ginfo->cookEveryFrameIfAsked = myLoader->loading() || myAnimating;
 
 	//if direct to GPU loading:
 	// TODO: set this up later when we have basic functionality working for CPU.
@@ -103,17 +171,6 @@ TdAssimp::getGeneralInfo(SOP_GeneralInfo* ginfo, const OP_Inputs* inputs, void*
 }
 
 
-class AssimpLogStream : public Assimp::LogStream {
-public:
-	// assimp knows to call the write function inside this logstream class, so overriding it here with our own functionality.
-	void write(const char* message) {
-		myLog.append(message);
-		myLog.append("`");
-		// using the tilde character as a line break character 
-		// since the entire log ends up getting written to a line of the info dat.
-	}
-};
-
 //-----------------------------------------------------------------------------------------------------
 //										Generate a geometry on CPU
 //-----------------------------------------------------------------------------------------------------
@@ -193,784 +250,2485 @@ void set_tspace_basic(const SMikkTSpaceContext* context, const float* tangentu,
 	working_mesh->Tangent_Data[prim_offset + vtx_offset + 3] = -fSign; // w (sign / handedness)
 }
 
-void
-TdAssimp::execute(SOP_Output* output, const OP_Inputs* inputs, void* reserved)
-{
-	myExecuteCount++;
-	std::cout << "======================================" << std::endl;
-
-	// output style, choose TouchDesigner(0) or Google Filament(1)
-	int Attributestyle = inputs->getParInt("Attributestyle");
-	//Attributestyle = 1;
-
-	// enable the Tangentalgorithm parameter, maybe able to delete this later due to a bug.
-	inputs->enablePar("Tangentalgorithm", 1);
-
-	// determine if we are processing tangents as assimp imported style OR as mikktspace tangents.
-	int DoMikktSpaceTangents = inputs->getParInt("Tangentalgorithm") == 1;
-	//DoMikktSpaceTangents = 0;
-	
-	
-	// assign the various helper functions to mikktspace's interface object so it knows how to interact with our data.
-	iface.m_getNumFaces = get_num_faces;
-	iface.m_getNumVerticesOfFace = get_num_vertices_of_face;
-	iface.m_getNormal = get_normal;
-	iface.m_getPosition = get_position;
-	iface.m_getTexCoord = get_tex_coords;
-	iface.m_setTSpaceBasic = set_tspace_basic;
-	context.m_pInterface = &iface;
-
-	// get the vertex color tint from the custom parameters.
-	inputs->getParDouble4("Vertexcolortint", vertexTint[0], vertexTint[1], vertexTint[2], vertexTint[3]);
-
-	/////////////////////////////// LOGGING ///////////////////////////////////
-	
-	// clear the log at the start of each cook.
-	myLog = "";
+// the mesh references flatten_scene converts, after the name filters. in instanced mode only the first reference of
+// every mesh, and the transforms of all of them go to mesh.Instance_Data (and their nodes to referenceNodes).
+std::vector<MeshInstance> flatten_instances(const aiScene* scene, const FlattenOptions& options, Mesh& mesh,
+	std::vector<const aiNode*>& referenceNodes) {
 
-	// Select the kinds of messages you want to receive on this log stream
-	// const unsigned int severity = Assimp::Logger::Debugging | Assimp::Logger::Info | Assimp::Logger::Warn | Assimp::Logger::Err;
-	const unsigned int severity = 0
-		| (inputs->getParInt("Debugging")	== 1 ? Assimp::Logger::Debugging : 0)
-		| (inputs->getParInt("Info")		== 1 ? Assimp::Logger::Info : 0)
-		| (inputs->getParInt("Warning")		== 1 ? Assimp::Logger::Warn : 0)
-		| (inputs->getParInt("Error")		== 1 ? Assimp::Logger::Err : 0)
-	;
+	std::vector<MeshInstance> instances = collect_mesh_instances(scene);
 
-	// if at least one of the logging flags are set, we create the logger and attach the log stream to it.
-	if(severity > 0){
-		// Create a logger instance
-		Assimp::DefaultLogger::create("", Assimp::Logger::VERBOSE);
-		// attach the log stream function to the logger, so we print messages automatically.
-		Assimp::DefaultLogger::get()->attachStream(new AssimpLogStream, severity);
+	// name filters, counted per reference, so a skipped mesh used by 3 nodes counts 3 times.
+	std::vector<MeshInstance> included;
+	for (const MeshInstance& instance : instances) {
+		if (mesh_instance_included(scene, instance, options)) {
+			included.push_back(instance);
+		}
+		else {
+			mesh.numSkippedMeshes++;
+			mesh.numSkippedVertices += scene->mMeshes[instance.meshIndex]->mNumVertices;
+		}
 	}
+	instances.swap(included);
+
+	// instanced output, the references turn into a transform table, and only the first reference of each mesh is kept
+	// (untransformed) for the geometry. source mesh ids are then per unique mesh, in order of first use.
+	if (options.Instanced) {
+		std::vector<int> uniqueIndex(scene->mNumMeshes, -1);
+		std::vector<MeshInstance> unique;
+
+		for (const MeshInstance& instance : instances) {
+			referenceNodes.push_back(instance.node);
+			if (uniqueIndex[instance.meshIndex] == -1) {
+				uniqueIndex[instance.meshIndex] = (int)unique.size();
+				MeshInstance local;
+				local.meshIndex = instance.meshIndex;
+				local.node = instance.node;
+				mesh_instance_set_matrix(local, aiMatrix4x4());
+				unique.push_back(local);
+			}
 
-	// if no flags are set, we save ourselves a bit of performance, and destroy the log and replace with a nulllogger.
-	else {
-		Assimp::DefaultLogger::kill();
+			float translate[3], rotate[3], scale[3];
+			decompose_transform(instance.world, translate, rotate, scale);
+			mesh.Instance_Data.insert(mesh.Instance_Data.end(), translate, translate + 3);
+			mesh.Instance_Data.insert(mesh.Instance_Data.end(), rotate, rotate + 3);
+			mesh.Instance_Data.insert(mesh.Instance_Data.end(), scale, scale + 3);
+			mesh.Instance_Data.push_back((float)uniqueIndex[instance.meshIndex]);
+		}
+
+		instances = unique;
 	}
 
-	/*
-	other ways to use the logger with custom messages.
-	Assimp::DefaultLogger::get()->info("This is an info level message.");
-	Assimp::DefaultLogger::get()->debug("This is a debug level message.");
-	Assimp::DefaultLogger::get()->warn("This is a warn level message.");
-	Assimp::DefaultLogger::get()->error("This is a error level message.");
-	*/
+	return instances;
+}
 
+// flattens every mesh in the assimp scene into a single Mesh, using either the assimp tangents (standard method) or mikktspace.
+// the node hierarchy is applied on the way, every (node, mesh) reference becomes its own source mesh in world space.
+// with Instanced on, every referenced mesh is flattened once in its own space instead, and the node transforms go to Instance_Data.
+// mesh references rejected by the name filters are dropped before anything is converted.
+// all the state is local, so any number of flattens can run at once (ie. progressive loading and the prefetch workers
+// flatten on background threads, while other sops cook).
+void flatten_scene(const aiScene* scene, Mesh& mesh, const FlattenOptions& options) {
 
-	/////////////////////////////// LOADING 3D DATA VIA ASSIMP ///////////////////////////////////
+	auto flattenStart = std::chrono::high_resolution_clock::now();
 
-	// get the file path from the File parameter.
-	const char* pFile = inputs->getParString("File");
+	int DoMikktSpaceTangents = options.DoMikktSpaceTangents;
+	int Attributestyle = options.Attributestyle;
+	const std::array<double, 4>& vertexTint = options.Vertextint;
 
-	// define/declare an instance of the assimp importer.
-	Assimp::Importer importer;
+	std::vector<const aiNode*> referenceNodes;
+	std::vector<MeshInstance> instances = flatten_instances(scene, options, mesh, referenceNodes);
 
-	// read the file while also doing some post processing.
-	// post processing documentation: http://assimp.sourceforge.net/lib_html/postprocess_8h.html
+	int numInstances = (int)instances.size();
 
-	const unsigned int meshProcessingFlags = 0
-		| aiProcess_CalcTangentSpace // calc tangent space must be enabled
-		| (inputs->getParInt("Joinidenticalvertices")		== 1 ? aiProcess_JoinIdenticalVertices : 0)
-		| aiProcess_Triangulate // triangulation must be enabled.
-		| aiProcess_GenNormals
-		| (inputs->getParInt("Validatedatastructure")		== 1 ? aiProcess_ValidateDataStructure : 0)
-		| (inputs->getParInt("Improvecachelocality")		== 1 ? aiProcess_ImproveCacheLocality : 0)
-		| (inputs->getParInt("Fixinfacingnormals")			== 1 ? aiProcess_FixInfacingNormals : 0)
-		| (inputs->getParInt("Sortbyptype")					== 1 ? aiProcess_SortByPType : 0)
-		| (inputs->getParInt("Finddegenerates")				== 1 ? aiProcess_FindDegenerates : 0)
-		| (inputs->getParInt("Findinvaliddata")				== 1 ? aiProcess_FindInvalidData : 0)
-		| (inputs->getParInt("Genuvcoords")					== 1 ? aiProcess_GenUVCoords : 0)
-		| (inputs->getParInt("Transformuvcoords")			== 1 ? aiProcess_TransformUVCoords : 0)
-		| (inputs->getParInt("Optimizemeshes")				== 1 ? aiProcess_OptimizeMeshes : 0)
-		| (inputs->getParInt("Optimizegraph")				== 1 ? aiProcess_OptimizeGraph : 0)
-		| (inputs->getParInt("Flipwindingorder")			== 1 ? aiProcess_FlipWindingOrder : 0)
-		| (inputs->getParInt("Flipwindingorder")			== 1 ? aiProcess_FlipWindingOrder : 0)
-		;
+	// names per source mesh, for the primitive groups.
+	for (const MeshInstance& instance : instances) {
+		mesh.NodeName_Data.push_back(instance.node ? instance.node->mName.C_Str() : "");
+		mesh.MeshName_Data.push_back(scene->mMeshes[instance.meshIndex]->mName.C_Str());
+	}
 
-	// read the file into the scene variable.
-	const aiScene* scene = importer.ReadFile( pFile, meshProcessingFlags );
+	// skeleton and the joint of every bone, before the parallel part since joints are shared between meshes.
+	// the animations add their nodes to the same skeleton.
+	std::unordered_map<const aiNode*, int> skeletonNodes;
+	std::vector<std::vector<int>> boneJoints = collect_skeleton(scene, instances, mesh.skeleton, skeletonNodes);
+	collect_animations(scene, instances, referenceNodes, mesh.skeleton, skeletonNodes, mesh.animations);
+
+	// count everything up front, so every instance knows where its vertices and triangles go, and they can all be filled in parallel.
+	// the standard method keeps assimp's shared vertices, mikktspace needs 3 unique vertices per triangle.
+	// anything that isn't a triangle (points/lines left over from sort by ptype) is skipped.
+	std::vector<int> vertexOffsets(numInstances + 1, 0);
+	std::vector<int> triangleOffsets(numInstances + 1, 0);
+	for (int inst = 0; inst < numInstances; inst++) {
+		const aiMesh* source = scene->mMeshes[instances[inst].meshIndex];
+		int numTris = 0;
+		for (unsigned int face_index = 0; face_index < source->mNumFaces; face_index++) {
+			numTris += source->mFaces[face_index].mNumIndices == 3;
+		}
+		vertexOffsets[inst + 1] = vertexOffsets[inst] + (DoMikktSpaceTangents ? numTris * 3 : (int)source->mNumVertices);
+		triangleOffsets[inst + 1] = triangleOffsets[inst] + numTris;
+	}
 
-	// If the import failed, report it, and halt the flow.
-	if (nullptr == scene) {
-		myError = "3D file does not exist or failed to load.";
+	int numVertices = vertexOffsets[numInstances];
+	mesh.numTris = triangleOffsets[numInstances];
+	mesh.MeshFace_Offsets = triangleOffsets;
+
+	mesh.MeshId_Data.resize(numVertices);
+	mesh.Position_Data.resize(numVertices);
+	mesh.Normal_Data.resize(numVertices);
+	mesh.Color_Data.resize(numVertices);
+	mesh.Uv_Data.resize(numVertices);
+	mesh.Tangent_Data.assign(numVertices * 4, 0);
+	mesh.Bitangent_Data.assign(numVertices * 3, 0);
+	mesh.FaceIndex_Data.resize(mesh.numTris * 3);
+	if (Attributestyle == 1 && DoMikktSpaceTangents == 0) {
+		mesh.TbnQuat_Data.resize(numVertices * 4);
+	}
+	if (!mesh.skeleton.empty()) {
+		mesh.JointIndex_Data.assign(numVertices * kSkinInfluences, 0);
+		mesh.JointWeight_Data.assign(numVertices * kSkinInfluences, 0.0f);
 	}
 
-	// if import succeeded, proceed.
-	else {
+	// morph targets, merged by name. the deltas are gathered per instance in the parallel part, and appended in order after it.
+	std::vector<std::vector<int>> animMeshTargets(numInstances);
+	std::vector<std::vector<MorphTarget>> instanceMorphs(numInstances);
+	{
+		std::unordered_map<std::string, int> targetIndex;
+		for (int inst = 0; inst < numInstances; inst++) {
+			const aiMesh* source = scene->mMeshes[instances[inst].meshIndex];
+			for (unsigned int anim_index = 0; anim_index < source->mNumAnimMeshes; anim_index++) {
+				const aiAnimMesh* animMesh = source->mAnimMeshes[anim_index];
+				std::string name = animMesh->mName.length > 0 ? animMesh->mName.C_Str() : "morph" + std::to_string(anim_index);
+				auto found = targetIndex.find(name);
+				if (found == targetIndex.end()) {
+					found = targetIndex.insert({ name, (int)mesh.morphTargets.size() }).first;
+					MorphTarget target;
+					target.name = name;
+					target.defaultWeight = animMesh->mWeight;
+					mesh.morphTargets.push_back(target);
+				}
+				animMeshTargets[inst].push_back(found->second);
+			}
+			instanceMorphs[inst].resize(source->mNumAnimMeshes);
+		}
+	}
 
-		Mesh mesh;
-		vtxOffset = 0;
+	parallel_for(numInstances, [&](int inst) {
+		const MeshInstance& instance = instances[inst];
+		const aiMesh* source = scene->mMeshes[instance.meshIndex];
+		TraceScope meshSpan("mesh", source->mName.C_Str());
+		int vtxStart = vertexOffsets[inst];
+		int triStart = triangleOffsets[inst];
+		int numVerts = vertexOffsets[inst + 1] - vtxStart;
+		if (numVerts == 0) {
+			return;
+		}
 
-		///////////////////////////////////////////////////////////////////////
-		////////////////// STANDARD MESH PROCESSING METHOD ////////////////////
-		///////////////////////////////////////////////////////////////////////
-		
-		if (DoMikktSpaceTangents == 0) {
-
-			// for each mesh in the assimp scene.
-			for (int mesh_index = 0; mesh_index < scene->mNumMeshes; mesh_index++) {
-
-				// for each vertex in this mesh.
-				for (int i = 0; i < scene->mMeshes[mesh_index]->mNumVertices; i++)
-				{
-					mesh.FaceIndex_Data.push_back(i);
-
-					// ADD VERTEX POSITIONS
-					int HasPositions = scene->mMeshes[mesh_index]->HasPositions();
-					mesh.Position_Data.push_back(
-						Position(
-							HasPositions ? scene->mMeshes[mesh_index]->mVertices[i][0] : 0, // x
-							HasPositions ? scene->mMeshes[mesh_index]->mVertices[i][1] : 0, // y
-							HasPositions ? scene->mMeshes[mesh_index]->mVertices[i][2] : 0  // z
-						)
-					);
-
-					// ADD VERTEX COLORS
-					int HasVertexColors = scene->mMeshes[mesh_index]->HasVertexColors(0);
-					mesh.Color_Data.push_back(
-						Color(
-							HasVertexColors ? scene->mMeshes[mesh_index]->mColors[0][i][0] * vertexTint[0] : (float)vertexTint[0], // r
-							HasVertexColors ? scene->mMeshes[mesh_index]->mColors[0][i][1] * vertexTint[1] : (float)vertexTint[1], // g
-							HasVertexColors ? scene->mMeshes[mesh_index]->mColors[0][i][2] * vertexTint[2] : (float)vertexTint[2], // b
-							HasVertexColors ? scene->mMeshes[mesh_index]->mColors[0][i][3] * vertexTint[3] : (float)vertexTint[3]  // a
-						)
-					);
-
-					// ADD UVS
-					// get the number of texture layers for this particular object.
-					// NOTE: as of TouchDesigner 2021.16410 adding multiple uv sets is bugged, but this will be fixed in future versions.
-					// at that point we can attempt to re introduce multiple uv sets support, but does anyone even need this?
-					int numTextureLayers = scene->mMeshes[mesh_index]->GetNumUVChannels();
-					numTextureLayers = std::min(1, numTextureLayers);
-					//numTextureLayers = 1;
-					mesh.Uv_Data.push_back(
-						TexCoord(
-							numTextureLayers ? scene->mMeshes[mesh_index]->mTextureCoords[0][i][0] : 0, // u
-							numTextureLayers ? scene->mMeshes[mesh_index]->mTextureCoords[0][i][1] : 0, // v
-							numTextureLayers ? scene->mMeshes[mesh_index]->mTextureCoords[0][i][2] : 0   // w
-						)
-					);
-
-					// ADD NORMALS
-					int HasNormals = scene->mMeshes[mesh_index]->HasNormals();
-					mesh.Normal_Data.push_back(
-						Vector(
-							HasNormals ? scene->mMeshes[mesh_index]->mNormals[i][0] : 0, // x
-							HasNormals ? scene->mMeshes[mesh_index]->mNormals[i][1] : 0, // y
-							HasNormals ? scene->mMeshes[mesh_index]->mNormals[i][2] : 0  // z
-						)
-					);
-					normal[0] = scene->mMeshes[mesh_index]->mNormals[i][0];
-					normal[1] = scene->mMeshes[mesh_index]->mNormals[i][1];
-					normal[2] = scene->mMeshes[mesh_index]->mNormals[i][2];
-
-					// ADD TANGENT / BITANGENT
-					int HasTangentsAndBitangents = scene->mMeshes[mesh_index]->HasTangentsAndBitangents();
-					mesh.Tangent_Data.push_back(HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mTangents[i][0] : 0); // x
-					mesh.Tangent_Data.push_back(HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mTangents[i][1] : 0); // y
-					mesh.Tangent_Data.push_back(HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mTangents[i][2] : 0); // z
-					mesh.Tangent_Data.push_back(1.0); // handedness / sign. 1 is assumed, since assimp's internally matches openGL and also they do not provide this value in their data structure.
-
-					tangent[0] = HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mTangents[i][0] : 0;
-					tangent[1] = HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mTangents[i][1] : 0;
-					tangent[2] = HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mTangents[i][2] : 0;
-					tangentSign = 1.0; // handedness / sign. 1 is assumed, since assimp's internally matches openGL and also they do not provide this value in their data structure.
-					
-					if (Attributestyle == 1) {
-						// recalc bitangent
-						cross(normal, tangent, bitangent);
-					}
-					else {
-						bitangent[0] = HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mBitangents[i][0] : 0; // x
-						bitangent[1] = HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mBitangents[i][1] : 0; // y
-						bitangent[2] = HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mBitangents[i][2] : 0; // z
-					}
+		// ADD FACE INDICES
+		// the standard method offsets assimp's indices into the flattened vertex list. mikktspace reads every triangle corner
+		// as its own vertex, so corners lists which assimp vertex each of them comes from, and the indices are just sequential.
+		// mirrored instances get their winding flipped, so they still face outwards.
+		std::vector<unsigned int> corners;
+		int tri = triStart;
+		for (unsigned int face_index = 0; face_index < source->mNumFaces; face_index++) {
+			const aiFace& face = source->mFaces[face_index];
+			if (face.mNumIndices != 3) {
+				continue;
+			}
+			unsigned int a = face.mIndices[0];
+			unsigned int b = face.mIndices[instance.mirrored ? 2 : 1];
+			unsigned int c = face.mIndices[instance.mirrored ? 1 : 2];
+
+			if (DoMikktSpaceTangents == 0) {
+				mesh.FaceIndex_Data[tri * 3 + 0] = a + vtxStart;
+				mesh.FaceIndex_Data[tri * 3 + 1] = b + vtxStart;
+				mesh.FaceIndex_Data[tri * 3 + 2] = c + vtxStart;
+			}
+			else {
+				corners.push_back(a);
+				corners.push_back(b);
+				corners.push_back(c);
+				mesh.FaceIndex_Data[tri * 3 + 0] = vtxStart + (tri - triStart) * 3 + 0;
+				mesh.FaceIndex_Data[tri * 3 + 1] = vtxStart + (tri - triStart) * 3 + 1;
+				mesh.FaceIndex_Data[tri * 3 + 2] = vtxStart + (tri - triStart) * 3 + 2;
+			}
+			tri++;
+		}
+		const unsigned int* gather = DoMikktSpaceTangents ? corners.data() : nullptr;
 
-					mesh.Bitangent_Data.push_back(bitangent[0]); // x
-					mesh.Bitangent_Data.push_back(bitangent[1]); // y
-					mesh.Bitangent_Data.push_back(bitangent[2]); // z
-					
-					if (Attributestyle == 1) {
-						tbn_to_quat(
-							tangent[0], tangent[1], tangent[2], tangentSign,
-							bitangent[0], bitangent[1], bitangent[2],
-							normal[0], normal[1], normal[2], tbnquat
-						);
-
-						mesh.TbnQuat_Data.push_back(tbnquat[0]);
-						mesh.TbnQuat_Data.push_back(tbnquat[1]);
-						mesh.TbnQuat_Data.push_back(tbnquat[2]);
-						mesh.TbnQuat_Data.push_back(tbnquat[3]);
+		// ADD JOINT INDICES / WEIGHTS
+		if (source->HasBones() && !mesh.JointIndex_Data.empty()) {
+			gather_skin_weights(source, boneJoints[inst], gather, numVerts,
+				&mesh.JointIndex_Data[vtxStart * kSkinInfluences], &mesh.JointWeight_Data[vtxStart * kSkinInfluences]);
+		}
 
-					}
+		// ADD VERTEX POSITIONS
+		if (source->HasPositions()) {
+			transform_points(source->mVertices, gather, numVerts, instance.world, &mesh.Position_Data[vtxStart].x, 3);
+		}
 
+		// ADD NORMALS
+		if (source->HasNormals()) {
+			transform_directions(source->mNormals, gather, numVerts, instance.normalMatrix, &mesh.Normal_Data[vtxStart].x, 3);
+		}
 
-					vtxOffset += 1;
-				} // end of for loop for verts.
+		// ADD TANGENT / BITANGENT
+		// tangents lie in the surface, so they use the world matrix, not the normal matrix.
+		// handedness / sign: 1 is assumed, since assimp's internally matches openGL and also they do not provide this value
+		// in their data structure. a mirrored instance flips it.
+		const float tangentMatrix[9] = {
+			instance.world[0], instance.world[1], instance.world[2],
+			instance.world[4], instance.world[5], instance.world[6],
+			instance.world[8], instance.world[9], instance.world[10],
+		};
+		float sign = instance.mirrored ? -1.0f : 1.0f;
+		int HasTangentsAndBitangents = source->HasTangentsAndBitangents();
+		if (HasTangentsAndBitangents) {
+			transform_directions(source->mTangents, gather, numVerts, tangentMatrix, &mesh.Tangent_Data[vtxStart * 4], 4);
+			if (Attributestyle != 1) {
+				transform_directions(source->mBitangents, gather, numVerts, tangentMatrix, &mesh.Bitangent_Data[vtxStart * 3], 3);
+			}
+		}
 
-				// update number of tris after each mesh.
-				mesh.numTris += scene->mMeshes[mesh_index]->mNumFaces;
+		int HasVertexColors = source->HasVertexColors(0);
 
-			} // end of for loop for meshes.
-		}
-		///////////////////////////////////////////////////////////////////////
-		//////////////////// MIKKT MESH PROCESSING METHOD /////////////////////
-		///////////////////////////////////////////////////////////////////////
-		else {
+		// get the number of texture layers for this particular object.
+		// NOTE: as of TouchDesigner 2021.16410 adding multiple uv sets is bugged, but this will be fixed in future versions.
+		// at that point we can attempt to re introduce multiple uv sets support, but does anyone even need this?
+		int numTextureLayers = source->GetNumUVChannels();
+		numTextureLayers = std::min(1, numTextureLayers);
 
-			vtxOffset = 0;
-
-			// for each mesh in the assimp scene.
-			for (int mesh_index = 0; mesh_index < scene->mNumMeshes; mesh_index++) {
-
-				// for each face in this mesh.
-				for (int face_index = 0; face_index < scene->mMeshes[mesh_index]->mNumFaces; face_index++)
-				{
-					// for each vertex in this face.
-					for (int vertex_index = 0; vertex_index < scene->mMeshes[mesh_index]->mFaces[face_index].mNumIndices; vertex_index++)
-					{
-						int i = scene->mMeshes[mesh_index]->mFaces[face_index].mIndices[vertex_index];
-
-						std::cout << i << std::endl;
-						// ADD VERTEX POSITIONS
-						int HasPositions = scene->mMeshes[mesh_index]->HasPositions();
-						mesh.Position_Data.push_back(
-							Position(
-								HasPositions ? scene->mMeshes[mesh_index]->mVertices[i][0] : 0, // x
-								HasPositions ? scene->mMeshes[mesh_index]->mVertices[i][1] : 0, // y
-								HasPositions ? scene->mMeshes[mesh_index]->mVertices[i][2] : 0  // z
-							)
-						);
-
-
-						// ADD VERTEX COLORS
-						int HasVertexColors = scene->mMeshes[mesh_index]->HasVertexColors(0);
-						mesh.Color_Data.push_back(
-							Color(
-								HasVertexColors ? scene->mMeshes[mesh_index]->mColors[0][i][0] * vertexTint[0] : (float)vertexTint[0], // r
-								HasVertexColors ? scene->mMeshes[mesh_index]->mColors[0][i][1] * vertexTint[1] : (float)vertexTint[1], // g
-								HasVertexColors ? scene->mMeshes[mesh_index]->mColors[0][i][2] * vertexTint[2] : (float)vertexTint[2], // b
-								HasVertexColors ? scene->mMeshes[mesh_index]->mColors[0][i][3] * vertexTint[3] : (float)vertexTint[3]  // a
-							)
-						);
-
-						// ADD UVS
-						// get the number of texture layers for this particular object.
-						// NOTE: as of TouchDesigner 2021.16410 adding multiple uv sets is bugged, but this will be fixed in future versions.
-						// at that point we can attempt to re introduce multiple uv sets support, but does anyone even need this?
-						int numTextureLayers = scene->mMeshes[mesh_index]->GetNumUVChannels();
-						numTextureLayers = std::min(1, numTextureLayers);
-						mesh.Uv_Data.push_back(
-							TexCoord(
-								numTextureLayers ? scene->mMeshes[mesh_index]->mTextureCoords[0][i][0] : 0, // u
-								numTextureLayers ? scene->mMeshes[mesh_index]->mTextureCoords[0][i][1] : 0, // v
-								numTextureLayers ? scene->mMeshes[mesh_index]->mTextureCoords[0][i][2] : 0   // w
-							)
-						);
-
-						// ADD NORMALS
-						int HasNormals = scene->mMeshes[mesh_index]->HasNormals();
-						mesh.Normal_Data.push_back(
-							Vector(
-								HasNormals ? scene->mMeshes[mesh_index]->mNormals[i][0] : 0, // x
-								HasNormals ? scene->mMeshes[mesh_index]->mNormals[i][1] : 0, // y
-								HasNormals ? scene->mMeshes[mesh_index]->mNormals[i][2] : 0  // z
-							)
-						);
-
-						// ADD TANGENT / BITANGENT
-						int HasTangentsAndBitangents = scene->mMeshes[mesh_index]->HasTangentsAndBitangents();
-						mesh.Tangent_Data.push_back(HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mTangents[i][0] : 0); // x
-						mesh.Tangent_Data.push_back(HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mTangents[i][1] : 0); // y
-						mesh.Tangent_Data.push_back(HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mTangents[i][2] : 0); // z
-						mesh.Tangent_Data.push_back(1.0); // handedness / sign. 1 is assumed, since assimp's internally matches openGL and also they do not provide this value in their data structure.
-
-						normal[0] = scene->mMeshes[mesh_index]->mNormals[i][0];
-						normal[1] = scene->mMeshes[mesh_index]->mNormals[i][1];
-						normal[2] = scene->mMeshes[mesh_index]->mNormals[i][2];
-						tangent[0] = HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mTangents[i][0] : 0;
-						tangent[1] = HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mTangents[i][1] : 0;
-						tangent[2] = HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mTangents[i][2] : 0;
-
-						if (Attributestyle == 1) {
-							// recalc bitangent, writes data to third argument.
-							cross(normal, tangent, bitangent);
-						}
-						else {
-							bitangent[0] = HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mBitangents[i][0] : 0; // x
-							bitangent[1] = HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mBitangents[i][1] : 0; // y
-							bitangent[2] = HasTangentsAndBitangents ? scene->mMeshes[mesh_index]->mBitangents[i][2] : 0; // z
-						}
+		// everything else is a plain per vertex copy. scratch values are local, since instances run in parallel.
+		for (int v = 0; v < numVerts; v++) {
+			int i = gather ? gather[v] : v; // vertex index in the assimp mesh.
+			int dst = vtxStart + v; // vertex index in the flattened mesh.
 
-						mesh.Bitangent_Data.push_back(bitangent[0]); // x
-						mesh.Bitangent_Data.push_back(bitangent[1]); // y
-						mesh.Bitangent_Data.push_back(bitangent[2]); // z
+			// ADD SOURCE MESH ID
+			mesh.MeshId_Data[dst] = inst;
 
-					} // for each vertex in this face.
+			// ADD VERTEX COLORS
+			mesh.Color_Data[dst] = Color(
+				HasVertexColors ? source->mColors[0][i][0] * vertexTint[0] : (float)vertexTint[0], // r
+				HasVertexColors ? source->mColors[0][i][1] * vertexTint[1] : (float)vertexTint[1], // g
+				HasVertexColors ? source->mColors[0][i][2] * vertexTint[2] : (float)vertexTint[2], // b
+				HasVertexColors ? source->mColors[0][i][3] * vertexTint[3] : (float)vertexTint[3]  // a
+			);
 
-					mesh.FaceIndex_Data.push_back(vtxOffset + 0);
-					mesh.FaceIndex_Data.push_back(vtxOffset + 1);
-					mesh.FaceIndex_Data.push_back(vtxOffset + 2);
-					vtxOffset += 3;
+			// ADD UVS
+			mesh.Uv_Data[dst] = TexCoord(
+				numTextureLayers ? source->mTextureCoords[0][i][0] : 0, // u
+				numTextureLayers ? source->mTextureCoords[0][i][1] : 0, // v
+				numTextureLayers ? source->mTextureCoords[0][i][2] : 0   // w
+			);
 
-					mesh.numTris += 1;
+			mesh.Tangent_Data[dst * 4 + 3] = sign;
 
-				} // for each face in this mesh.
+			float* normal = &mesh.Normal_Data[dst].x;
+			float* tangent = &mesh.Tangent_Data[dst * 4];
+			float* bitangent = &mesh.Bitangent_Data[dst * 3];
 
-			} // for each mesh in the assimp scene.
+			if (Attributestyle == 1) {
+				// recalc bitangent
+				cross(normal, tangent, bitangent);
+				bitangent[0] *= sign;
+				bitangent[1] *= sign;
+				bitangent[2] *= sign;
+			}
 
-			// do mikktspace generation of new tangent data. 
-			// tangent data will be written into the mesh object, updating old values.
-			context.m_pUserData = &mesh;
-			genTangSpaceDefault(&context);
-			//genTangSpace(&context, 10); // alternate if we care about setting smoothing angle argument.
+			// mikktspace replaces the tangents later, the tbn quat is calculated after that.
+			if (Attributestyle == 1 && DoMikktSpaceTangents == 0) {
+				tbn_to_quat(
+					tangent[0], tangent[1], tangent[2], sign,
+					bitangent[0], bitangent[1], bitangent[2],
+					normal[0], normal[1], normal[2], &mesh.TbnQuat_Data[dst * 4]
+				);
+			}
+		}
 
-			// since mikktspace tangent generation happens as a full post process after our mesh data is fully assembled
-			// we could not calculate tbn quat until after that step, so we loop back through our mesh data now that
-			// mikkt has been updated there, and calculate tbnquat from final data.
-			for (int vertex_index = 0; vertex_index < mesh.Position_Data.size(); vertex_index++) {
-				
-				normal[0] = mesh.Normal_Data[vertex_index].x;
-				normal[1] = mesh.Normal_Data[vertex_index].y;
-				normal[2] = mesh.Normal_Data[vertex_index].z;
+		// ADD MORPH TARGETS
+		// after the normals, since the normal deltas are taken against the transformed normals.
+		for (unsigned int anim_index = 0; anim_index < source->mNumAnimMeshes; anim_index++) {
+			gather_morph_deltas(source, source->mAnimMeshes[anim_index], instance, gather, numVerts, vtxStart, mesh, instanceMorphs[inst][anim_index]);
+		}
+	});
+
+	for (int inst = 0; inst < numInstances; inst++) {
+		for (size_t anim_index = 0; anim_index < instanceMorphs[inst].size(); anim_index++) {
+			MorphTarget& target = mesh.morphTargets[animMeshTargets[inst][anim_index]];
+			const MorphTarget& part = instanceMorphs[inst][anim_index];
+			target.vertices.insert(target.vertices.end(), part.vertices.begin(), part.vertices.end());
+			target.positionDeltas.insert(target.positionDeltas.end(), part.positionDeltas.begin(), part.positionDeltas.end());
+			target.normalDeltas.insert(target.normalDeltas.end(), part.normalDeltas.begin(), part.normalDeltas.end());
+		}
+	}
 
-				tangent[0] = mesh.Tangent_Data[(vertex_index * 4) +0];
-				tangent[1] = mesh.Tangent_Data[(vertex_index * 4) +1];
-				tangent[2] = mesh.Tangent_Data[(vertex_index * 4) +2];
-				tangentSign = mesh.Tangent_Data[(vertex_index * 4) +3];
+	mesh.flattenMs = elapsed_ms(flattenStart);
+	trace_span("flatten", flattenStart);
+
+	///////////////////////////////////////////////////////////////////////
+	//////////////////// MIKKT MESH PROCESSING METHOD /////////////////////
+	///////////////////////////////////////////////////////////////////////
+	if (DoMikktSpaceTangents == 1) {
+
+		// do mikktspace generation of new tangent data. 
+		// tangent data will be written into the mesh object, updating old values.
+		auto tangentsStart = std::chrono::high_resolution_clock::now();
+
+		// assign the various helper functions to mikktspace's interface object so it knows how to interact with our data.
+		SMikkTSpaceInterface iface{};
+		iface.m_getNumFaces = get_num_faces;
+		iface.m_getNumVerticesOfFace = get_num_vertices_of_face;
+		iface.m_getNormal = get_normal;
+		iface.m_getPosition = get_position;
+		iface.m_getTexCoord = get_tex_coords;
+		iface.m_setTSpaceBasic = set_tspace_basic;
+
+		SMikkTSpaceContext context{};
+		context.m_pInterface = &iface;
+		context.m_pUserData = &mesh;
+		genTangSpaceDefault(&context);
+		//genTangSpace(&context, 10); // alternate if we care about setting smoothing angle argument.
+		mesh.tangentsMs = elapsed_ms(tangentsStart);
+		trace_span("mikktspace", tangentsStart);
+
+		// since mikktspace tangent generation happens as a full post process after our mesh data is fully assembled
+		// we could not calculate tbn quat until after that step, so we loop back through our mesh data now that
+		// mikkt has been updated there, and calculate tbnquat from final data.
+		auto tbnQuatStart = std::chrono::high_resolution_clock::now();
+		float normal[3];
+		float tangent[3];
+		float tangentSign;
+		float bitangent[3];
+		float tbnquat[4];
+		for (int vertex_index = 0; vertex_index < mesh.Position_Data.size(); vertex_index++) {
+			
+			normal[0] = mesh.Normal_Data[vertex_index].x;
+			normal[1] = mesh.Normal_Data[vertex_index].y;
+			normal[2] = mesh.Normal_Data[vertex_index].z;
 
-				bitangent[0] = mesh.Bitangent_Data[(vertex_index * 3) +0];
-				bitangent[1] = mesh.Bitangent_Data[(vertex_index * 3) +1];
-				bitangent[2] = mesh.Bitangent_Data[(vertex_index * 3) +2];
+			tangent[0] = mesh.Tangent_Data[(vertex_index * 4) +0];
+			tangent[1] = mesh.Tangent_Data[(vertex_index * 4) +1];
+			tangent[2] = mesh.Tangent_Data[(vertex_index * 4) +2];
+			tangentSign = mesh.Tangent_Data[(vertex_index * 4) +3];
 
-				if (Attributestyle == 1) {
-					
-					tbn_to_quat(
-						tangent[0], tangent[1], tangent[2], tangentSign,
-						bitangent[0], bitangent[1], bitangent[2],
-						normal[0], normal[1], normal[2], tbnquat
-					);
-					
+			bitangent[0] = mesh.Bitangent_Data[(vertex_index * 3) +0];
+			bitangent[1] = mesh.Bitangent_Data[(vertex_index * 3) +1];
+			bitangent[2] = mesh.Bitangent_Data[(vertex_index * 3) +2];
 
-					// frisvadTangentSpace( tangent, bitangent, normal, tbnquat );
+			if (Attributestyle == 1) {
+				
+				tbn_to_quat(
+					tangent[0], tangent[1], tangent[2], tangentSign,
+					bitangent[0], bitangent[1], bitangent[2],
+					normal[0], normal[1], normal[2], tbnquat
+				);
+				
 
+				// frisvadTangentSpace( tangent, bitangent, normal, tbnquat );
 
-					mesh.TbnQuat_Data.push_back(tbnquat[0]);
-					mesh.TbnQuat_Data.push_back(tbnquat[1]);
-					mesh.TbnQuat_Data.push_back(tbnquat[2]);
-					mesh.TbnQuat_Data.push_back(tbnquat[3]);
 
-				}
+				mesh.TbnQuat_Data.push_back(tbnquat[0]);
+				mesh.TbnQuat_Data.push_back(tbnquat[1]);
+				mesh.TbnQuat_Data.push_back(tbnquat[2]);
+				mesh.TbnQuat_Data.push_back(tbnquat[3]);
 
 			}
 
 		}
+		mesh.tbnQuatMs = elapsed_ms(tbnQuatStart);
+		trace_span("tbn quat", tbnQuatStart);
 
+	}
 
 
-		////// TODO: maybe eventually get some tangent smoothing in here?
-		//for (int tri_index = 0; tri_index < mesh.numTris; tri_index++) {
-		//
-		//}
-
-		//Triangle tri;
-		//tri.uvs[0].u = 0;
-		//tri.uvs[0].u = 1;
 
-		//Assimp::DefaultLogger::get()->info("VERTS AFTER WELD: " + std::to_string(mesh.numTris));
-		
+	////// TODO: maybe eventually get some tangent smoothing in here?
+	//for (int tri_index = 0; tri_index < mesh.numTris; tri_index++) {
+	//
+	//}
 
-		/*
-		////////////////////// DO MESH WELDING /////////////////////////
-		if (DoMikktSpaceTangents == 1) {
+	//Triangle tri;
+	//tri.uvs[0].u = 0;
+	//tri.uvs[0].u = 1;
 
-			std::vector<float> vertex_data_in;
-			int num_verts_pre_weld = mesh.Position_Data.size();
-			int num_floats_per_vert = 0; // just initializing here.
+	//Assimp::DefaultLogger::get()->info("VERTS AFTER WELD: " + std::to_string(mesh.numTris));
+	
 
-			// Attributestyle == 0, TouchDesigner = 17 floats (P[3] + N[3] + Cd[4] + uv[3] + T[4] )
-			// Attributestyle == 0, TouchDesigner = 14 floats (P[3] + N[3] + Cd[4] + uv[3] )
-			// Attributestyle == 0, TouchDesigner = 3 floats (P[3] )
-			if (Attributestyle == 0) {
-				num_floats_per_vert = 13;
-			}
+	/*
+	////////////////////// DO MESH WELDING /////////////////////////
+	if (DoMikktSpaceTangents == 1) {
+
+		std::vector<float> vertex_data_in;
+		int num_verts_pre_weld = mesh.Position_Data.size();
+		int num_floats_per_vert = 0; // just initializing here.
+
+		// Attributestyle == 0, TouchDesigner = 17 floats (P[3] + N[3] + Cd[4] + uv[3] + T[4] )
+		// Attributestyle == 0, TouchDesigner = 14 floats (P[3] + N[3] + Cd[4] + uv[3] )
+		// Attributestyle == 0, TouchDesigner = 3 floats (P[3] )
+		if (Attributestyle == 0) {
+			num_floats_per_vert = 13;
+		}
 
-			// Attributestyle == 1, GoogleFilament = 13 floats (P[3] + mesh_color[4] + mesh_uv0[2] + mesh_tangents[4] )
-			else if (Attributestyle == 1) {
-				num_floats_per_vert = 13;
-			}
+		// Attributestyle == 1, GoogleFilament = 13 floats (P[3] + mesh_color[4] + mesh_uv0[2] + mesh_tangents[4] )
+		else if (Attributestyle == 1) {
+			num_floats_per_vert = 13;
+		}
 
-			// initialize some destination memory.
-			std::vector<int> remap_table (num_verts_pre_weld, 0);
-			std::vector<float> vertex_data_out(num_verts_pre_weld * num_floats_per_vert, 0);
+		// initialize some destination memory.
+		std::vector<int> remap_table (num_verts_pre_weld, 0);
+		std::vector<float> vertex_data_out(num_verts_pre_weld * num_floats_per_vert, 0);
 
-			// assemble vertex data in the structure that is required for the Attributestyle:
+		// assemble vertex data in the structure that is required for the Attributestyle:
 
-			if (Attributestyle == 0) { // TouchDesigner
+		if (Attributestyle == 0) { // TouchDesigner
+			
+			for (int i = 0; i < mesh.Position_Data.size(); i++) { // i is vertex index.
 				
-				for (int i = 0; i < mesh.Position_Data.size(); i++) { // i is vertex index.
-					
-					vertex_data_in.push_back(mesh.Position_Data[i].x);
-					vertex_data_in.push_back(mesh.Position_Data[i].y);
-					vertex_data_in.push_back(mesh.Position_Data[i].z);
+				vertex_data_in.push_back(mesh.Position_Data[i].x);
+				vertex_data_in.push_back(mesh.Position_Data[i].y);
+				vertex_data_in.push_back(mesh.Position_Data[i].z);
 
-					vertex_data_in.push_back(mesh.Normal_Data[i].x);
-					vertex_data_in.push_back(mesh.Normal_Data[i].y);
-					vertex_data_in.push_back(mesh.Normal_Data[i].z);
+				vertex_data_in.push_back(mesh.Normal_Data[i].x);
+				vertex_data_in.push_back(mesh.Normal_Data[i].y);
+				vertex_data_in.push_back(mesh.Normal_Data[i].z);
 
-					vertex_data_in.push_back(mesh.Color_Data[i].r);
-					vertex_data_in.push_back(mesh.Color_Data[i].g);
-					vertex_data_in.push_back(mesh.Color_Data[i].b);
-					vertex_data_in.push_back(mesh.Color_Data[i].a);
+				vertex_data_in.push_back(mesh.Color_Data[i].r);
+				vertex_data_in.push_back(mesh.Color_Data[i].g);
+				vertex_data_in.push_back(mesh.Color_Data[i].b);
+				vertex_data_in.push_back(mesh.Color_Data[i].a);
 
-					vertex_data_in.push_back(mesh.Uv_Data[i].u);
-					vertex_data_in.push_back(mesh.Uv_Data[i].v);
-					vertex_data_in.push_back(mesh.Uv_Data[i].w);
+				vertex_data_in.push_back(mesh.Uv_Data[i].u);
+				vertex_data_in.push_back(mesh.Uv_Data[i].v);
+				vertex_data_in.push_back(mesh.Uv_Data[i].w);
 
-					//vertex_data_in.push_back(mesh.Tangent_Data[i * 3 + 0]);
-					//vertex_data_in.push_back(mesh.Tangent_Data[i * 3 + 1]);
-					//vertex_data_in.push_back(mesh.Tangent_Data[i * 3 + 2]);
+				//vertex_data_in.push_back(mesh.Tangent_Data[i * 3 + 0]);
+				//vertex_data_in.push_back(mesh.Tangent_Data[i * 3 + 1]);
+				//vertex_data_in.push_back(mesh.Tangent_Data[i * 3 + 2]);
 
-				}
 			}
+		}
 
-			int num_verts_post_weld = WeldMesh(remap_table.data() , vertex_data_out.data() , vertex_data_in.data() , num_verts_pre_weld, num_floats_per_vert);
+		int num_verts_post_weld = WeldMesh(remap_table.data() , vertex_data_out.data() , vertex_data_in.data() , num_verts_pre_weld, num_floats_per_vert);
 
-			Assimp::DefaultLogger::get()->info("VERTS AFTER WELD: " + std::to_string(num_verts_post_weld));
-			Assimp::DefaultLogger::get()->info("VERTS AFTER WELD: " 
-				+ std::to_string(remap_table[0]) + ',' 
-				+ std::to_string(remap_table[1]) + ','
-			);
+		Assimp::DefaultLogger::get()->info("VERTS AFTER WELD: " + std::to_string(num_verts_post_weld));
+		Assimp::DefaultLogger::get()->info("VERTS AFTER WELD: " 
+			+ std::to_string(remap_table[0]) + ',' 
+			+ std::to_string(remap_table[1]) + ','
+		);
 
-		}
+	}
+
+	/////////////////////// END MESH WELDING ////////////////////////
+	*/
+
+}
 
-		/////////////////////// END MESH WELDING ////////////////////////
-		*/
+// the positions only version of flatten_scene, for a sequence frame with the same topology as the one mesh was flattened
+// from (see scene_topology_hash). positions, normals and the instance table are replaced, the assimp tangents too unless
+// mesh has mikktspace tangents, those are kept since regenerating them would split the vertices differently.
+// returns false, with mesh untouched, if the vertex count doesn't match after all.
+bool flatten_positions(const aiScene* scene, Mesh& mesh, const FlattenOptions& options) {
+
+	int DoMikktSpaceTangents = options.DoMikktSpaceTangents;
+	int Attributestyle = options.Attributestyle;
+
+	Mesh instanceTable;
+	std::vector<const aiNode*> referenceNodes;
+	std::vector<MeshInstance> instances = flatten_instances(scene, options, instanceTable, referenceNodes);
+	int numInstances = (int)instances.size();
+
+	std::vector<int> vertexOffsets(numInstances + 1, 0);
+	for (int inst = 0; inst < numInstances; inst++) {
+		const aiMesh* source = scene->mMeshes[instances[inst].meshIndex];
+		int numTris = 0;
+		for (unsigned int face_index = 0; face_index < source->mNumFaces; face_index++) {
+			numTris += source->mFaces[face_index].mNumIndices == 3;
+		}
+		vertexOffsets[inst + 1] = vertexOffsets[inst] + (DoMikktSpaceTangents ? numTris * 3 : (int)source->mNumVertices);
+	}
+	if (vertexOffsets[numInstances] != (int)mesh.Position_Data.size()) {
+		return false;
+	}
 
+	mesh.Instance_Data = instanceTable.Instance_Data;
+	bool hasTbnQuat = mesh.TbnQuat_Data.size() == mesh.Position_Data.size() * 4;
 
-		if (Attributestyle == 0) { // IF ATTRIBUTE STYLE IS TouchDesigner:
+	parallel_for(numInstances, [&](int inst) {
+		const MeshInstance& instance = instances[inst];
+		const aiMesh* source = scene->mMeshes[instance.meshIndex];
+		int vtxStart = vertexOffsets[inst];
+		int numVerts = vertexOffsets[inst + 1] - vtxStart;
+		if (numVerts == 0) {
+			return;
+		}
 
-			// add positions, normals, and colors.
-			output->addPoints(mesh.Position_Data.data(), vtxOffset);
-			output->setNormals(mesh.Normal_Data.data(), vtxOffset, 0);
-			output->setColors(mesh.Color_Data.data(), vtxOffset, 0);
-			
-			// add uvs, setTexCoords() seem broken, so we can't add them in one go.
-			int texindex = 0;
-			for (TexCoord i : mesh.Uv_Data) {
-				output->setTexCoord(&i, 1, texindex);
-				texindex++;
+		// same corners as flatten_scene, mikktspace vertices are per triangle corner.
+		std::vector<unsigned int> corners;
+		if (DoMikktSpaceTangents) {
+			for (unsigned int face_index = 0; face_index < source->mNumFaces; face_index++) {
+				const aiFace& face = source->mFaces[face_index];
+				if (face.mNumIndices != 3) {
+					continue;
+				}
+				corners.push_back(face.mIndices[0]);
+				corners.push_back(face.mIndices[instance.mirrored ? 2 : 1]);
+				corners.push_back(face.mIndices[instance.mirrored ? 1 : 2]);
 			}
+		}
+		const unsigned int* gather = DoMikktSpaceTangents ? corners.data() : nullptr;
 
-			// add tangents.
-			SOP_CustomAttribData Tangents_Attribute("T", 4, AttribType::Float);
-			Tangents_Attribute.floatData = mesh.Tangent_Data.data();
-			output->setCustomAttribute(&Tangents_Attribute, output->getNumPoints());
+		if (source->HasPositions()) {
+			transform_points(source->mVertices, gather, numVerts, instance.world, &mesh.Position_Data[vtxStart].x, 3);
+		}
+		if (source->HasNormals()) {
+			transform_directions(source->mNormals, gather, numVerts, instance.normalMatrix, &mesh.Normal_Data[vtxStart].x, 3);
+		}
 
+		const float tangentMatrix[9] = {
+			instance.world[0], instance.world[1], instance.world[2],
+			instance.world[4], instance.world[5], instance.world[6],
+			instance.world[8], instance.world[9], instance.world[10],
+		};
+		float sign = instance.mirrored ? -1.0f : 1.0f;
+		bool newTangents = DoMikktSpaceTangents == 0 && source->HasTangentsAndBitangents();
+		if (newTangents) {
+			transform_directions(source->mTangents, gather, numVerts, tangentMatrix, &mesh.Tangent_Data[vtxStart * 4], 4);
+			if (Attributestyle != 1) {
+				transform_directions(source->mBitangents, gather, numVerts, tangentMatrix, &mesh.Bitangent_Data[vtxStart * 3], 3);
+			}
 		}
 
-		if (Attributestyle == 1) { // IF ATTRIBUTE STYLE IS GoogleFilament:
+		for (int dst = vtxStart; dst < vtxStart + numVerts; dst++) {
+			float* normal = &mesh.Normal_Data[dst].x;
+			float* tangent = &mesh.Tangent_Data[dst * 4];
+			float* bitangent = &mesh.Bitangent_Data[dst * 3];
 
-			// add positions, TD requires this at a bare minimum. Filament looks for a vec4 called mesh_position though.
-			output->addPoints(mesh.Position_Data.data(), vtxOffset);
+			if (newTangents) {
+				tangent[3] = sign;
+			}
 
-			// add normals, this is extra attributes to upload to GPU, but it gives the SOP correct shading in TD. maybe we turn this off later.
-			output->setNormals(mesh.Normal_Data.data(), vtxOffset, 0);
+			if (Attributestyle == 1 && newTangents) {
+				cross(normal, tangent, bitangent);
+				bitangent[0] *= sign;
+				bitangent[1] *= sign;
+				bitangent[2] *= sign;
+			}
 
-			// add mesh_position, the vertex attribute filament actually looks for.
-			// since our position data is vec3, we expand it here to vec4.
-			SOP_CustomAttribData mesh_position_attrs("mesh_position", 4, AttribType::Float);
-			//expandedPositions.clear();
-			for (int i = 0; i < mesh.Position_Data.size(); i++) {
-				expandedPositions.push_back(mesh.Position_Data[i].x);
-				expandedPositions.push_back(mesh.Position_Data[i].y);
-				expandedPositions.push_back(mesh.Position_Data[i].z);
-				expandedPositions.push_back(1.0f);}
-			// assign it as a custom attribute, even though it's a fairly standard one by filament's standards.
-			mesh_position_attrs.floatData = expandedPositions.data();
-			output->setCustomAttribute(&mesh_position_attrs, output->getNumPoints());
-			//Assimp::DefaultLogger::get()->info("mesh.Position_Data.size(): " + std::to_string(mesh.Position_Data.size()));
-			//Assimp::DefaultLogger::get()->info("output->getNumPoints(): " + std::to_string(output->getNumPoints()));
-			//Assimp::DefaultLogger::get()->info("expandedPositions.size(): " + std::to_string(expandedPositions.size()));
-			
-			// add mesh_color for filament. fortunately color data is already a vec4.
-			// unfortunately can't assign it directly for c++ reasons. this is probably unefficient, so lets look at it later.
-			// maybe we can not use TD's Color class to store this in general.
-			SOP_CustomAttribData mesh_color_attrs("mesh_color", 4, AttribType::Float);
-			//expandedColors.clear();
-			for (int i = 0; i < mesh.Color_Data.size(); i++) {
-				expandedColors.push_back(mesh.Color_Data[i].r);
-				expandedColors.push_back(mesh.Color_Data[i].g);
-				expandedColors.push_back(mesh.Color_Data[i].b);
-				expandedColors.push_back(mesh.Color_Data[i].a);}
-			mesh_color_attrs.floatData = expandedColors.data();
-			output->setCustomAttribute(&mesh_color_attrs, output->getNumPoints());
-			
-			// set mesh_uv0 for filament.
-			SOP_CustomAttribData mesh_uv0_attrs("mesh_uv0", 2, AttribType::Float);
-			//expandedUvs0.clear();
-			int texindex = 0;
-			for (TexCoord i : mesh.Uv_Data) {
-				// output->setTexCoord(&i, 1, texindex);
-				expandedUvs0.push_back(*(&i.u));
-				expandedUvs0.push_back(*(&i.v));
-				texindex++;
+			// without new tangents (mikktspace, or a frame without any) the first frame's tangent is kept, and turned to
+			// follow the new normal.
+			if (hasTbnQuat) {
+				orthogonal_tbn_to_quat(normal, tangent, bitangent, &mesh.TbnQuat_Data[dst * 4]);
 			}
-			mesh_uv0_attrs.floatData = expandedUvs0.data();
-			output->setCustomAttribute(&mesh_uv0_attrs, output->getNumPoints());
-		
-			// set mesh_tangents for filament.
-			SOP_CustomAttribData mesh_tangents_attrs("mesh_tangents", 4, AttribType::Float);
-			mesh_tangents_attrs.floatData = mesh.TbnQuat_Data.data();
-			output->setCustomAttribute(&mesh_tangents_attrs, output->getNumPoints());
-
-			// debugging output
-			SOP_CustomAttribData mesh_debugging_attrs("mesh_debugging", 4, AttribType::Float);
-			mesh_debugging_attrs.floatData = debugging.data();
-			output->setCustomAttribute(&mesh_debugging_attrs, output->getNumPoints());
-		
 		}
+	});
 
+	return true;
+}
 
-		////////////////////////////////////////////////
-		/////////////////// STANDARD MESH TRIANGLES ////
-		////////////////////////////////////////////////
-		if (DoMikktSpaceTangents == 0) {
-			triOffset = 0;
-			for (int mesh_index = 0; mesh_index < scene->mNumMeshes; mesh_index++) {
-
-				if (scene->mMeshes[mesh_index]->HasFaces()) {
-					for (int i = 0; i < scene->mMeshes[mesh_index]->mNumFaces; i++)
-					{
-						
-						output->addTriangle(
-							scene->mMeshes[mesh_index]->mFaces[i].mIndices[0] + triOffset,
-							scene->mMeshes[mesh_index]->mFaces[i].mIndices[1] + triOffset,
-							scene->mMeshes[mesh_index]->mFaces[i].mIndices[2] + triOffset
-						);
-					}
-					triOffset += scene->mMeshes[mesh_index]->mNumVertices;
-				}
+// turns node or mesh names into valid group names, letters digits and underscores, not starting with a digit.
+// unnamed source meshes get mesh<id>.
+std::vector<std::string> primitive_group_names(const std::vector<std::string>& names) {
+	std::vector<std::string> groups(names.size());
+	for (size_t meshId = 0; meshId < names.size(); meshId++) {
+		std::string group = names[meshId];
+		for (char& c : group) {
+			if (!isalnum((unsigned char)c)) {
+				c = '_';
 			}
 		}
+		if (group.empty()) {
+			group = "mesh" + std::to_string(meshId);
+		}
+		else if (isdigit((unsigned char)group[0])) {
+			group = "_" + group;
+		}
+		groups[meshId] = group;
+	}
+	return groups;
+}
 
-		else {
+// adds the mesh's points, attributes and the given triangles to the sop, in the attribute layout chosen by Attributestyle.
+// indices is passed separately so the LOD levels and the overdraw ordering can swap in their own index buffer.
+// attributesMs is how long expanding the attributes to the filament layout took, bytes is how much was handed to the sop.
+// the filament attributes are expanded into scratch, which is left empty but keeps its capacity.
+void emit_mesh(SOP_Output* output, const Mesh& mesh, const std::vector<int32_t>& indices, int Attributestyle,
+	FilamentScratch& scratch, double& attributesMs, size_t& bytes) {
 
-			////////////////////////////////////////////////
-			/////////////////// MIKKT MESH TRIANGLES ///////
-			////////////////////////////////////////////////
-			triOffset = 0;
-			for (int face_index = 0; face_index < mesh.numTris; face_index++) {
+	std::vector<float>& expandedPositions = scratch.expandedPositions;
+	std::vector<float>& expandedColors = scratch.expandedColors;
+	std::vector<float>& expandedUvs0 = scratch.expandedUvs0;
+	std::vector<float>& debugging = scratch.debugging;
 
-				output->addTriangle(
-					mesh.FaceIndex_Data[(face_index * 3) + 0],
-					mesh.FaceIndex_Data[(face_index * 3) + 1],
-					mesh.FaceIndex_Data[(face_index * 3) + 2]
-				);
+	int numPoints = (int)mesh.Position_Data.size();
+	attributesMs = 0;
+	bytes = 0;
 
-			}
+	if (Attributestyle == 0) { // IF ATTRIBUTE STYLE IS TouchDesigner:
 
+		// add positions, normals, and colors.
+		output->addPoints(mesh.Position_Data.data(), numPoints);
+		output->setNormals(mesh.Normal_Data.data(), numPoints, 0);
+		output->setColors(mesh.Color_Data.data(), numPoints, 0);
+		
+		// add uvs, setTexCoords() seem broken, so we can't add them in one go.
+		int texindex = 0;
+		for (TexCoord i : mesh.Uv_Data) {
+			output->setTexCoord(&i, 1, texindex);
+			texindex++;
 		}
 
-		mesh.Position_Data.clear();
-		mesh.Normal_Data.clear();
-		mesh.Uv_Data.clear();
-		mesh.Color_Data.clear();
-		mesh.Tangent_Data.clear();
-		mesh.Bitangent_Data.clear();
-		mesh.TbnQuat_Data.clear();
-		mesh.FaceIndex_Data.clear();
-
-		expandedUvs0.clear();
-		expandedColors.clear();
-		expandedPositions.clear();
-
-		debugging.clear();
+		// add tangents.
+		SOP_CustomAttribData Tangents_Attribute("T", 4, AttribType::Float);
+		Tangents_Attribute.floatData = mesh.Tangent_Data.data();
+		output->setCustomAttribute(&Tangents_Attribute, output->getNumPoints());
 
+		bytes += mesh.Position_Data.size() * sizeof(Position) + mesh.Normal_Data.size() * sizeof(Vector)
+			+ mesh.Color_Data.size() * sizeof(Color) + mesh.Uv_Data.size() * sizeof(TexCoord) + mesh.Tangent_Data.size() * sizeof(float);
 	}
 
-}
-
+	if (Attributestyle == 1) { // IF ATTRIBUTE STYLE IS GoogleFilament:
+
+		// the attributes filament wants in a different layout are expanded first, so that can be timed apart from the sop calls.
+		auto attributesStart = std::chrono::high_resolution_clock::now();
+
+		// since our position data is vec3, we expand it here to vec4.
+		//expandedPositions.clear();
+		for (int i = 0; i < mesh.Position_Data.size(); i++) {
+			expandedPositions.push_back(mesh.Position_Data[i].x);
+			expandedPositions.push_back(mesh.Position_Data[i].y);
+			expandedPositions.push_back(mesh.Position_Data[i].z);
+			expandedPositions.push_back(1.0f);}
+
+		// color data is already a vec4, but can't assign it directly for c++ reasons. this is probably unefficient, so lets look at it later.
+		// maybe we can not use TD's Color class to store this in general.
+		//expandedColors.clear();
+		for (int i = 0; i < mesh.Color_Data.size(); i++) {
+			expandedColors.push_back(mesh.Color_Data[i].r);
+			expandedColors.push_back(mesh.Color_Data[i].g);
+			expandedColors.push_back(mesh.Color_Data[i].b);
+			expandedColors.push_back(mesh.Color_Data[i].a);}
+
+		// uvs are vec3, filament wants vec2.
+		//expandedUvs0.clear();
+		int texindex = 0;
+		for (TexCoord i : mesh.Uv_Data) {
+			// output->setTexCoord(&i, 1, texindex);
+			expandedUvs0.push_back(*(&i.u));
+			expandedUvs0.push_back(*(&i.v));
+			texindex++;
+		}
 
+		attributesMs = elapsed_ms(attributesStart);
+		trace_span("attributes", attributesStart);
 
+		// add positions, TD requires this at a bare minimum. Filament looks for a vec4 called mesh_position though.
+		output->addPoints(mesh.Position_Data.data(), numPoints);
 
-void
-TdAssimp::executeVBO(SOP_VBOOutput* output,const OP_Inputs* inputs,void* reserved)
-{
-	myExecuteCount++;
+		// add normals, this is extra attributes to upload to GPU, but it gives the SOP correct shading in TD. maybe we turn this off later.
+		output->setNormals(mesh.Normal_Data.data(), numPoints, 0);
 
-	if (!output)
-	{
-		return;
+		// add mesh_position, the vertex attribute filament actually looks for.
+		SOP_CustomAttribData mesh_position_attrs("mesh_position", 4, AttribType::Float);
+		// assign it as a custom attribute, even though it's a fairly standard one by filament's standards.
+		mesh_position_attrs.floatData = expandedPositions.data();
+		output->setCustomAttribute(&mesh_position_attrs, output->getNumPoints());
+		//Assimp::DefaultLogger::get()->info("mesh.Position_Data.size(): " + std::to_string(mesh.Position_Data.size()));
+		//Assimp::DefaultLogger::get()->info("output->getNumPoints(): " + std::to_string(output->getNumPoints()));
+		//Assimp::DefaultLogger::get()->info("expandedPositions.size(): " + std::to_string(expandedPositions.size()));
+		
+		// add mesh_color for filament.
+		SOP_CustomAttribData mesh_color_attrs("mesh_color", 4, AttribType::Float);
+		mesh_color_attrs.floatData = expandedColors.data();
+		output->setCustomAttribute(&mesh_color_attrs, output->getNumPoints());
+		
+		// set mesh_uv0 for filament.
+		SOP_CustomAttribData mesh_uv0_attrs("mesh_uv0", 2, AttribType::Float);
+		mesh_uv0_attrs.floatData = expandedUvs0.data();
+		output->setCustomAttribute(&mesh_uv0_attrs, output->getNumPoints());
+	
+		// set mesh_tangents for filament.
+		SOP_CustomAttribData mesh_tangents_attrs("mesh_tangents", 4, AttribType::Float);
+		mesh_tangents_attrs.floatData = mesh.TbnQuat_Data.data();
+		output->setCustomAttribute(&mesh_tangents_attrs, output->getNumPoints());
+
+		// debugging output
+		SOP_CustomAttribData mesh_debugging_attrs("mesh_debugging", 4, AttribType::Float);
+		mesh_debugging_attrs.floatData = debugging.data();
+		output->setCustomAttribute(&mesh_debugging_attrs, output->getNumPoints());
+
+		bytes += mesh.Position_Data.size() * sizeof(Position) + mesh.Normal_Data.size() * sizeof(Vector)
+			+ (expandedPositions.size() + expandedColors.size() + expandedUvs0.size() + mesh.TbnQuat_Data.size() + debugging.size()) * sizeof(float);
 	}
 
-}
 
-//-----------------------------------------------------------------------------------------------------
-//								CHOP, DAT, and custom parameters
-//-----------------------------------------------------------------------------------------------------
+	////////////////////////////////////////////////
+	/////////////////// MESH TRIANGLES /////////////
+	////////////////////////////////////////////////
+	// both the standard and mikkt methods assemble the final index buffer into FaceIndex_Data, so we can add them in one go.
+	output->addTriangles(indices.data(), (int32_t)indices.size() / 3);
+	bytes += indices.size() * sizeof(int32_t);
 
-void
-TdAssimp::getErrorString(OP_String * error, void*)
-{
-	error->setString(myError.c_str());
-	myError.clear();
-}
+	expandedUvs0.clear();
+	expandedColors.clear();
+	expandedPositions.clear();
+
+	debugging.clear();
 
-int32_t
-TdAssimp::getNumInfoCHOPChans(void* reserved)
-{
-	// We return the number of channel we want to output to any Info CHOP
-	// connected to the CHOP. In this example we are just going to send 4 channels.
-	return 4;
 }
 
 void
-TdAssimp::getInfoCHOPChan(int32_t index,
-								OP_InfoCHOPChan* chan, void* reserved)
+TdAssimp::execute(SOP_Output* output, const OP_Inputs* inputs, void* reserved)
 {
-	// This function will be called once for each channel we said we'd want to return
-	// In this example it'll only be called once.
+	myExecuteCount++;
+	std::cout << "======================================" << std::endl;
 
-	if (index == 0)
-	{
-		chan->name->setString("executeCount");
-		chan->value = (float)myExecuteCount;
-	}
+	// stage timings of this cook for the info CHOP. stages that didn't run (ie. the import when nothing changed) stay at 0.
+	// the whole cook is timed, and all of them go into the histograms, when execute returns.
+	std::fill(myStageMs, myStageMs + NumCookStages, 0.0f);
+	CookStatsScope cookStats(myCookStats, myStageMs);
 
-	if (index == 1)
-	{
-		chan->name->setString("offset");
-		chan->value = (float)myOffset;
-	}
+	// trace spans of this cook (and of the background work since the last one) are written when execute returns.
+	TraceCook cookTrace(myTrace, inputs->getParString("Tracefile"));
+	myEmittedVertices = 0;
+	myEmittedTriangles = 0;
+	myEmittedBytes = 0;
 
-	if (index == 2)
-	{
-		chan->name->setString(myChop.c_str());
-		chan->value = (float)myOffset;
-	}
+	// output style, choose TouchDesigner(0) or Google Filament(1)
+	int Attributestyle = inputs->getParInt("Attributestyle");
+	//Attributestyle = 1;
 
-	if (index == 3)
-	{
-		chan->name->setString(myChopChanName.c_str());
-		chan->value = myChopChanVal;
-	}
-}
+	// enable the Tangentalgorithm parameter, maybe able to delete this later due to a bug.
+	inputs->enablePar("Tangentalgorithm", 1);
 
-bool
-TdAssimp::getInfoDATSize(OP_InfoDATSize* infoSize, void* reserved)
-{
-	infoSize->rows = 1;
-	infoSize->cols = 2;
-	// Setting this to false means we'll be assigning values to the table
-	// one row at a time. True means we'll do it one column at a time.
-	infoSize->byColumn = false;
-	return true;
-}
+	// determine if we are processing tangents as assimp imported style OR as mikktspace tangents.
+	int DoMikktSpaceTangents = inputs->getParInt("Tangentalgorithm") == 1;
+	//DoMikktSpaceTangents = 0;
+	
 
-void
-TdAssimp::getInfoDATEntries(int32_t index,
-								int32_t nEntries,
-								OP_InfoDATEntries* entries,
-								void* reserved)
-{
-	char tempBuffer[4096];
+	// get the vertex color tint from the custom parameters. flatten_scene reads it from the FlattenOptions.
+	std::array<double, 4> Vertextint;
+	inputs->getParDouble4("Vertexcolortint", Vertextint[0], Vertextint[1], Vertextint[2], Vertextint[3]);
 
+	/////////////////////////////// LOGGING ///////////////////////////////////
 
-	if (index == 0)
-	{
-		// Set the value for the first column
-#ifdef _WIN32
-		strcpy_s(tempBuffer, "log");
-#else // macOS
-		strlcpy(tempBuffer, "log", sizeof(tempBuffer));
-#endif
-		entries->values[0]->setString(tempBuffer);
+	// Select the kinds of messages you want to receive on this log stream
+	// const unsigned int severity = Assimp::Logger::Debugging | Assimp::Logger::Info | Assimp::Logger::Warn | Assimp::Logger::Err;
+	const unsigned int severity = 0
+		| (inputs->getParInt("Debugging")	== 1 ? Assimp::Logger::Debugging : 0)
+		| (inputs->getParInt("Info")		== 1 ? Assimp::Logger::Info : 0)
+		| (inputs->getParInt("Warning")		== 1 ? Assimp::Logger::Warn : 0)
+		| (inputs->getParInt("Error")		== 1 ? Assimp::Logger::Err : 0)
+	;
 
-		// Set the value for the second column
-#ifdef _WIN32
-		strcpy_s(tempBuffer, myLog.c_str());
+	// assimp's profiler writes its timings as debug messages, which reach the import's ImportProfile whatever the severities.
+	int Profileimport = inputs->getParInt("Profileimport");
+
+	// messages logged on this thread during the cook go to this sop's log, which keeps the severities it's set to. the
+	// background threads of this sop log to the same ring, so they follow the flags too.
+	LogScope logScope(myLogRing);
+	myLogRing->setSeverity(severity);
+
+	/*
+	other ways to use the logger with custom messages.
+	Assimp::DefaultLogger::get()->info("This is an info level message.");
+	Assimp::DefaultLogger::get()->debug("This is a debug level message.");
+	Assimp::DefaultLogger::get()->warn("This is a warn level message.");
+	Assimp::DefaultLogger::get()->error("This is a error level message.");
+	*/
+
+
+	/////////////////////////////// LOADING 3D DATA VIA ASSIMP ///////////////////////////////////
+
+	// get the file path from the File parameter.
+	const char* pFile = inputs->getParString("File");
+
+	// sequence mode, File is a pattern and Frame picks the file of the current frame.
+	int Sequence = inputs->getParInt("Sequence");
+	std::string file = Sequence ? sequence_file(pFile, inputs->getParInt("Sequenceframe")) : std::string(pFile);
+
+	// instanced output, each unique mesh once plus a transform table in the info CHOP, instead of a copy per node.
+	int Instanced = inputs->getParInt("Instancedoutput");
+
+	// everything flatten_scene needs, name filters included.
+	FlattenOptions flattenOptions;
+	flattenOptions.DoMikktSpaceTangents = DoMikktSpaceTangents;
+	flattenOptions.Attributestyle = Attributestyle;
+	flattenOptions.Vertextint = Vertextint;
+	flattenOptions.Instanced = Instanced;
+	flattenOptions.Includenames = inputs->getParString("Includenames");
+	flattenOptions.Excludenames = inputs->getParString("Excludenames");
+
+	// read the file while also doing some post processing.
+	// post processing documentation: http://assimp.sourceforge.net/lib_html/postprocess_8h.html
+
+	const unsigned int meshProcessingFlags = 0
+		| aiProcess_CalcTangentSpace // calc tangent space must be enabled
+		| (inputs->getParInt("Joinidenticalvertices")		== 1 ? aiProcess_JoinIdenticalVertices : 0)
+		| aiProcess_Triangulate // triangulation must be enabled.
+		| aiProcess_GenNormals
+		| (inputs->getParInt("Validatedatastructure")		== 1 ? aiProcess_ValidateDataStructure : 0)
+		| (inputs->getParInt("Improvecachelocality")		== 1 ? aiProcess_ImproveCacheLocality : 0)
+		| (inputs->getParInt("Fixinfacingnormals")			== 1 ? aiProcess_FixInfacingNormals : 0)
+		| (inputs->getParInt("Sortbyptype")					== 1 ? aiProcess_SortByPType : 0)
+		| (inputs->getParInt("Finddegenerates")				== 1 ? aiProcess_FindDegenerates : 0)
+		| (inputs->getParInt("Findinvaliddata")				== 1 ? aiProcess_FindInvalidData : 0)
+		| (inputs->getParInt("Genuvcoords")					== 1 ? aiProcess_GenUVCoords : 0)
+		| (inputs->getParInt("Transformuvcoords")			== 1 ? aiProcess_TransformUVCoords : 0)
+		| (inputs->getParInt("Optimizemeshes")				== 1 ? aiProcess_OptimizeMeshes : 0)
+		| (inputs->getParInt("Optimizegraph")				== 1 ? aiProcess_OptimizeGraph : 0)
+		| (inputs->getParInt("Flipwindingorder")			== 1 ? aiProcess_FlipWindingOrder : 0)
+		| (inputs->getParInt("Flipwindingorder")			== 1 ? aiProcess_FlipWindingOrder : 0)
+		| (Instanced ? aiProcess_FindInstances : 0) // merges duplicate meshes, so more nodes end up sharing one.
+		;
+
+	// everything that changes the flattened mesh goes into the cache key. if none of it changed since the last cook,
+	// we skip the import and flattening entirely and go straight to the LOD / output stages.
+	// in sequence mode the key has the pattern, not the frame's file, the frames are handled below.
+	std::string flattenKey = std::string(pFile)
+		+ "|" + std::to_string(Sequence)
+		+ "|" + std::to_string(meshProcessingFlags)
+		+ "|" + std::to_string(severity)
+		+ "|" + std::to_string(Profileimport)
+		+ "|" + std::to_string(DoMikktSpaceTangents)
+		+ "|" + std::to_string(Attributestyle)
+		+ "|" + std::to_string(Instanced)
+		+ "|" + flattenOptions.Includenames + "|" + flattenOptions.Excludenames
+		+ "|" + std::to_string(Vertextint[0]) + "," + std::to_string(Vertextint[1]) + "," + std::to_string(Vertextint[2]) + "," + std::to_string(Vertextint[3]);
+
+	// the parameters of the LOD stage below, read up here so a cook the Memory Budget refused can be recognized before
+	// anything is imported.
+	int LodLevels = std::max(1, inputs->getParInt("Lodlevels"));
+	double LodRatio = inputs->getParDouble("Lodratio");
+
+	SimplifyOptions simplifyOptions;
+	simplifyOptions.normalWeight = (float)inputs->getParDouble("Lodnormalweight");
+	simplifyOptions.uvWeight = (float)inputs->getParDouble("Loduvweight");
+
+	int DoOverdrawOrdering = inputs->getParInt("Overdrawordering");
+	int DoOverdrawStats = inputs->getParInt("Overdrawstats");
+	float OverdrawThreshold = (float)inputs->getParDouble("Overdrawthreshold");
+
+	std::string lodKey = std::to_string(LodLevels)
+		+ "|" + std::to_string(LodRatio)
+		+ "|" + std::to_string(simplifyOptions.normalWeight)
+		+ "|" + std::to_string(simplifyOptions.uvWeight)
+		+ "|" + std::to_string(DoOverdrawOrdering)
+		+ "|" + std::to_string(DoOverdrawStats)
+		+ "|" + std::to_string(OverdrawThreshold);
+
+	// meshlets are built after the overdraw ordering, so they follow the final triangle order.
+	int DoMeshlets = inputs->getParInt("Meshlets");
+	int MeshletMaxVerts = DoMeshlets ? std::max(3, inputs->getParInt("Meshletmaxverts")) : 0;
+	int MeshletMaxTris = DoMeshlets ? std::max(1, inputs->getParInt("Meshletmaxtris")) : 0;
+	lodKey += "|" + std::to_string(MeshletMaxVerts) + "|" + std::to_string(MeshletMaxTris);
+
+	// Memory Budget in bytes, 0 is unlimited. settings refused for not fitting stay refused until they or the budget change,
+	// instead of being imported again every cook.
+	size_t MemoryBudget = (size_t)(std::max(inputs->getParDouble("Memorybudget"), 0.0) * 1024 * 1024);
+	std::string memoryKey = flattenKey + "|" + file + "|" + lodKey + "|" + std::to_string(MemoryBudget);
+	if (MemoryBudget > 0 && memoryKey == myMemoryRefusedKey) {
+		myError = myMemoryRefusedError;
+		return;
+	}
+
+	// drops everything this sop holds and fails the cook, what and bytes say what didn't fit.
+	auto refuseMemory = [&](const char* what, size_t bytes) {
+		myMemoryRefusedKey = memoryKey;
+		myMemoryRefusedError = "Memory Budget of " + memory_mb_string(MemoryBudget) + " exceeded: " + memory_mb_string(bytes)
+			+ " for " + what + ". Raise Memory Budget, or lower the LOD levels or prefetch frames.";
+		myError = myMemoryRefusedError;
+		myCache->clear();
+		myPrefetcher->stop();
+		release_filament_scratch(*myFilamentScratch);
+		cache_memory(*myCache, myMemoryBytes);
+		myMemoryBytes[MemoryFilament] = 0;
+		myMemoryBytes[MemoryPrefetch] = 0;
+	};
+
+	// Write Cache bakes the frame range of the sequence into the cache file, positions and normals only.
+	std::string CacheFile = inputs->getParString("Cachefile");
+	if (myWriteCachePending && Sequence && !CacheFile.empty()) {
+		myCacheReader->close();
+		std::string cacheError;
+		uint64_t cacheSize = write_sequence_cache(CacheFile, pFile, inputs->getParInt("Cacherange", 0), inputs->getParInt("Cacherange", 1),
+			meshProcessingFlags, flattenOptions, inputs->getParInt("Cachekeyframes"), inputs->getParInt("Cachebits"), cacheError);
+		if (!cacheError.empty()) {
+			myError = cacheError;
+		}
+		else {
+			Assimp::DefaultLogger::get()->info("sequence cache: wrote " + std::to_string(cacheSize) + " bytes to " + CacheFile);
+		}
+	}
+	myWriteCachePending = false;
+
+	// Profile All Steps, best of 2 imports per combination. the imports' own messages would only repeat the normal
+	// import's, so they're kept out of the log.
+	if (myProfileStepsPending) {
+		auto profileStart = std::chrono::high_resolution_clock::now();
+		{
+			LogScope quiet(nullptr);
+			myStepCosts = rank_post_process_steps(file, meshProcessingFlags, optimize_graph_keep_list(flattenOptions), 2);
+		}
+		trace_span("profile steps", profileStart, file.c_str());
+		if (myStepCosts.empty()) {
+			myError = "Profile All Steps: 3D file does not exist or failed to load.";
+		}
+		else {
+			Assimp::DefaultLogger::get()->info("profile steps: most expensive step is " + std::string(myStepCosts[0].name) + ", "
+				+ std::to_string(myStepCosts[0].costMs) + " ms.");
+		}
+	}
+	myProfileStepsPending = false;
+
+	// cache playback, only the first frame of the sequence is read with assimp (for the topology, uvs etc.), every
+	// frame's positions and normals are decoded from the cache.
+	int PlayCache = Sequence && inputs->getParInt("Playcache") && !CacheFile.empty();
+	if (PlayCache && myCacheReader->path() != CacheFile) {
+		std::string cacheError;
+		if (!myCacheReader->open(CacheFile, cacheError)) {
+			myError = cacheError;
+			return;
+		}
+		myCache->cacheFrame = INT_MIN;
+	}
+	if (PlayCache) {
+		file = sequence_file(pFile, myCacheReader->header().firstFrame);
+	}
+	else if (!myCacheReader->path().empty()) {
+		myCacheReader->close();
+	}
+
+	// sequences read every frame synchronously.
+	int Progressive = inputs->getParInt("Progressive") && !Sequence;
+
+	// progressive mode: the import runs on a background thread, and every cook swaps in whatever stage finished last,
+	// the subsampled preview first and then the full mesh. LODs etc. below are rebuilt for each stage.
+	if (myCache->flattenKey != flattenKey && Progressive) {
+
+		// parameters changed mid load, let the old load finish in the background and ignore what it produces.
+		if (myLoader->key() != flattenKey && myLoader->busy()) {
+			myLoader->cancel();
+		}
+
+		if (myLoader->key() != flattenKey && !myLoader->busy()) {
+			myLogRing->clear();
+			myLoader->start(flattenKey, pFile, meshProcessingFlags, flattenOptions, std::max(1, inputs->getParInt("Progressivepreviewtris")));
+		}
+
+		Mesh loaded;
+		std::string loadError;
+		ProgressiveLoader::Stage stage = myLoader->take(loaded, loadError);
+
+		if (!loadError.empty()) {
+			myError = loadError;
+			myCache->clear();
+			return;
+		}
+
+		if (stage != ProgressiveLoader::None) {
+			myCache->clear();
+			myCache->mesh = std::move(loaded);
+			if (stage == ProgressiveLoader::Full) {
+				myCache->flattenKey = flattenKey;
+				myCache->file = file;
+			}
+			myStageMs[StageFlatten] = (float)myCache->mesh.flattenMs;
+			myStageMs[StageTangents] = (float)myCache->mesh.tangentsMs;
+			myStageMs[StageTbnQuat] = (float)myCache->mesh.tbnQuatMs;
+		}
+
+		// nothing to show until the preview is done.
+		if (myCache->mesh.Position_Data.empty()) {
+			return;
+		}
+	}
+
+	// prefetching reads the next frames in the playback direction on worker threads.
+	int PrefetchFrames = inputs->getParInt("Prefetchframes");
+	int Prefetch = Sequence && !PlayCache && PrefetchFrames > 0;
+	int SequenceFrame = inputs->getParInt("Sequenceframe");
+	if (Prefetch) {
+		size_t budget = (size_t)(std::max(inputs->getParDouble("Prefetchbudget"), 0.0) * 1024.0 * 1024.0);
+
+		// the prefetched frames also have to fit in what the Memory Budget leaves, rounded to MB so the workers aren't
+		// restarted for every small change in what the rest holds.
+		if (MemoryBudget > 0) {
+			size_t held = memory_held(myMemoryBytes) - myMemoryBytes[MemoryPrefetch];
+			size_t left = MemoryBudget > held ? MemoryBudget - held : 0;
+			budget = std::min(budget, left / (1024 * 1024) * 1024 * 1024);
+		}
+		myPrefetcher->configure(flattenKey, pFile, meshProcessingFlags, flattenOptions, PrefetchFrames, budget);
+	}
+	else if (myPrefetcher->busy()) {
+		myPrefetcher->stop();
+	}
+
+	mySequencePositionsOnly = false;
+	if ((myCache->flattenKey != flattenKey || myCache->file != file) && !Progressive) {
+
+		// switching progressive off mid load, drop whatever the background load produces.
+		if (myLoader->key() != "") {
+			myLoader->cancel();
+		}
+
+		// the log only describes the last import, so clear it when we re-import.
+		myLogRing->clear();
+
+		// a frame the prefetcher already read and flattened, only its vertices are copied if the topology didn't change.
+		Mesh prefetched;
+		uint64_t prefetchedHash = 0;
+		double decodeMs = 0;
+		if (Prefetch && myPrefetcher->take(SequenceFrame, prefetched, prefetchedHash, decodeMs)) {
+			if (myCache->flattenKey == flattenKey && myCache->topologyHash == prefetchedHash
+				&& sequence_copy_vertices(prefetched, myCache->mesh)) {
+				update_lod_vertices(*myCache);
+				mySequencePositionsOnly = true;
+			}
+			else {
+				myCache->clear();
+				myCache->mesh = std::move(prefetched);
+				myCache->flattenKey = flattenKey;
+				myCache->topologyHash = prefetchedHash;
+			}
+		}
+
+		else {
+			myPrefetchMisses += Prefetch;
+			auto decodeStart = std::chrono::high_resolution_clock::now();
+
+			// define/declare an instance of the assimp importer.
+			Assimp::Importer importer;
+
+			// keep the nodes the name filters ask for by name from being merged away by Optimizegraph.
+			importer.SetPropertyString(AI_CONFIG_PP_OG_EXCLUDE_LIST, optimize_graph_keep_list(flattenOptions));
+
+			// Profile Import, assimp times the reading and every post processing step, and the timings are parsed from its
+			// debug messages.
+			ImportProfile importProfile;
+			bool profiling = Profileimport != 0;
+			ProfileScope profileScope(profiling ? &importProfile : nullptr);
+			importer.SetPropertyInteger(AI_CONFIG_GLOB_MEASURE_TIME, profiling ? 1 : 0);
+
+			// read the file into the scene variable. the post processing is applied as a second step, so the parse and
+			// the post processing can be timed separately.
+			auto readStart = std::chrono::high_resolution_clock::now();
+			const aiScene* scene = importer.ReadFile( file, 0 );
+			myStageMs[StageRead] = (float)elapsed_ms(readStart);
+			trace_span("read", readStart, file.c_str());
+
+			if (scene) {
+				auto postProcessStart = std::chrono::high_resolution_clock::now();
+				scene = importer.ApplyPostProcessing( meshProcessingFlags );
+				myStageMs[StagePostProcess] = (float)elapsed_ms(postProcessStart);
+				trace_span("postprocess", postProcessStart);
+			}
+			myImportSteps = importProfile.steps();
+
+			// assimp's estimate of the scene, which is gone again after this cook, so it only counts towards the peak.
+			if (scene) {
+				aiMemoryInfo sceneMemory;
+				importer.GetMemoryRequirements(sceneMemory);
+				myMemoryBytes[MemoryScene] = sceneMemory.total;
+				myMemoryPeak[MemoryScene] = std::max(myMemoryPeak[MemoryScene], (size_t)sceneMemory.total);
+				myMemoryPeakTotal = std::max(myMemoryPeakTotal, memory_held(myMemoryBytes) + sceneMemory.total);
+
+				if (MemoryBudget > 0 && sceneMemory.total > MemoryBudget) {
+					refuseMemory("the imported scene", sceneMemory.total);
+					return;
+				}
+			}
+
+			// If the import failed, report it, and halt the flow.
+			if (nullptr == scene) {
+				myError = "3D file does not exist or failed to load.";
+				myCache->clear();
+				return;
+			}
+
+			// the next frame of a sequence with the same topology as the cached one only replaces the positions and normals,
+			// the LOD levels, overdraw ordering and meshlets keep their index buffers.
+			auto flattenStart = std::chrono::high_resolution_clock::now();
+			uint64_t topologyHash = 0;
+			if (Sequence) {
+				Mesh instanceTable;
+				std::vector<const aiNode*> referenceNodes;
+				topologyHash = scene_topology_hash(scene, flatten_instances(scene, flattenOptions, instanceTable, referenceNodes));
+			}
+
+			if (Sequence && myCache->flattenKey == flattenKey && myCache->topologyHash == topologyHash
+				&& flatten_positions(scene, myCache->mesh, flattenOptions)) {
+				update_lod_vertices(*myCache);
+				mySequencePositionsOnly = true;
+				myStageMs[StageFlatten] = (float)elapsed_ms(flattenStart);
+				trace_span("flatten positions", flattenStart);
+			}
+
+			// if import succeeded, flatten the scene into the cache.
+			else {
+				myCache->clear();
+				flatten_scene(scene, myCache->mesh, flattenOptions);
+				myCache->flattenKey = flattenKey;
+				myCache->topologyHash = topologyHash;
+				myStageMs[StageFlatten] = (float)myCache->mesh.flattenMs;
+				myStageMs[StageTangents] = (float)myCache->mesh.tangentsMs;
+				myStageMs[StageTbnQuat] = (float)myCache->mesh.tbnQuatMs;
+			}
+
+			decodeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - decodeStart).count();
+		}
+		mySequenceDecodeMs = (float)decodeMs;
+		myCache->file = file;
+	}
+
+	if (PlayCache) {
+		if (myCacheReader->header().topologyHash != myCache->topologyHash) {
+			myError = "Sequence cache was written with a different file or import settings.";
+			return;
+		}
+		if (myCache->cacheFrame != SequenceFrame) {
+			auto decodeStart = std::chrono::high_resolution_clock::now();
+			if (!myCacheReader->decode(SequenceFrame, myCache->mesh)) {
+				myError = "Sequence cache is damaged.";
+				myCacheReader->close();
+				return;
+			}
+			update_lod_vertices(*myCache);
+			myCache->cacheFrame = SequenceFrame;
+			mySequencePositionsOnly = true;
+			mySequenceDecodeMs = (float)std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - decodeStart).count();
+		}
+	}
+
+	if (Prefetch) {
+		if (SequenceFrame != mySequenceFrame) {
+			mySequenceDirection = SequenceFrame > mySequenceFrame ? 1 : -1;
+		}
+		mySequenceFrame = SequenceFrame;
+		myPrefetcher->request(SequenceFrame, mySequenceDirection);
+		myPrefetchDepth = myPrefetcher->ready();
+	}
+	else {
+		myPrefetchDepth = 0;
+	}
+
+	/////////////////////////////// LOD GENERATION ///////////////////////////////////
+	// all the LOD levels are generated in one go and cached, so switching the Lod parameter doesn't re-import or re-simplify.
+	// level 0 is the full resolution mesh, every level after that is simplified from the previous one by Lodratio.
+	if (myCache->lodKey != lodKey) {
+		auto lodStart = std::chrono::high_resolution_clock::now();
+		build_lods(*myCache, LodLevels, LodRatio, simplifyOptions, DoOverdrawOrdering, OverdrawThreshold, DoOverdrawStats, MeshletMaxVerts, MeshletMaxTris);
+		myCache->lodKey = lodKey;
+		myStageMs[StageLod] = (float)elapsed_ms(lodStart);
+		trace_span("lod", lodStart);
+	}
+
+	// pick the requested LOD level. level 0 only stores its (possibly reordered) index buffer, the vertex data is the full res mesh.
+	int Lod = std::min(std::max(inputs->getParInt("Lod"), 0), (int)myCache->lods.size() - 1);
+	const Mesh& lodMesh = myCache->lods[Lod];
+	const Mesh& outputMesh = Lod == 0 ? myCache->mesh : lodMesh;
+
+	myAcmrBefore = myCache->lodStats[Lod][0];
+	myAcmrAfter = myCache->lodStats[Lod][1];
+	myOverdrawBefore = myCache->lodStats[Lod][2];
+	myOverdrawAfter = myCache->lodStats[Lod][3];
+	myInfoLod = Lod;
+
+	/////////////////////////////// ANIMATION ///////////////////////////////////
+	// the pose every deformation below uses, the rest pose of the node hierarchy unless an animation is playing.
+	// animation, skinning and morphing are timed together as the deform stage.
+	auto deformStart = std::chrono::high_resolution_clock::now();
+	const Skeleton& skeleton = myCache->mesh.skeleton;
+	const std::vector<Animation>& animations = myCache->mesh.animations;
+	int Clip = std::min(std::max(inputs->getParInt("Animationclip"), 0), std::max((int)animations.size() - 1, 0));
+	myAnimating = inputs->getParInt("Playanimation") && !animations.empty();
+
+	std::vector<float> locals = skeleton.nodeLocals;
+	if (myAnimating) {
+		const Animation& animation = animations[Clip];
+		if (myCache->sampler.clip != Clip) {
+			myCache->sampler.reset(animation, Clip);
+		}
+		double ticks = animation_ticks(animation, inputs->getParDouble("Animationtime"), inputs->getParInt("Animationloop") != 0);
+		myCache->sampler.sample(animation, ticks, locals);
+	}
+
+	// sampling throughput, with the key cursors and with a binary search per key for comparison.
+	if (myBenchmarkPending && !animations.empty()) {
+		myBenchmarkCursor = (float)benchmark_animation_sampler(animations[Clip], skeleton, true);
+		myBenchmarkSearch = (float)benchmark_animation_sampler(animations[Clip], skeleton, false);
+		Assimp::DefaultLogger::get()->info("animation sampler: " + std::to_string(myBenchmarkCursor) + " channels/ms with cursors, "
+			+ std::to_string(myBenchmarkSearch) + " channels/ms with binary search.");
+	}
+	myBenchmarkPending = false;
+
+	std::vector<float> worlds;
+	skeleton_worlds(skeleton, locals, worlds);
+
+	if (myAnimating && !skeleton.instanceNodes.empty()) {
+		animated_instance_table(myCache->mesh, skeleton, worlds, myInstanceData);
+	}
+	else {
+		myInstanceData = myCache->mesh.Instance_Data;
+	}
+
+	/////////////////////////////// SKINNING ///////////////////////////////////
+	// Attributes outputs the joint indices / weights and the skin matrices for skinning in a glsl mat,
+	// CPU deforms the output mesh here.
+	int Skinning = inputs->getParInt("Skinning");
+	mySkinMatrices.clear();
+
+	std::vector<float> skinMatrices;
+	if (Skinning != 0 && !skeleton.empty()) {
+		skeleton_pose(skeleton, worlds, skinMatrices);
+	}
+	if (Skinning == 1) {
+		mySkinMatrices = skinMatrices;
+	}
+
+	/////////////////////////////// MORPH TARGETS ///////////////////////////////////
+	// weights come from the Morph CHOP, first sample of the channel named like the target. if none of the channel names
+	// match, the channels are taken in target order. targets without a channel keep the weight from the file.
+	const std::vector<MorphTarget>& morphTargets = myCache->mesh.morphTargets;
+	myMorphWeights.clear();
+	for (const MorphTarget& target : morphTargets) {
+		myMorphWeights.push_back(target.defaultWeight);
+	}
+
+	const OP_CHOPInput* morphChop = inputs->getParCHOP("Morphchop");
+	if (morphChop && morphChop->numSamples > 0 && !morphTargets.empty()) {
+		bool matchedName = false;
+		for (int t = 0; t < (int)morphTargets.size(); t++) {
+			for (int c = 0; c < morphChop->numChannels; c++) {
+				if (morphTargets[t].name == morphChop->getChannelName(c)) {
+					myMorphWeights[t] = morphChop->getChannelData(c)[0];
+					matchedName = true;
+					break;
+				}
+			}
+		}
+		if (!matchedName) {
+			for (int t = 0; t < std::min((int)morphTargets.size(), morphChop->numChannels); t++) {
+				myMorphWeights[t] = morphChop->getChannelData(t)[0];
+			}
+		}
+	}
+
+	// the targets are blended into a cached copy of the output mesh, only the vertices of non zero (or just zeroed)
+	// targets are touched. the source meshes it changed are redone by the rigid animation below.
+	bool morphing = !morphTargets.empty();
+	std::vector<char> dirtyMeshes(skeleton.meshNodes.size(), 0);
+	if (morphing) {
+		MorphedMesh& morphed = myCache->morphed;
+		std::string morphedKey = myCache->lodKey + "|" + std::to_string(Lod);
+		if (morphed.key != morphedKey) {
+			morphed_mesh_reset(morphed, outputMesh, morphTargets, morphedKey);
+		}
+		morphed_mesh_update(morphed, outputMesh, myMorphWeights, dirtyMeshes);
+	}
+	const Mesh& baseMesh = morphing ? myCache->morphed.mesh : outputMesh;
+
+	// rigid node animation is applied to a cached copy of the (morphed) output mesh, only re-transforming the source meshes
+	// that moved, and CPU skinning writes the skinned points into the same copy.
+	bool rigidAnimation = myAnimating && std::any_of(skeleton.meshNodes.begin(), skeleton.meshNodes.end(), [](int node) { return node >= 0; });
+	bool cpuSkinning = Skinning == 2 && !skinMatrices.empty();
+	bool anyDirty = std::any_of(dirtyMeshes.begin(), dirtyMeshes.end(), [](char dirty) { return dirty != 0; });
+	myAnimatedMeshes = 0;
+
+	const Mesh* emittedMesh = &baseMesh;
+	if (rigidAnimation || cpuSkinning) {
+		AnimatedMesh& animated = myCache->animated;
+		std::string animatedKey = myCache->lodKey + "|" + std::to_string(Lod) + "|" + std::to_string(Skinning) + "|" + std::to_string(myAnimating)
+			+ "|" + std::to_string(morphing);
+		if (animated.key != animatedKey) {
+			animated_mesh_reset(animated, baseMesh, skeleton, animatedKey);
+		}
+		if (rigidAnimation || anyDirty) {
+			myAnimatedMeshes = animated_mesh_update(animated, baseMesh, skeleton, worlds, dirtyMeshes);
+		}
+		if (cpuSkinning) {
+			skin_mesh(baseMesh, animated.mesh, skinMatrices);
+		}
+		emittedMesh = &animated.mesh;
+	}
+
+	myStageMs[StageDeform] = (float)elapsed_ms(deformStart);
+	trace_span("deform", deformStart);
+
+	/////////////////////////////// MEMORY BUDGET ///////////////////////////////////
+	// over the budget, the things that are rebuilt on demand go first: the filament buffers (emit_mesh grows them back
+	// to what this mesh needs), the bvhs and the prefetched frames. if that isn't enough, the cook is refused.
+	cache_memory(*myCache, myMemoryBytes);
+	myMemoryBytes[MemoryFilament] = filament_scratch_bytes(*myFilamentScratch);
+	myMemoryBytes[MemoryPrefetch] = myPrefetcher->bytes();
+	if (MemoryBudget > 0 && memory_held(myMemoryBytes) > MemoryBudget) {
+		release_filament_scratch(*myFilamentScratch);
+		for (Bvh& bvh : myCache->lodBvhs) {
+			bvh = Bvh();
+		}
+		myPrefetcher->stop();
+		cache_memory(*myCache, myMemoryBytes);
+		myMemoryBytes[MemoryFilament] = 0;
+		myMemoryBytes[MemoryPrefetch] = 0;
+		Assimp::DefaultLogger::get()->warn("memory budget: released the filament buffers, bvhs and prefetched frames, "
+			+ memory_mb_string(memory_held(myMemoryBytes)) + " still held.");
+
+		if (memory_held(myMemoryBytes) > MemoryBudget) {
+			refuseMemory("the mesh, its LOD levels and animation copies", memory_held(myMemoryBytes));
+			return;
+		}
+	}
+
+	// everything handed to the sop from here to the groups is the output stage, minus the attribute expansion in emit_mesh.
+	auto outputStart = std::chrono::high_resolution_clock::now();
+	double attributesMs = 0;
+	emit_mesh(output, *emittedMesh, lodMesh.FaceIndex_Data, Attributestyle, *myFilamentScratch, attributesMs, myEmittedBytes);
+	myEmittedVertices = (int)emittedMesh->Position_Data.size();
+	myEmittedTriangles = (int)lodMesh.FaceIndex_Data.size() / 3;
+
+	if (Skinning == 1 && !outputMesh.JointIndex_Data.empty()) {
+		SOP_CustomAttribData jointindex_attrs("jointindex", kSkinInfluences, AttribType::Int);
+		jointindex_attrs.intData = outputMesh.JointIndex_Data.data();
+		output->setCustomAttribute(&jointindex_attrs, output->getNumPoints());
+
+		SOP_CustomAttribData jointweight_attrs("jointweight", kSkinInfluences, AttribType::Float);
+		jointweight_attrs.floatData = outputMesh.JointWeight_Data.data();
+		output->setCustomAttribute(&jointweight_attrs, output->getNumPoints());
+		myEmittedBytes += outputMesh.JointIndex_Data.size() * sizeof(int32_t) + outputMesh.JointWeight_Data.size() * sizeof(float);
+	}
+
+	// meshlet id per point, so a glsl mat can look up the meshlet bounds (ie. from the info dat) for culling.
+	std::vector<int32_t>& pointClusters = myCache->lodPointClusters[Lod];
+	if (!pointClusters.empty()) {
+		SOP_CustomAttribData clusterid_attrs("clusterid", 1, AttribType::Int);
+		clusterid_attrs.intData = pointClusters.data();
+		output->setCustomAttribute(&clusterid_attrs, output->getNumPoints());
+		myEmittedBytes += pointClusters.size() * sizeof(int32_t);
+	}
+
+	/////////////////////////////// GROUPS ///////////////////////////////////
+	// source mesh id per point. points are never shared between source meshes, so this also tells every primitive its mesh.
+	if (inputs->getParInt("Meshidattribute")) {
+		SOP_CustomAttribData meshid_attrs("meshid", 1, AttribType::Int);
+		meshid_attrs.intData = outputMesh.MeshId_Data.data();
+		output->setCustomAttribute(&meshid_attrs, output->getNumPoints());
+		myEmittedBytes += outputMesh.MeshId_Data.size() * sizeof(int32_t);
+	}
+
+	// one primitive group per node or per mesh name. the triangles of each source mesh are a contiguous range
+	// (MeshFace_Offsets), so membership is just a walk over those ranges.
+	int Primitivegroups = inputs->getParInt("Primitivegroups");
+	if (Primitivegroups != 0) {
+		const std::vector<std::string>& names = Primitivegroups == 1 ? myCache->mesh.NodeName_Data : myCache->mesh.MeshName_Data;
+		std::vector<std::string> groups = primitive_group_names(names);
+
+		// several source meshes can share a name (ie. one node with several meshes), they share the group.
+		std::unordered_set<std::string> created;
+		int meshCount = (int)lodMesh.MeshFace_Offsets.size() - 1;
+		for (int meshId = 0; meshId < meshCount; meshId++) {
+			const std::string& group = groups[meshId];
+			if (created.insert(group).second) {
+				output->addGroup(SOP_GroupType::Primitive, group.c_str());
+			}
+			for (int prim = lodMesh.MeshFace_Offsets[meshId]; prim < lodMesh.MeshFace_Offsets[meshId + 1]; prim++) {
+				output->addPrimToGroup(prim, group.c_str());
+			}
+		}
+	}
+
+	myStageMs[StageAttributes] = (float)attributesMs;
+	myStageMs[StageOutput] = (float)(elapsed_ms(outputStart) - attributesMs);
+	trace_span("output", outputStart);
+
+	/////////////////////////////// QUALITY REPORT ///////////////////////////////////
+	// redone whenever the emitted points or triangles could have changed: new import or frame, LODs, attribute style, or
+	// every cook while the mesh is being deformed.
+	if (inputs->getParInt("Qualityreport")) {
+		int QualityCacheSize = inputs->getParInt("Qualitycachesize");
+		std::string qualityKey = myCache->flattenKey + "|" + myCache->file + "|" + std::to_string(myCache->cacheFrame) + "|" + myCache->lodKey
+			+ "|" + std::to_string(Lod) + "|" + std::to_string(QualityCacheSize) + "|" + std::to_string(myEmittedBytes);
+		if (qualityKey != myQualityKey || emittedMesh != &outputMesh) {
+			TraceScope qualitySpan("quality");
+			size_t attributeBytes = myEmittedBytes - lodMesh.FaceIndex_Data.size() * sizeof(int32_t);
+			myQualityRows = quality_rows(analyze_quality(*emittedMesh, lodMesh.FaceIndex_Data, QualityCacheSize, attributeBytes));
+			myQualityKey = qualityKey;
+		}
+	}
+	else {
+		myQualityRows.clear();
+		myQualityKey.clear();
+	}
+
+	/////////////////////////////// BVH QUERIES ///////////////////////////////////
+	// the bvh is built over the emitted points of the output LOD, so queries see the same pose as the SOP output.
+	// the rest pose is built the first time it's needed and kept until the LOD levels are rebuilt. a deformed pose can
+	// change every cook, so it's rebuilt on every cook that queries it, and replaced again once the mesh is back at rest.
+	int DoBvh = inputs->getParInt("Buildbvh");
+	int QueryEveryCook = inputs->getParInt("Queryeverycook");
+	if (DoBvh) {
+		Bvh& bvh = myCache->lodBvhs[Lod];
+		const OP_CHOPInput* queryChop = inputs->getParCHOP("Querychop");
+		bool querying = queryChop && (myQueryPending || QueryEveryCook);
+		bool deformed = emittedMesh != &outputMesh;
+		bool stale = bvh.empty() || myCache->lodBvhPosed[Lod];
+		if (deformed ? querying : stale) {
+			TraceScope bvhSpan("bvh");
+			build_bvh(bvh, lodMesh.FaceIndex_Data, emittedMesh->Position_Data);
+			myCache->lodBvhPosed[Lod] = deformed;
+		}
+
+		if (querying) {
+			// Ray(0): every sample is a ray, origin xyz from the first 3 channels and direction xyz from the next 3.
+			// Closest Point(1): every sample is a point, xyz from the first 3 channels.
+			int QueryMode = inputs->getParInt("Querymode");
+			int neededChannels = QueryMode == 0 ? 6 : 3;
+
+			if (queryChop->numChannels < neededChannels) {
+				myError = "Query CHOP needs " + std::to_string(neededChannels) + " channels.";
+				myQueryHits.clear();
+			}
+			else {
+				int numQueries = queryChop->numSamples;
+				myQueryHits.assign(numQueries, BvhHit());
+
+				const int chunkSize = 64;
+				parallel_for((numQueries + chunkSize - 1) / chunkSize, [&](int chunk) {
+					for (int q = chunk * chunkSize; q < std::min(numQueries, (chunk + 1) * chunkSize); q++) {
+						float point[3] = { queryChop->getChannelData(0)[q], queryChop->getChannelData(1)[q], queryChop->getChannelData(2)[q] };
+						if (QueryMode == 0) {
+							float direction[3] = { queryChop->getChannelData(3)[q], queryChop->getChannelData(4)[q], queryChop->getChannelData(5)[q] };
+							myQueryHits[q] = bvh_raycast(bvh, point, direction);
+						}
+						else {
+							myQueryHits[q] = bvh_closest_point(bvh, point);
+						}
+					}
+				});
+			}
+			myQueryPending = false;
+		}
+	}
+	else {
+		myQueryHits.clear();
+	}
+
+	// what the cook left behind, the bvh and the filament buffers included.
+	cache_memory(*myCache, myMemoryBytes);
+	myMemoryBytes[MemoryFilament] = filament_scratch_bytes(*myFilamentScratch);
+	for (int pool = 0; pool < NumMemoryPools; pool++) {
+		myMemoryPeak[pool] = std::max(myMemoryPeak[pool], myMemoryBytes[pool]);
+	}
+	myMemoryPeakTotal = std::max(myMemoryPeakTotal, memory_held(myMemoryBytes));
+}
+
+
+
+
+void
+TdAssimp::executeVBO(SOP_VBOOutput* output,const OP_Inputs* inputs,void* reserved)
+{
+	myExecuteCount++;
+
+	if (!output)
+	{
+		return;
+	}
+
+}
+
+//-----------------------------------------------------------------------------------------------------
+//								CHOP, DAT, and custom parameters
+//-----------------------------------------------------------------------------------------------------
+
+void
+TdAssimp::getErrorString(OP_String * error, void*)
+{
+	error->setString(myError.c_str());
+	myError.clear();
+}
+
+// cook stage timings (in the order of CookStage) and output counts at the start of the Info CHOP.
+static const char* cookStageChannels[] = { "read_ms", "postprocess_ms", "flatten_ms", "tangents_ms", "tbnquat_ms",
+	"lod_ms", "deform_ms", "attributes_ms", "output_ms", "cook_ms", "vertices", "triangles", "bytes_emitted" };
+static const int numCookChannels = sizeof(cookStageChannels) / sizeof(cookStageChannels[0]);
+
+// memory pools (in the order of MemoryPool), mem_<pool>_mb for what each one holds and mem_<pool>_peak_mb for the most
+// it held, then mem_total_mb and mem_total_peak_mb. they follow the 13 stats channels after the cook channels.
+static const char* memoryPoolNames[] = { "scene", "mesh", "lods", "deform", "bvh", "filament", "prefetch" };
+static const int numMemoryChannels = NumMemoryPools * 2 + 2;
+static const int memoryChannelsStart = numCookChannels + 13;
+
+// cook timing percentiles after the memory channels, <stage>_p50_ms, _p95_ms, _p99_ms and _max_ms for every cook stage
+// in cookStageChannels, then stats_cooks (the number of cooks they're over).
+static const int latencyChannelsStart = memoryChannelsStart + numMemoryChannels;
+static const int numLatencyChannels = NumCookStages * kLatencyValues + 1;
+
+// number of fixed channels at the start of the Info CHOP, the query results and instance table follow them.
+static const int numFixedChannels = latencyChannelsStart + numLatencyChannels;
+
+// channels of the instance table in the Info CHOP, in the order of Mesh::Instance_Data.
+static const char* instanceChannels[] = { "tx", "ty", "tz", "rx", "ry", "rz", "sx", "sy", "sz", "meshid" };
+static const int numInstanceChannels = sizeof(instanceChannels) / sizeof(instanceChannels[0]);
+
+// channels of each query result in the Info CHOP.
+static const char* queryChannels[] = { "hit", "prim", "dist", "px", "py", "pz", "nx", "ny", "nz" };
+static const int numQueryChannels = sizeof(queryChannels) / sizeof(queryChannels[0]);
+
+int32_t
+TdAssimp::getNumInfoCHOPChans(void* reserved)
+{
+	// We return the number of channel we want to output to any Info CHOP
+	// connected to the CHOP. the cook timings, plus the overdraw stats, plus the name filter stats, plus the animation stats,
+	// plus memory, plus the query results, plus the instance table, plus the skin matrices, plus the morph weights, plus the
+	// import profile.
+	int numInstances = (int)myInstanceData.size() / numInstanceChannels;
+	return numFixedChannels + (int32_t)myQueryHits.size() * numQueryChannels + numInstances * numInstanceChannels
+		+ (int32_t)mySkinMatrices.size() + (int32_t)myMorphWeights.size() + (int32_t)myImportSteps.size();
+}
+
+void
+TdAssimp::getInfoCHOPChan(int32_t index,
+								OP_InfoCHOPChan* chan, void* reserved)
+{
+	// This function will be called once for each channel we said we'd want to return
+
+	// cook stage timings in milliseconds, then what the cook emitted.
+	if (index < numCookChannels)
+	{
+		chan->name->setString(cookStageChannels[index]);
+		float values[] = { (float)myEmittedVertices, (float)myEmittedTriangles, (float)myEmittedBytes };
+		chan->value = index < NumCookStages ? myStageMs[index] : values[index - NumCookStages];
+	}
+
+	if (index == numCookChannels + 0)
+	{
+		chan->name->setString("acmr_before");
+		chan->value = myAcmrBefore;
+	}
+
+	if (index == numCookChannels + 1)
+	{
+		chan->name->setString("acmr_after");
+		chan->value = myAcmrAfter;
+	}
+
+	if (index == numCookChannels + 2)
+	{
+		chan->name->setString("overdraw_before");
+		chan->value = myOverdrawBefore;
+	}
+
+	if (index == numCookChannels + 3)
+	{
+		chan->name->setString("overdraw_after");
+		chan->value = myOverdrawAfter;
+	}
+
+	if (index == numCookChannels + 4)
+	{
+		chan->name->setString("skipped_meshes");
+		chan->value = (float)myCache->mesh.numSkippedMeshes;
+	}
+
+	if (index == numCookChannels + 5)
+	{
+		chan->name->setString("skipped_vertices");
+		chan->value = (float)myCache->mesh.numSkippedVertices;
+	}
+
+	if (index == numCookChannels + 6)
+	{
+		chan->name->setString("anim_meshes_updated");
+		chan->value = (float)myAnimatedMeshes;
+	}
+
+	if (index == numCookChannels + 7)
+	{
+		chan->name->setString("anim_cursor_ch_per_ms");
+		chan->value = myBenchmarkCursor;
+	}
+
+	if (index == numCookChannels + 8)
+	{
+		chan->name->setString("anim_search_ch_per_ms");
+		chan->value = myBenchmarkSearch;
+	}
+
+	if (index == numCookChannels + 9)
+	{
+		chan->name->setString("sequence_positions_only");
+		chan->value = (float)mySequencePositionsOnly;
+	}
+
+	if (index == numCookChannels + 10)
+	{
+		chan->name->setString("prefetch_depth");
+		chan->value = (float)myPrefetchDepth;
+	}
+
+	if (index == numCookChannels + 11)
+	{
+		chan->name->setString("prefetch_misses");
+		chan->value = (float)myPrefetchMisses;
+	}
+
+	if (index == numCookChannels + 12)
+	{
+		chan->name->setString("decode_ms");
+		chan->value = mySequenceDecodeMs;
+	}
+
+	// memory in MB. the scene pool is the estimate of the last import, the total is what's held now, without the scene.
+	if (index >= memoryChannelsStart && index < latencyChannelsStart)
+	{
+		int channel = index - memoryChannelsStart;
+		int pool = channel / 2;
+		bool peak = channel % 2 == 1;
+
+		std::string name = pool < NumMemoryPools ? std::string("mem_") + memoryPoolNames[pool] : "mem_total";
+		name += peak ? "_peak_mb" : "_mb";
+		chan->name->setString(name.c_str());
+
+		size_t bytes = pool < NumMemoryPools ? (peak ? myMemoryPeak[pool] : myMemoryBytes[pool]) : (peak ? myMemoryPeakTotal : memory_held(myMemoryBytes));
+		chan->value = (float)(bytes / (1024.0 * 1024.0));
+	}
+
+	// cook timing percentiles, read_p50_ms, read_p95_ms ... cook_max_ms.
+	if (index >= latencyChannelsStart && index < numFixedChannels - 1)
+	{
+		int stage = (index - latencyChannelsStart) / kLatencyValues;
+		int value = (index - latencyChannelsStart) % kLatencyValues;
+
+		std::string name = cookStageChannels[stage];
+		name = name.substr(0, name.size() - 3) + latencyChannelSuffixes[value];
+		chan->name->setString(name.c_str());
+		chan->value = myCookStats->value(stage, value);
+	}
+
+	if (index == numFixedChannels - 1)
+	{
+		chan->name->setString("stats_cooks");
+		chan->value = (float)myCookStats->count();
+	}
+
+	int queryChannelsEnd = numFixedChannels + (int)myQueryHits.size() * numQueryChannels;
+
+	// query results, numQueryChannels per query.
+	if (index >= numFixedChannels && index < queryChannelsEnd)
+	{
+		int query = (index - numFixedChannels) / numQueryChannels;
+		int field = (index - numFixedChannels) % numQueryChannels;
+		const BvhHit& hit = myQueryHits[query];
+
+		std::string name = "query" + std::to_string(query) + "_" + queryChannels[field];
+		chan->name->setString(name.c_str());
+
+		float values[] = { hit.triangle != -1 ? 1.0f : 0.0f, (float)hit.triangle, hit.triangle != -1 ? hit.t : 0.0f,
+			hit.position[0], hit.position[1], hit.position[2], hit.normal[0], hit.normal[1], hit.normal[2] };
+		chan->value = values[field];
+	}
+
+	// instance table, all the tx channels first (tx0, tx1...), then all the ty channels and so on.
+	// a Shuffle CHOP set to Sequence Every N Channels (N = number of instances) turns it into one sample per instance.
+	int numInstances = (int)myInstanceData.size() / numInstanceChannels;
+	int instanceChannelsEnd = queryChannelsEnd + numInstances * numInstanceChannels;
+	if (index >= queryChannelsEnd && index < instanceChannelsEnd)
+	{
+		int field = (index - queryChannelsEnd) / numInstances;
+		int instance = (index - queryChannelsEnd) % numInstances;
+
+		std::string name = instanceChannels[field] + std::to_string(instance);
+		chan->name->setString(name.c_str());
+		chan->value = myInstanceData[instance * numInstanceChannels + field];
+	}
+
+	// skin matrices, same layout as the instance table: skin0_0, skin0_1 ... (element 0 of every joint), then skin1_0 ...
+	// elements are column major, so skin12_N - skin14_N is the translation of joint N.
+	int skinChannelsEnd = instanceChannelsEnd + (int)mySkinMatrices.size();
+	if (index >= instanceChannelsEnd && index < skinChannelsEnd)
+	{
+		int numJoints = (int)mySkinMatrices.size() / 16;
+		int field = (index - instanceChannelsEnd) / numJoints;
+		int joint = (index - instanceChannelsEnd) % numJoints;
+
+		std::string name = "skin" + std::to_string(field) + "_" + std::to_string(joint);
+		chan->name->setString(name.c_str());
+		chan->value = mySkinMatrices[joint * 16 + field];
+	}
+
+	// morph target weights, morph_<target name>.
+	int morphChannelsEnd = skinChannelsEnd + (int)myMorphWeights.size();
+	if (index >= skinChannelsEnd && index < morphChannelsEnd)
+	{
+		int target = index - skinChannelsEnd;
+
+		const std::vector<MorphTarget>& morphTargets = myCache->mesh.morphTargets;
+		std::string name = "morph_" + (target < (int)morphTargets.size() ? morphTargets[target].name : std::to_string(target));
+		chan->name->setString(name.c_str());
+		chan->value = myMorphWeights[target];
+	}
+
+	// assimp's timing of each step of the last profiled import, profile_<step>_ms in the order they ran.
+	// the read regions come first (profile_import_ms ...), profile_total_ms covers the read, not the post processing.
+	if (index >= morphChannelsEnd)
+	{
+		const ImportStep& step = myImportSteps[index - morphChannelsEnd];
+		std::string name = "profile_" + step.name + "_ms";
+		chan->name->setString(name.c_str());
+		chan->value = (float)step.ms;
+	}
+}
+
+// columns of the log in the Info DAT.
+static const char* logColumns[] = { "severity", "time", "message" };
+static const int numLogColumns = sizeof(logColumns) / sizeof(logColumns[0]);
+
+// columns of the import profile and of the post processing step ranking in the Info DAT.
+static const char* profileColumns[] = { "step", "ms" };
+static const int numProfileColumns = sizeof(profileColumns) / sizeof(profileColumns[0]);
+static const char* stepCostColumns[] = { "rank", "step", "parameter", "enabled", "cost_ms" };
+static const int numStepCostColumns = sizeof(stepCostColumns) / sizeof(stepCostColumns[0]);
+
+// columns of the quality report in the Info DAT.
+static const char* qualityColumns[] = { "metric", "value" };
+static const int numQualityColumns = sizeof(qualityColumns) / sizeof(qualityColumns[0]);
+
+// columns of the meshlet table in the Info DAT.
+static const char* meshletColumns[] = { "meshlet", "mesh", "triangle_offset", "triangles", "vertices",
+	"center_x", "center_y", "center_z", "radius", "cone_x", "cone_y", "cone_z", "cone_cutoff" };
+static const int numMeshletColumns = sizeof(meshletColumns) / sizeof(meshletColumns[0]);
+
+bool
+TdAssimp::getInfoDATSize(OP_InfoDATSize* infoSize, void* reserved)
+{
+	// the log first, a header row and one row per message. the import profile, the step ranking and the quality report
+	// follow, a header row and one row per step / metric, if there are any. if meshlets are on, they're last with a header row and one row per meshlet
+	// of the current LOD. the log is copied here, so the rows all come from the same messages.
+	myInfoLog = myLogRing->snapshot();
+	uint64_t overwritten = myLogRing->overwritten();
+	if (overwritten > 0) {
+		LogEntry dropped = { LogWarn, myInfoLog.empty() ? 0 : myInfoLog.front().timeMs, std::to_string(overwritten) + " older messages were dropped." };
+		myInfoLog.insert(myInfoLog.begin(), dropped);
+	}
+	int numLogRows = 1 + (int)myInfoLog.size();
+
+	int numMeshlets = 0;
+	if (myInfoLod < (int)myCache->lodMeshlets.size()) {
+		numMeshlets = (int)myCache->lodMeshlets[myInfoLod].size();
+	}
+
+	int numProfileRows = myImportSteps.empty() ? 0 : 1 + (int)myImportSteps.size();
+	int numStepCostRows = myStepCosts.empty() ? 0 : 1 + (int)myStepCosts.size();
+	int numQualityRows = myQualityRows.empty() ? 0 : 1 + (int)myQualityRows.size();
+
+	infoSize->rows = numLogRows + numProfileRows + numStepCostRows + numQualityRows + (numMeshlets > 0 ? 1 + numMeshlets : 0);
+	infoSize->cols = std::max(numLogColumns, numMeshlets > 0 ? numMeshletColumns : 0);
+	if (numStepCostRows > 0) {
+		infoSize->cols = std::max(infoSize->cols, numStepCostColumns);
+	}
+	// Setting this to false means we'll be assigning values to the table
+	// one row at a time. True means we'll do it one column at a time.
+	infoSize->byColumn = false;
+	return true;
+}
+
+void
+TdAssimp::getInfoDATEntries(int32_t index,
+								int32_t nEntries,
+								OP_InfoDATEntries* entries,
+								void* reserved)
+{
+	char tempBuffer[4096];
+	int numLogRows = 1 + (int)myInfoLog.size();
+	int profileEnd = numLogRows + (myImportSteps.empty() ? 0 : 1 + (int)myImportSteps.size());
+	int stepCostEnd = profileEnd + (myStepCosts.empty() ? 0 : 1 + (int)myStepCosts.size());
+	int qualityEnd = stepCostEnd + (myQualityRows.empty() ? 0 : 1 + (int)myQualityRows.size());
+
+	// log header.
+	if (index == 0)
+	{
+		for (int col = 0; col < numLogColumns && col < nEntries; col++) {
+			entries->values[col]->setString(logColumns[col]);
+		}
+	}
+
+	// one row per log message, oldest first. the message is set as is, however long it is.
+	if (index >= 1 && index < numLogRows)
+	{
+		const LogEntry& entry = myInfoLog[index - 1];
+		std::string time = log_time_string(entry.timeMs);
+		const char* values[] = { logSeverityNames[entry.severity], time.c_str(), entry.message.c_str() };
+		for (int col = 0; col < numLogColumns && col < nEntries; col++) {
+			entries->values[col]->setString(values[col]);
+		}
+	}
+
+	// import profile header, then one row per step of the last profiled import, in the order they ran.
+	if (index == numLogRows && profileEnd > numLogRows)
+	{
+		for (int col = 0; col < numProfileColumns && col < nEntries; col++) {
+			entries->values[col]->setString(profileColumns[col]);
+		}
+	}
+
+	if (index > numLogRows && index < profileEnd)
+	{
+		const ImportStep& step = myImportSteps[index - numLogRows - 1];
+#ifdef _WIN32
+		sprintf_s(tempBuffer, "%.3f", step.ms);
+#else // macOS
+		snprintf(tempBuffer, sizeof(tempBuffer), "%.3f", step.ms);
+#endif
+		const char* values[] = { step.name.c_str(), tempBuffer };
+		for (int col = 0; col < numProfileColumns && col < nEntries; col++) {
+			entries->values[col]->setString(values[col]);
+		}
+	}
+
+	// step ranking header, then one row per post processing step from Profile All Steps, most expensive first.
+	if (index == profileEnd && stepCostEnd > profileEnd)
+	{
+		for (int col = 0; col < numStepCostColumns && col < nEntries; col++) {
+			entries->values[col]->setString(stepCostColumns[col]);
+		}
+	}
+
+	if (index > profileEnd && index < stepCostEnd)
+	{
+		int rank = index - profileEnd - 1;
+		const StepCost& cost = myStepCosts[rank];
+#ifdef _WIN32
+		sprintf_s(tempBuffer, "%.3f", cost.costMs);
+#else // macOS
+		snprintf(tempBuffer, sizeof(tempBuffer), "%.3f", cost.costMs);
+#endif
+		std::string position = std::to_string(rank + 1);
+		const char* values[] = { position.c_str(), cost.name, cost.parameter ? cost.parameter : "", cost.enabled ? "1" : "0", tempBuffer };
+		for (int col = 0; col < numStepCostColumns && col < nEntries; col++) {
+			entries->values[col]->setString(values[col]);
+		}
+	}
+
+	// quality report header, then one row per metric.
+	if (index == stepCostEnd && qualityEnd > stepCostEnd)
+	{
+		for (int col = 0; col < numQualityColumns && col < nEntries; col++) {
+			entries->values[col]->setString(qualityColumns[col]);
+		}
+	}
+
+	if (index > stepCostEnd && index < qualityEnd)
+	{
+		const std::pair<std::string, std::string>& row = myQualityRows[index - stepCostEnd - 1];
+		const char* values[] = { row.first.c_str(), row.second.c_str() };
+		for (int col = 0; col < numQualityColumns && col < nEntries; col++) {
+			entries->values[col]->setString(values[col]);
+		}
+	}
+
+	// meshlet table header.
+	if (index == qualityEnd)
+	{
+		for (int col = 0; col < numMeshletColumns && col < nEntries; col++) {
+			entries->values[col]->setString(meshletColumns[col]);
+		}
+	}
+
+	// one row per meshlet of the LOD level that was last output.
+	if (index > qualityEnd && myInfoLod < (int)myCache->lodMeshlets.size())
+	{
+		const std::vector<Meshlet>& meshlets = myCache->lodMeshlets[myInfoLod];
+		int meshletIndex = index - qualityEnd - 1;
+		if (meshletIndex < (int)meshlets.size()) {
+			const Meshlet& m = meshlets[meshletIndex];
+			double values[] = { (double)meshletIndex, (double)m.meshId, (double)m.triangleOffset, (double)m.triangleCount, (double)m.vertexCount,
+				m.center[0], m.center[1], m.center[2], m.radius, m.coneAxis[0], m.coneAxis[1], m.coneAxis[2], m.coneCutoff };
+
+			for (int col = 0; col < numMeshletColumns && col < nEntries; col++) {
+#ifdef _WIN32
+				sprintf_s(tempBuffer, "%g", values[col]);
+#else // macOS
+				snprintf(tempBuffer, sizeof(tempBuffer), "%g", values[col]);
+#endif
+				entries->values[col]->setString(tempBuffer);
+			}
+		}
+	}
+
+	/*
+	if (index == 1)
+	{
+		// Set the value for the first column
+#ifdef _WIN32
+		strcpy_s(tempBuffer, "offset");
+#else // macOS
+		strlcpy(tempBuffer, "offset", sizeof(tempBuffer));
+#endif
+		entries->values[0]->setString(tempBuffer);
+
+		// Set the value for the second column
+#ifdef _WIN32
+		sprintf_s(tempBuffer, "%g", myOffset);
+#else // macOS
+		snprintf(tempBuffer, sizeof(tempBuffer), "%g", myOffset);
+#endif
+		entries->values[1]->setString(tempBuffer);
+	}
+
+	if (index == 2)
+	{
+		// Set the value for the first column
+#ifdef _WIN32
+		strcpy_s(tempBuffer, "DAT input name");
+#else // macOS
+		strlcpy(tempBuffer, "offset", sizeof(tempBuffer));
+#endif
+		entries->values[0]->setString(tempBuffer);
+
+		// Set the value for the second column
+#ifdef _WIN32
+		strcpy_s(tempBuffer, myDat.c_str());
 #else // macOS
-		snprintf(tempBuffer, sizeof(tempBuffer), myLog.c_str());
+		snprintf(tempBuffer, sizeof(tempBuffer), "%g", myOffset);
 #endif
-		//std::cout << myLog.c_str() << std::endl;
 		entries->values[1]->setString(tempBuffer);
 	}
+	*/
+}
+
+
+void
+TdAssimp::setupParameters(OP_ParameterManager* manager, void* reserved)
+{
+	
+	/////////////////////////////////// IMPORT PAGE /////////////////////////////////////////
+	// FILE
+	{
+		OP_StringParameter	p;
+
+		p.name = "File";
+		p.label = "3D File";
+		p.page = "Import";
+
+		OP_ParAppendResult res = manager->appendFile(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Reload - the import is cached between cooks, this forces it to be read from disk again.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Reload";
+		p.label = "Reload";
+		p.page = "Import";
+
+		OP_ParAppendResult res = manager->appendPulse(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Progressive - loads the file on a background thread, showing a subsampled preview first and the full mesh once it's done.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Progressive";
+		p.label = "Progressive";
+		p.page = "Import";
+		p.defaultValues[0] = false;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Progressive Preview Tris - max number of triangles in the preview.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Progressivepreviewtris";
+		p.label = "Preview Triangles";
+		p.page = "Import";
+		p.defaultValues[0] = 100000;
+		p.minSliders[0] = 1000;
+		p.maxSliders[0] = 1000000;
+		p.minValues[0] = 1;
+		p.clampMins[0] = true;
+
+		OP_ParAppendResult res = manager->appendInt(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Sequence - File is a frame numbered pattern (mesh.####.obj or mesh.0001.obj), Frame picks the file.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Sequence";
+		p.label = "Sequence";
+		p.page = "Import";
+		p.defaultValues[0] = false;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Frame - frame of the sequence, ie. me.time.frame.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Sequenceframe";
+		p.label = "Frame";
+		p.page = "Import";
+		p.defaultValues[0] = 1;
+		p.minSliders[0] = 0;
+		p.maxSliders[0] = 1000;
+
+		OP_ParAppendResult res = manager->appendInt(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Prefetch Frames - how many frames ahead of Frame are read on worker threads, 0 reads every frame when it's needed.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Prefetchframes";
+		p.label = "Prefetch Frames";
+		p.page = "Import";
+		p.defaultValues[0] = 4;
+		p.minSliders[0] = 0;
+		p.maxSliders[0] = 16;
+		p.minValues[0] = 0;
+		p.clampMins[0] = true;
+
+		OP_ParAppendResult res = manager->appendInt(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Prefetch Budget - memory the prefetched frames may use, in MB. at least one frame is always prefetched.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Prefetchbudget";
+		p.label = "Prefetch Budget (MB)";
+		p.page = "Import";
+		p.defaultValues[0] = 1024.0;
+		p.minSliders[0] = 0.0;
+		p.maxSliders[0] = 8192.0;
+		p.minValues[0] = 0.0;
+		p.clampMins[0] = true;
+
+		OP_ParAppendResult res = manager->appendFloat(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Memory Budget (MB) - most this sop may hold, 0 for no limit. over it, caches that are rebuilt on demand are dropped
+	// first, then the cook fails.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Memorybudget";
+		p.label = "Memory Budget (MB)";
+		p.page = "Import";
+		p.defaultValues[0] = 0.0;
+		p.minSliders[0] = 0.0;
+		p.maxSliders[0] = 65536.0;
+		p.minValues[0] = 0.0;
+		p.clampMins[0] = true;
+
+		OP_ParAppendResult res = manager->appendFloat(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Sequence Cache - file Write Cache bakes the sequence into, and Play Cache plays it from.
+	{
+		OP_StringParameter p;
+
+		p.name = "Cachefile";
+		p.label = "Sequence Cache";
+		p.page = "Import";
+
+		OP_ParAppendResult res = manager->appendFile(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Play Cache - the frames' positions and normals come from the sequence cache instead of the files.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Playcache";
+		p.label = "Play Cache";
+		p.page = "Import";
+		p.defaultValues[0] = false;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Cache Frame Range - first and last frame Write Cache bakes.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Cacherange";
+		p.label = "Cache Frame Range";
+		p.page = "Import";
+		p.defaultValues[0] = 1;
+		p.defaultValues[1] = 100;
+		p.minSliders[0] = 0;
+		p.maxSliders[0] = 1000;
+		p.minSliders[1] = 0;
+		p.maxSliders[1] = 1000;
+
+		OP_ParAppendResult res = manager->appendInt(p, 2);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Cache Keyframe Interval - every n-th frame is stored whole, so jumping to a frame decodes at most n frames.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Cachekeyframes";
+		p.label = "Cache Keyframe Interval";
+		p.page = "Import";
+		p.defaultValues[0] = 30;
+		p.minSliders[0] = 1;
+		p.maxSliders[0] = 120;
+		p.minValues[0] = 1;
+		p.clampMins[0] = true;
+
+		OP_ParAppendResult res = manager->appendInt(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Cache Position Bits - position precision, relative to the largest side of the first frame's bounding box.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Cachebits";
+		p.label = "Cache Position Bits";
+		p.page = "Import";
+		p.defaultValues[0] = 16;
+		p.minSliders[0] = 8;
+		p.maxSliders[0] = 24;
+		p.minValues[0] = 8;
+		p.maxValues[0] = 24;
+		p.clampMins[0] = true;
+		p.clampMaxes[0] = true;
+
+		OP_ParAppendResult res = manager->appendInt(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Write Cache - bakes the sequence into the cache file.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Writecache";
+		p.label = "Write Cache";
+		p.page = "Import";
+
+		OP_ParAppendResult res = manager->appendPulse(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Include Names - space separated glob patterns (* and ?), only meshes whose node or mesh name matches are converted.
+	{
+		OP_StringParameter p;
+
+		p.name = "Includenames";
+		p.label = "Include Names";
+		p.page = "Import";
+		p.defaultValue = "*";
+
+		OP_ParAppendResult res = manager->appendString(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Exclude Names - space separated glob patterns, meshes whose node or mesh name matches are skipped.
+	{
+		OP_StringParameter p;
+
+		p.name = "Excludenames";
+		p.label = "Exclude Names";
+		p.page = "Import";
+		p.defaultValue = "";
+
+		OP_ParAppendResult res = manager->appendString(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+
+	/////////////////////////////////// POST PROCESSING PAGE /////////////////////////////////////////
+	
+	///// leaving this commented out now, since we can assume user will always want tangents, if they aren't in the model lets calc them.
+	///// simplifies the whole array of parameters greatly into a situation where there are no parameter dependancy, thus less confusing.
+	/*
+
+		// Gen Normals - generates normals only for points that do not already have any.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Gennormals";
+		p.label = "Gen Normals (if missing)";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+
+	// Calc Tangent Space
+	{
+		OP_NumericParameter p;
+
+		p.name = "Calctangentspace";
+		p.label = "Calc Tangent Space";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
+
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+	*/
+
+	// Tangent Algorithm
+	{
+		OP_StringParameter p;
+		p.name = "Tangentalgorithm";
+		p.label = "Tangent Algorithm";
+		p.page = "Processing";
+		p.defaultValue = "Assimp";
+		std::array<const char*, 4> Names =
+		{
+			"Assimp",
+			"Mikktspace"
+		};
+		std::array<const char*, 4> Labels =
+		{
+			"Assimp",
+			"Mikktspace"
+		};
+		OP_ParAppendResult res = manager->appendMenu(p, int(Names.size()), Names.data(), Labels.data());
 
+		assert(res == OP_ParAppendResult::Success);
+	}
+	
+	///////// we are ditching these two parameters in favor of a more intuitive single parameter, called "Attribute Style" below. 
+	///////// realistically, there is no big benefit to users to have bitangents in a TD shading world, but it is relevant for filament.
+	///////// further more, bitangent in filament is not consumed directly, it's packed into a quat so we can reduce this to 1 switch.
 	/*
-	if (index == 1)
+	// Recalculatebitangent
 	{
-		// Set the value for the first column
-#ifdef _WIN32
-		strcpy_s(tempBuffer, "offset");
-#else // macOS
-		strlcpy(tempBuffer, "offset", sizeof(tempBuffer));
-#endif
-		entries->values[0]->setString(tempBuffer);
+		OP_NumericParameter p;
 
-		// Set the value for the second column
-#ifdef _WIN32
-		sprintf_s(tempBuffer, "%g", myOffset);
-#else // macOS
-		snprintf(tempBuffer, sizeof(tempBuffer), "%g", myOffset);
-#endif
-		entries->values[1]->setString(tempBuffer);
+		p.name = "Recalculatebitangent";
+		p.label = "Recalc Bitangent";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
+
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	//////////////
+	// TBN as Quat
+	//////////////
+	{
+		OP_NumericParameter p;
+
+		p.name = "Tbnasquat";
+		p.label = "TBN as Quaternion";
+		p.page = "Processing";
+		p.defaultValues[0] = false;
+
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+	*/
+
+	// Join Identical Vertices
+	{
+		OP_NumericParameter p;
+
+		p.name = "Joinidenticalvertices";
+		p.label = "Join Identical Vertices";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	/* since TD is openGL.. there shouldn't be a need for this ever, but leaving incase we find an edge case.
+	// Make Left Handed
+	{
+		OP_NumericParameter p;
+
+		p.name = "Makelefthanded";
+		p.label = "Make Left Handed";
+		p.page = "Processing";
+		p.defaultValues[0] = false;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+	*/
+
+	/* CURRENTLY DISABLED. c++ SOP can only create triangles, so this option is meaningless for now.
+	// Triangulate - since the c++ sop cannot create quads or ngons, this is probably going to need to be on. 
+	// However it can add cook time, so leaving it as a toggle incase user already has incoming mesh as triangles, and wants to save a bit of cook time.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Triangulate";
+		p.label = "Triangulate";
+		p.page = "Processing";
+		p.defaultValues[0] = false;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+	*/
+
+	/* leaving this commented out for now, because for use it requires additional flags to to be set to define which components are to be removed. TODO.
+	// Remove Componnet http://assimp.sourceforge.net/lib_html/postprocess_8h.html
+	{
+		OP_NumericParameter p;
+
+		p.name = "Removecomponent";
+		p.label = "Remove Component";
+		p.page = "Processing";
+		p.defaultValues[0] = false;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+	*/
+
+	/* requires a smoothing angle to be defined, also this cannot be used with the above Gen Normals, so leaving it disabled for now. TODO: http://assimp.sourceforge.net/lib_html/postprocess_8h.html
+	// Gen Smooth Normals
+	{
+		OP_NumericParameter p;
+
+		p.name = "Gensmoothnormals";
+		p.label = "Gen Smooth Normals";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+	*/
+
+	/* disabling this one for now, needs additional info supplied, and also what are good values for number of tris? does this mean anything since we get all our geo in our sop anyways?
+	// Split Large Meshes
+	{
+		OP_NumericParameter p;
+
+		p.name = "Splitlargemeshes";
+		p.label = "Split Large Meshes";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+	*/
+
+	/* seems uneecessary.. can in some rare cases cause problems: http://assimp.sourceforge.net/lib_html/postprocess_8h.html
+	// Pre Transform Vertices
+	{
+		OP_NumericParameter p;
+
+		p.name = "Pretransformvertices";
+		p.label = "Pre Transform Vertices";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+	*/
+
+	/* we'll eventually need this as an optimization probably when we support animated meshes. we're a ways off from that, so leaving this disabled.
+	// Limit Bone Weights
+	{
+		OP_NumericParameter p;
+
+		p.name = "Limitboneweights";
+		p.label = "Limit Bone Weights";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+	*/
+
+	
+	// Validate Data Structure
+	{
+		OP_NumericParameter p;
+
+		p.name = "Validatedatastructure";
+		p.label = "Validate Data Structure";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Improve Cache Locality
+	{
+		OP_NumericParameter p;
+
+		p.name = "Improvecachelocality";
+		p.label = "Improve Cache Locality";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	/* since we're not pulling material data from meshes loaded with assimp (yet?) we'll just leave this disabled for now.
+	// Remove Redundant Materials
+	{
+		OP_NumericParameter p;
+
+		p.name = "Removeredundantmaterials";
+		p.label = "Remove Redundant Materials";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
 	}
+	*/
 
-	if (index == 2)
+	// Fix Infacing Normals
 	{
-		// Set the value for the first column
-#ifdef _WIN32
-		strcpy_s(tempBuffer, "DAT input name");
-#else // macOS
-		strlcpy(tempBuffer, "offset", sizeof(tempBuffer));
-#endif
-		entries->values[0]->setString(tempBuffer);
+		OP_NumericParameter p;
 
-		// Set the value for the second column
-#ifdef _WIN32
-		strcpy_s(tempBuffer, myDat.c_str());
-#else // macOS
-		snprintf(tempBuffer, sizeof(tempBuffer), "%g", myOffset);
-#endif
-		entries->values[1]->setString(tempBuffer);
-	}
-	*/
-}
+		p.name = "Fixinfacingnormals";
+		p.label = "Fix Infacing Normals";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
 
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
 
-void
-TdAssimp::setupParameters(OP_ParameterManager* manager, void* reserved)
-{
-	
-	/////////////////////////////////// IMPORT PAGE /////////////////////////////////////////
-	// FILE
+	// Sort By PType
 	{
-		OP_StringParameter	p;
+		OP_NumericParameter p;
 
-		p.name = "File";
-		p.label = "3D File";
-		p.page = "Import";
+		p.name = "Sortbyptype";
+		p.label = "Sort By PType";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
 
-		OP_ParAppendResult res = manager->appendFile(p);
+		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
+	// Find Degenerates
+	{
+		OP_NumericParameter p;
+
+		p.name = "Finddegenerates";
+		p.label = "Find Degenerates";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
 
-	/////////////////////////////////// POST PROCESSING PAGE /////////////////////////////////////////
-	
-	///// leaving this commented out now, since we can assume user will always want tangents, if they aren't in the model lets calc them.
-	///// simplifies the whole array of parameters greatly into a situation where there are no parameter dependancy, thus less confusing.
-	/*
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
 
-		// Gen Normals - generates normals only for points that do not already have any.
+	// Find Invalid Data
 	{
 		OP_NumericParameter p;
 
-		p.name = "Gennormals";
-		p.label = "Gen Normals (if missing)";
+		p.name = "Findinvaliddata";
+		p.label = "Find Invalid Data";
 		p.page = "Processing";
 		p.defaultValues[0] = true;
 
@@ -978,85 +2736,94 @@ TdAssimp::setupParameters(OP_ParameterManager* manager, void* reserved)
 		assert(res == OP_ParAppendResult::Success);
 	}
 
+	// Gen UV Coords
+	{
+		OP_NumericParameter p;
 
-	// Calc Tangent Space
+		p.name = "Genuvcoords";
+		p.label = "Gen UV Coords";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Transform UV Coords
 	{
 		OP_NumericParameter p;
 
-		p.name = "Calctangentspace";
-		p.label = "Calc Tangent Space";
+		p.name = "Transformuvcoords";
+		p.label = "Transform UV Coords";
 		p.page = "Processing";
 		p.defaultValues[0] = true;
 
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	/* not currently needed since we do not have plans atm to have the imported sop generate instancing data.
+	// Find Instances
+	{
+		OP_NumericParameter p;
+
+		p.name = "Findfnstances";
+		p.label = "Find Instances";
+		p.page = "Processing";
+		p.defaultValues[0] = true;
 
 		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 	*/
 
-	// Tangent Algorithm
+	// Optimize Meshes
 	{
-		OP_StringParameter p;
-		p.name = "Tangentalgorithm";
-		p.label = "Tangent Algorithm";
+		OP_NumericParameter p;
+
+		p.name = "Optimizemeshes";
+		p.label = "Optimize Meshes";
 		p.page = "Processing";
-		p.defaultValue = "Assimp";
-		std::array<const char*, 4> Names =
-		{
-			"Assimp",
-			"Mikktspace"
-		};
-		std::array<const char*, 4> Labels =
-		{
-			"Assimp",
-			"Mikktspace"
-		};
-		OP_ParAppendResult res = manager->appendMenu(p, int(Names.size()), Names.data(), Labels.data());
+		p.defaultValues[0] = true;
 
+		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
-	
-	///////// we are ditching these two parameters in favor of a more intuitive single parameter, called "Attribute Style" below. 
-	///////// realistically, there is no big benefit to users to have bitangents in a TD shading world, but it is relevant for filament.
-	///////// further more, bitangent in filament is not consumed directly, it's packed into a quat so we can reduce this to 1 switch.
-	/*
-	// Recalculatebitangent
+
+	// Optimize Graph
 	{
 		OP_NumericParameter p;
 
-		p.name = "Recalculatebitangent";
-		p.label = "Recalc Bitangent";
+		p.name = "Optimizegraph";
+		p.label = "Optimize Graph";
 		p.page = "Processing";
 		p.defaultValues[0] = true;
 
-
 		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
-	//////////////
-	// TBN as Quat
-	//////////////
+	/* this will likely never be desired, since TD is open GL.. 
+	// Flip UVs
 	{
 		OP_NumericParameter p;
 
-		p.name = "Tbnasquat";
-		p.label = "TBN as Quaternion";
+		p.name = "Flipuvs";
+		p.label = "Flip UVs";
 		p.page = "Processing";
 		p.defaultValues[0] = false;
 
-
 		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 	*/
 
-	// Join Identical Vertices
+	// Flip Winding Order
 	{
 		OP_NumericParameter p;
 
-		p.name = "Joinidenticalvertices";
-		p.label = "Join Identical Vertices";
+		p.name = "Flipwindingorder";
+		p.label = "Flip Winding Order";
 		p.page = "Processing";
 		p.defaultValues[0] = true;
 
@@ -1064,380 +2831,523 @@ TdAssimp::setupParameters(OP_ParameterManager* manager, void* reserved)
 		assert(res == OP_ParAppendResult::Success);
 	}
 
-	/* since TD is openGL.. there shouldn't be a need for this ever, but leaving incase we find an edge case.
-	// Make Left Handed
+	/* revisit this when bones/skinning is implemented.
+	// Split By Bone Count
 	{
 		OP_NumericParameter p;
 
-		p.name = "Makelefthanded";
-		p.label = "Make Left Handed";
+		p.name = "Splitbybonecount";
+		p.label = "Split By Bone Count";
 		p.page = "Processing";
-		p.defaultValues[0] = false;
+		p.defaultValues[0] = true;
 
 		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 	*/
 
-	/* CURRENTLY DISABLED. c++ SOP can only create triangles, so this option is meaningless for now.
-	// Triangulate - since the c++ sop cannot create quads or ngons, this is probably going to need to be on. 
-	// However it can add cook time, so leaving it as a toggle incase user already has incoming mesh as triangles, and wants to save a bit of cook time.
+	/* revisit this when bones / skinning is implemented.
+	// Debone
 	{
 		OP_NumericParameter p;
 
-		p.name = "Triangulate";
-		p.label = "Triangulate";
+		p.name = "Debone";
+		p.label = "Debone";
 		p.page = "Processing";
+		p.defaultValues[0] = true;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+	*/
+
+	// Output Attributes Style
+	{
+		OP_StringParameter p;
+		p.name = "Attributestyle";
+		p.label = "Attribute Style";
+		p.page = "Sop Output";
+		p.defaultValue = "Touchdesigner";
+		std::array<const char*, 4> Names =
+		{
+			"Touchdesigner",
+			"Filament"
+		};
+		std::array<const char*, 4> Labels =
+		{
+			"TouchDesigner",
+			"Filament"
+		};
+		OP_ParAppendResult res = manager->appendMenu(p, int(Names.size()), Names.data(), Labels.data());
+
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter p;
+		p.name = "Vertexcolortint";
+		p.label = "Vertex Color Tint";
+		p.page = "Sop Output";
+
+		const int ArraySize = 4;
+
+		const std::array<double, ArraySize>  DefaultValues = { 1.0, 1.0, 1.0, 1.0 };
+		const std::array<double, ArraySize>  MinSliders = { 0.0, 0.0, 0.0, 0.0 };
+		const std::array<double, ArraySize>  MaxSliders = { 1.0, 1.0, 1.0, 1.0 };
+		const std::array<double, ArraySize>  MinValues = { 0.0, 0.0, 0.0, 0.0 };
+		const std::array<double, ArraySize>  MaxValues = { 1.0, 1.0, 1.0, 1.0 };
+		const std::array<bool, ArraySize>  ClampMins = { true, true, true, true };
+		const std::array<bool, ArraySize>  ClampMaxes = { true, true, true, true };
+		for (int i = 0; i < DefaultValues.size(); ++i)
+		{
+			p.defaultValues[i] = DefaultValues[i];
+			p.minSliders[i] = MinSliders[i];
+			p.maxSliders[i] = MaxSliders[i];
+			p.minValues[i] = MinValues[i];
+			p.maxValues[i] = MaxValues[i];
+			p.clampMins[i] = ClampMins[i];
+			p.clampMaxes[i] = ClampMaxes[i];
+		}
+		OP_ParAppendResult res = manager->appendRGBA(p);
+
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Instanced Output - outputs every unique mesh once, and puts the transform of every node that uses it in the info CHOP.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Instancedoutput";
+		p.label = "Instanced Output";
+		p.page = "Sop Output";
 		p.defaultValues[0] = false;
 
-		OP_ParAppendResult res = manager->appendToggle(p);
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Primitive Groups - one primitive group per node or per mesh, named after it.
+	{
+		OP_StringParameter p;
+		p.name = "Primitivegroups";
+		p.label = "Primitive Groups";
+		p.page = "Sop Output";
+		p.defaultValue = "None";
+		std::array<const char*, 3> Names =
+		{
+			"None",
+			"Bynode",
+			"Bymesh"
+		};
+		std::array<const char*, 3> Labels =
+		{
+			"None",
+			"By Node",
+			"By Mesh"
+		};
+		OP_ParAppendResult res = manager->appendMenu(p, int(Names.size()), Names.data(), Labels.data());
+
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Skinning - Attributes outputs jointindex / jointweight and the skin matrices for GPU skinning, CPU deforms the mesh here.
+	{
+		OP_StringParameter p;
+		p.name = "Skinning";
+		p.label = "Skinning";
+		p.page = "Sop Output";
+		p.defaultValue = "Off";
+		std::array<const char*, 3> Names =
+		{
+			"Off",
+			"Attributes",
+			"Cpu"
+		};
+		std::array<const char*, 3> Labels =
+		{
+			"Off",
+			"Attributes",
+			"CPU"
+		};
+		OP_ParAppendResult res = manager->appendMenu(p, int(Names.size()), Names.data(), Labels.data());
+
 		assert(res == OP_ParAppendResult::Success);
 	}
-	*/
 
-	/* leaving this commented out for now, because for use it requires additional flags to to be set to define which components are to be removed. TODO.
-	// Remove Componnet http://assimp.sourceforge.net/lib_html/postprocess_8h.html
+	// Mesh ID Attribute - source mesh index as a meshid int point attribute.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Removecomponent";
-		p.label = "Remove Component";
-		p.page = "Processing";
+		p.name = "Meshidattribute";
+		p.label = "Mesh ID Attribute";
+		p.page = "Sop Output";
 		p.defaultValues[0] = false;
 
 		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
-	*/
 
-	/* requires a smoothing angle to be defined, also this cannot be used with the above Gen Normals, so leaving it disabled for now. TODO: http://assimp.sourceforge.net/lib_html/postprocess_8h.html
-	// Gen Smooth Normals
+	/////////////////////////////////// OPTIMIZE PAGE /////////////////////////////////////////
+	// Overdraw Ordering
 	{
 		OP_NumericParameter p;
 
-		p.name = "Gensmoothnormals";
-		p.label = "Gen Smooth Normals";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Overdrawordering";
+		p.label = "Overdraw Ordering";
+		p.page = "Optimize";
+		p.defaultValues[0] = false;
 
 		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
-	*/
 
-	/* disabling this one for now, needs additional info supplied, and also what are good values for number of tris? does this mean anything since we get all our geo in our sop anyways?
-	// Split Large Meshes
+	// Overdraw Threshold - the ACMR tolerance, 1.05 lets the vertex cache efficiency get 5% worse in exchange for less overdraw.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Splitlargemeshes";
-		p.label = "Split Large Meshes";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Overdrawthreshold";
+		p.label = "Overdraw ACMR Tolerance";
+		p.page = "Optimize";
+		p.defaultValues[0] = 1.05;
+		p.minSliders[0] = 1.0;
+		p.maxSliders[0] = 3.0;
+		p.minValues[0] = 1.0;
+		p.clampMins[0] = true;
 
-		OP_ParAppendResult res = manager->appendToggle(p);
+		OP_ParAppendResult res = manager->appendFloat(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
-	*/
 
-	/* seems uneecessary.. can in some rare cases cause problems: http://assimp.sourceforge.net/lib_html/postprocess_8h.html
-	// Pre Transform Vertices
+	// Overdraw Stats - rasterizes the mesh on the cpu before and after ordering, can be slow on huge meshes so it's optional.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Pretransformvertices";
-		p.label = "Pre Transform Vertices";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Overdrawstats";
+		p.label = "Overdraw Stats";
+		p.page = "Optimize";
+		p.defaultValues[0] = false;
 
 		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
-	*/
 
-	/* we'll eventually need this as an optimization probably when we support animated meshes. we're a ways off from that, so leaving this disabled.
-	// Limit Bone Weights
+	// Quality Report - acmr / atvr, vertex reuse, duplicates, degenerates, bounds, bytes per vertex and overdraw of the
+	// output in the info DAT. only redone when the output changes.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Limitboneweights";
-		p.label = "Limit Bone Weights";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Qualityreport";
+		p.label = "Quality Report";
+		p.page = "Optimize";
+		p.defaultValues[0] = false;
 
 		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
-	*/
 
-	
-	// Validate Data Structure
+	// Quality Cache Size - entries of the fifo vertex cache the quality report simulates for acmr / atvr.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Validatedatastructure";
-		p.label = "Validate Data Structure";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Qualitycachesize";
+		p.label = "Quality Cache Size";
+		p.page = "Optimize";
+		p.defaultValues[0] = kOverdrawCacheSize;
+		p.minSliders[0] = 4;
+		p.maxSliders[0] = 64;
+		p.minValues[0] = 1;
+		p.clampMins[0] = true;
 
-		OP_ParAppendResult res = manager->appendToggle(p);
+		OP_ParAppendResult res = manager->appendInt(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
-	// Improve Cache Locality
+	// Lod Levels - number of LOD levels to generate, 1 means just the full resolution mesh.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Improvecachelocality";
-		p.label = "Improve Cache Locality";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Lodlevels";
+		p.label = "LOD Levels";
+		p.page = "Optimize";
+		p.defaultValues[0] = 1;
+		p.minSliders[0] = 1;
+		p.maxSliders[0] = 8;
+		p.minValues[0] = 1;
+		p.clampMins[0] = true;
 
-		OP_ParAppendResult res = manager->appendToggle(p);
+		OP_ParAppendResult res = manager->appendInt(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
-	/* since we're not pulling material data from meshes loaded with assimp (yet?) we'll just leave this disabled for now.
-	// Remove Redundant Materials
+	// Lod Ratio - each LOD level keeps this fraction of the triangles of the level before it.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Removeredundantmaterials";
-		p.label = "Remove Redundant Materials";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
-
-		OP_ParAppendResult res = manager->appendToggle(p);
+		p.name = "Lodratio";
+		p.label = "LOD Ratio";
+		p.page = "Optimize";
+		p.defaultValues[0] = 0.5;
+		p.minSliders[0] = 0.0;
+		p.maxSliders[0] = 1.0;
+		p.minValues[0] = 0.0;
+		p.maxValues[0] = 1.0;
+		p.clampMins[0] = true;
+		p.clampMaxes[0] = true;
+
+		OP_ParAppendResult res = manager->appendFloat(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
-	*/
 
-	// Fix Infacing Normals
+	// Lod Normal Weight - how much the simplifier avoids collapsing across normal changes.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Fixinfacingnormals";
-		p.label = "Fix Infacing Normals";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Lodnormalweight";
+		p.label = "LOD Normal Weight";
+		p.page = "Optimize";
+		p.defaultValues[0] = 1.0;
+		p.minSliders[0] = 0.0;
+		p.maxSliders[0] = 10.0;
+		p.minValues[0] = 0.0;
+		p.clampMins[0] = true;
 
-		OP_ParAppendResult res = manager->appendToggle(p);
+		OP_ParAppendResult res = manager->appendFloat(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
-	// Sort By PType
+	// Lod UV Weight - how much the simplifier avoids collapsing across uv changes.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Sortbyptype";
-		p.label = "Sort By PType";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Loduvweight";
+		p.label = "LOD UV Weight";
+		p.page = "Optimize";
+		p.defaultValues[0] = 1.0;
+		p.minSliders[0] = 0.0;
+		p.maxSliders[0] = 10.0;
+		p.minValues[0] = 0.0;
+		p.clampMins[0] = true;
 
-		OP_ParAppendResult res = manager->appendToggle(p);
+		OP_ParAppendResult res = manager->appendFloat(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
-	// Find Degenerates
+	// Lod - which of the cached LOD levels to output, switching this does not re-import.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Finddegenerates";
-		p.label = "Find Degenerates";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Lod";
+		p.label = "LOD";
+		p.page = "Optimize";
+		p.defaultValues[0] = 0;
+		p.minSliders[0] = 0;
+		p.maxSliders[0] = 7;
+		p.minValues[0] = 0;
+		p.clampMins[0] = true;
 
-		OP_ParAppendResult res = manager->appendToggle(p);
+		OP_ParAppendResult res = manager->appendInt(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
-	// Find Invalid Data
+	// Meshlets - split every LOD level into meshlets, adds a clusterid point attribute and lists the meshlet bounds in the Info DAT.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Findinvaliddata";
-		p.label = "Find Invalid Data";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Meshlets";
+		p.label = "Meshlets";
+		p.page = "Optimize";
+		p.defaultValues[0] = false;
 
 		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
-	// Gen UV Coords
+	// Meshlet Max Verts - vertex limit per meshlet, 64 is a good fit for mesh shaders.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Genuvcoords";
-		p.label = "Gen UV Coords";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Meshletmaxverts";
+		p.label = "Meshlet Max Verts";
+		p.page = "Optimize";
+		p.defaultValues[0] = 64;
+		p.minSliders[0] = 3;
+		p.maxSliders[0] = 256;
+		p.minValues[0] = 3;
+		p.clampMins[0] = true;
 
-		OP_ParAppendResult res = manager->appendToggle(p);
+		OP_ParAppendResult res = manager->appendInt(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
-	// Transform UV Coords
+	// Meshlet Max Tris - triangle limit per meshlet.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Transformuvcoords";
-		p.label = "Transform UV Coords";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Meshletmaxtris";
+		p.label = "Meshlet Max Tris";
+		p.page = "Optimize";
+		p.defaultValues[0] = 124;
+		p.minSliders[0] = 1;
+		p.maxSliders[0] = 512;
+		p.minValues[0] = 1;
+		p.clampMins[0] = true;
 
-		OP_ParAppendResult res = manager->appendToggle(p);
+		OP_ParAppendResult res = manager->appendInt(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
-	/* not currently needed since we do not have plans atm to have the imported sop generate instancing data.
-	// Find Instances
+	/////////////////////////////////// ANIMATION PAGE /////////////////////////////////////////
+	// Play Animation - samples the file's node animation at Time, drives skinning, node transforms and the instance table.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Findfnstances";
-		p.label = "Find Instances";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Playanimation";
+		p.label = "Play Animation";
+		p.page = "Animation";
+		p.defaultValues[0] = false;
 
 		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
-	*/
 
-	// Optimize Meshes
+	// Clip - which of the file's animations to play.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Optimizemeshes";
-		p.label = "Optimize Meshes";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Animationclip";
+		p.label = "Clip";
+		p.page = "Animation";
+		p.defaultValues[0] = 0;
+		p.minSliders[0] = 0;
+		p.maxSliders[0] = 10;
+		p.minValues[0] = 0;
+		p.clampMins[0] = true;
 
-		OP_ParAppendResult res = manager->appendToggle(p);
+		OP_ParAppendResult res = manager->appendInt(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
-	// Optimize Graph
+	// Time - in seconds, ie. an absTime.seconds expression for realtime playback.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Optimizegraph";
-		p.label = "Optimize Graph";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Animationtime";
+		p.label = "Time";
+		p.page = "Animation";
+		p.defaultValues[0] = 0.0;
+		p.minSliders[0] = 0.0;
+		p.maxSliders[0] = 10.0;
 
-		OP_ParAppendResult res = manager->appendToggle(p);
+		OP_ParAppendResult res = manager->appendFloat(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
-	/* this will likely never be desired, since TD is open GL.. 
-	// Flip UVs
+	// Loop - wraps Time around the clip length, otherwise it holds the first / last frame.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Flipuvs";
-		p.label = "Flip UVs";
-		p.page = "Processing";
-		p.defaultValues[0] = false;
+		p.name = "Animationloop";
+		p.label = "Loop";
+		p.page = "Animation";
+		p.defaultValues[0] = true;
 
 		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
-	*/
 
-	// Flip Winding Order
+	// Benchmark Sampler - measures the sampling throughput of the clip, results go to the info CHOP and the log.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Flipwindingorder";
-		p.label = "Flip Winding Order";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Benchmarkanimation";
+		p.label = "Benchmark Sampler";
+		p.page = "Animation";
 
-		OP_ParAppendResult res = manager->appendToggle(p);
+		OP_ParAppendResult res = manager->appendPulse(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
-	/* revisit this when bones/skinning is implemented.
-	// Split By Bone Count
+	// Morph CHOP - morph target weights, one channel per target named like it (or in target order), first sample.
 	{
-		OP_NumericParameter p;
+		OP_StringParameter p;
 
-		p.name = "Splitbybonecount";
-		p.label = "Split By Bone Count";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Morphchop";
+		p.label = "Morph CHOP";
+		p.page = "Animation";
 
-		OP_ParAppendResult res = manager->appendToggle(p);
+		OP_ParAppendResult res = manager->appendCHOP(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
-	*/
 
-	/* revisit this when bones / skinning is implemented.
-	// Debone
+	/////////////////////////////////// QUERY PAGE /////////////////////////////////////////
+	// Build BVH - builds a bvh over the output triangles, for fast ray and closest point queries.
 	{
 		OP_NumericParameter p;
 
-		p.name = "Debone";
-		p.label = "Debone";
-		p.page = "Processing";
-		p.defaultValues[0] = true;
+		p.name = "Buildbvh";
+		p.label = "Build BVH";
+		p.page = "Query";
+		p.defaultValues[0] = false;
 
 		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
-	*/
 
-	// Output Attributes Style
+	// Query Mode - what each sample of the Query CHOP is.
 	{
 		OP_StringParameter p;
-		p.name = "Attributestyle";
-		p.label = "Attribute Style";
-		p.page = "Sop Output";
-		p.defaultValue = "Touchdesigner";
-		std::array<const char*, 4> Names =
+		p.name = "Querymode";
+		p.label = "Query Mode";
+		p.page = "Query";
+		p.defaultValue = "Ray";
+		std::array<const char*, 2> Names =
 		{
-			"Touchdesigner",
-			"Filament"
+			"Ray",
+			"Closestpoint"
 		};
-		std::array<const char*, 4> Labels =
+		std::array<const char*, 2> Labels =
 		{
-			"TouchDesigner",
-			"Filament"
+			"Ray (origin xyz, direction xyz)",
+			"Closest Point (xyz)"
 		};
 		OP_ParAppendResult res = manager->appendMenu(p, int(Names.size()), Names.data(), Labels.data());
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Query CHOP - one query per sample, results go to the info CHOP.
+	{
+		OP_StringParameter p;
+
+		p.name = "Querychop";
+		p.label = "Query CHOP";
+		p.page = "Query";
 
+		OP_ParAppendResult res = manager->appendCHOP(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
+	// Query - runs the queries once.
 	{
 		OP_NumericParameter p;
-		p.name = "Vertexcolortint";
-		p.label = "Vertex Color Tint";
-		p.page = "Sop Output";
 
-		const int ArraySize = 4;
+		p.name = "Query";
+		p.label = "Query";
+		p.page = "Query";
 
-		const std::array<double, ArraySize>  DefaultValues = { 1.0, 1.0, 1.0, 1.0 };
-		const std::array<double, ArraySize>  MinSliders = { 0.0, 0.0, 0.0, 0.0 };
-		const std::array<double, ArraySize>  MaxSliders = { 1.0, 1.0, 1.0, 1.0 };
-		const std::array<double, ArraySize>  MinValues = { 0.0, 0.0, 0.0, 0.0 };
-		const std::array<double, ArraySize>  MaxValues = { 1.0, 1.0, 1.0, 1.0 };
-		const std::array<bool, ArraySize>  ClampMins = { true, true, true, true };
-		const std::array<bool, ArraySize>  ClampMaxes = { true, true, true, true };
-		for (int i = 0; i < DefaultValues.size(); ++i)
-		{
-			p.defaultValues[i] = DefaultValues[i];
-			p.minSliders[i] = MinSliders[i];
-			p.maxSliders[i] = MaxSliders[i];
-			p.minValues[i] = MinValues[i];
-			p.maxValues[i] = MaxValues[i];
-			p.clampMins[i] = ClampMins[i];
-			p.clampMaxes[i] = ClampMaxes[i];
-		}
-		OP_ParAppendResult res = manager->appendRGBA(p);
+		OP_ParAppendResult res = manager->appendPulse(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Query Every Cook - runs the queries every time the sop cooks, ie. whenever the Query CHOP changes.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Queryeverycook";
+		p.label = "Query Every Cook";
+		p.page = "Query";
+		p.defaultValues[0] = false;
 
+		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
 
@@ -1493,7 +3403,57 @@ TdAssimp::setupParameters(OP_ParameterManager* manager, void* reserved)
 		OP_ParAppendResult res = manager->appendToggle(p);
 		assert(res == OP_ParAppendResult::Success);
 	}
-	
+
+	// Trace File - chrome trace (chrome://tracing, ui.perfetto.dev) of every cook and the background work, off when empty.
+	{
+		OP_StringParameter p;
+
+		p.name = "Tracefile";
+		p.label = "Trace File";
+		p.page = "Logging";
+
+		OP_ParAppendResult res = manager->appendFile(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Reset Stats - starts the cook timing percentiles (the _p50_ms ... _max_ms channels of the info CHOP) over.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Resetstats";
+		p.label = "Reset Stats";
+		p.page = "Logging";
+
+		OP_ParAppendResult res = manager->appendPulse(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Profile Import - assimp times every step of the import (AI_CONFIG_GLOB_MEASURE_TIME), profile_<step>_ms in the info CHOP.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Profileimport";
+		p.label = "Profile Import";
+		p.page = "Logging";
+		p.defaultValues[0] = false;
+
+		OP_ParAppendResult res = manager->appendToggle(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Profile All Steps - re-imports the file with each post processing step toggled and ranks the steps by cost in the info DAT.
+	// blocks the cook for a while, about 2 x 17 imports of the file.
+	{
+		OP_NumericParameter p;
+
+		p.name = "Profilesteps";
+		p.label = "Profile All Steps";
+		p.page = "Logging";
+
+		OP_ParAppendResult res = manager->appendPulse(p);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
 	/*
 	// CHOP
 	{
@@ -1561,8 +3521,6 @@ TdAssimp::setupParameters(OP_ParameterManager* manager, void* reserved)
 
 	*/
 
-	Assimp::DefaultLogger::kill();
-
 }
 
 void
@@ -1572,5 +3530,43 @@ TdAssimp::pulsePressed(const char* name, void* reserved)
 	{
 		myOffset = 0.0;
 	}
+
+	if (!strcmp(name, "Reload"))
+	{
+		myCache->clear();
+		myLoader->cancel();
+		myPrefetcher->stop();
+		myCacheReader->close();
+
+		// tries a refused file again, and starts the peaks over.
+		myMemoryRefusedKey.clear();
+		std::fill(myMemoryPeak, myMemoryPeak + NumMemoryPools, 0);
+		myMemoryPeakTotal = 0;
+	}
+
+	if (!strcmp(name, "Writecache"))
+	{
+		myWriteCachePending = true;
+	}
+
+	if (!strcmp(name, "Query"))
+	{
+		myQueryPending = true;
+	}
+
+	if (!strcmp(name, "Benchmarkanimation"))
+	{
+		myBenchmarkPending = true;
+	}
+
+	if (!strcmp(name, "Profilesteps"))
+	{
+		myProfileStepsPending = true;
+	}
+
+	if (!strcmp(name, "Resetstats"))
+	{
+		myCookStats->reset();
+	}
 }
 
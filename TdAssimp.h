@@ -26,6 +26,50 @@
 #include "SOP_CPlusPlusBase.h"
 #include "DataAndTypes.h"
 
+// defined in Mesh_Cache.h, holds the flattened mesh and LOD levels between cooks.
+class MeshCache;
+
+// defined in DataAndTypes.h, the buffers the filament attributes are expanded into.
+struct FilamentScratch;
+
+// defined in Mesh_Progressive.h, loads the file on a background thread in progressive mode.
+class ProgressiveLoader;
+
+// defined in Mesh_Sequence.h, reads the next frames of a sequence on worker threads.
+class SequencePrefetcher;
+
+// defined in Mesh_SequenceCache.h, plays back a sequence cache file.
+class SequenceCacheReader;
+
+// defined in LogRing.h, the last assimp messages of this sop.
+class LogRing;
+struct LogEntry;
+
+// defined in ImportProfile.h, assimp's timing of an import step, and what a post processing step costs.
+struct ImportStep;
+struct StepCost;
+
+// defined in CookStats.h, histograms of the cook stage timings.
+class CookStats;
+
+// defined in Trace.h, the trace file this sop writes to.
+class TraceRegistration;
+
+// defined in Mesh_Bvh.h, result of a single ray / closest point query.
+struct BvhHit;
+
+// stages of a cook, timed for the info CHOP (see cookStageChannels in TdAssimp.cpp).
+enum CookStage {
+	StageRead, StagePostProcess, StageFlatten, StageTangents, StageTbnQuat, StageLod, StageDeform,
+	StageAttributes, StageOutput, StageCook, NumCookStages
+};
+
+// what the memory a sop holds is for, reported in the info CHOP (see memoryChannels in TdAssimp.cpp) and counted
+// against the Memory Budget. MemoryScene is the aiScene of the last import, MemoryPrefetch the frames read ahead of time.
+enum MemoryPool {
+	MemoryScene, MemoryMesh, MemoryLods, MemoryDeform, MemoryBvh, MemoryFilament, MemoryPrefetch, NumMemoryPools
+};
+
 // To get more help about these functions, look at SOP_CPlusPlusBase.h
 class TdAssimp : public SOP_CPlusPlusBase
 {
@@ -94,4 +138,105 @@ private:
 	std::string             myDat;
 
 	int						myNumVBOTexLayers;
+
+	// overdraw ordering stats, measured before and after the reorder. only updated when Overdrawstats is on.
+	float					myAcmrBefore;
+	float					myAcmrAfter;
+	float					myOverdrawBefore;
+	float					myOverdrawAfter;
+
+	// LOD level that was last output, the Info DAT lists the meshlets of this level.
+	int						myInfoLod;
+
+	// results of the last ray / closest point query against the bvh, one per sample of the Query CHOP.
+	std::vector<BvhHit>		myQueryHits;
+
+	// skin matrix (16 floats, column major) per joint of the last output pose, only with Skinning set to Attributes.
+	std::vector<float>		mySkinMatrices;
+
+	// morph target weights of the last cook, in the order of Mesh::morphTargets.
+	std::vector<float>		myMorphWeights;
+
+	// instance table of the last cook, Mesh::Instance_Data with the animated node transforms applied.
+	std::vector<float>		myInstanceData;
+
+	// true while an animation is playing, so the sop cooks every frame.
+	bool					myAnimating;
+
+	// source meshes re-transformed by the last cook's node animation.
+	int						myAnimatedMeshes;
+
+	// true if the last cook read a sequence frame with unchanged topology, and only replaced the positions and normals.
+	bool					mySequencePositionsOnly;
+
+	// sequence prefetching: last frame and its playback direction, frames ready ahead, frames that weren't ready when
+	// a cook needed them, and how long the last frame took to read and flatten.
+	int						mySequenceFrame;
+	int						mySequenceDirection;
+	int						myPrefetchDepth;
+	int						myPrefetchMisses;
+	float					mySequenceDecodeMs;
+
+	// how long each stage of the last cook took in milliseconds (indexed by CookStage), and what it handed to the sop.
+	float					myStageMs[NumCookStages];
+	int						myEmittedVertices;
+	int						myEmittedTriangles;
+	size_t					myEmittedBytes;
+
+	// p50 / p95 / p99 / max of the stage timings over the last cooks, cleared by the Reset Stats pulse.
+	CookStats*				myCookStats;
+
+	// this sop's Trace File, the file stays open while any sop uses it.
+	TraceRegistration*		myTrace;
+
+	// set by the Write Cache pulse, so the next cook bakes the sequence cache.
+	bool					myWriteCachePending;
+
+	// set by the Benchmark Sampler pulse, and the results in channels per millisecond.
+	bool					myBenchmarkPending;
+	float					myBenchmarkCursor;
+	float					myBenchmarkSearch;
+
+	// set by the Profile All Steps pulse, so the next cook ranks the post processing steps by cost (myStepCosts).
+	// myImportSteps are the per step timings of the last import made with Profile Import on.
+	bool					myProfileStepsPending;
+	std::vector<StepCost>	myStepCosts;
+	std::vector<ImportStep>	myImportSteps;
+
+	// set by the Query pulse, so the next cook runs the queries.
+	bool					myQueryPending;
+
+	// import / flatten / LOD results, reused for as long as the parameters that produced them don't change.
+	MeshCache*				myCache;
+
+	// this sop's filament attribute buffers, counted in its filament memory pool.
+	FilamentScratch*		myFilamentScratch;
+
+	// background import for the Progressive mode.
+	ProgressiveLoader*		myLoader;
+
+	// background import of the next frames in Sequence mode.
+	SequencePrefetcher*		myPrefetcher;
+
+	// sequence cache being played in Sequence mode.
+	SequenceCacheReader*	myCacheReader;
+
+	// the Quality Report as metric / value rows for the info DAT, and the key of the output it was made for.
+	std::vector<std::pair<std::string, std::string>>	myQualityRows;
+	std::string				myQualityKey;
+
+	// bytes held per MemoryPool as of the end of the last cook, the most each pool held since the last Reload, and the
+	// most held in total (the scene included while it was alive).
+	size_t					myMemoryBytes[NumMemoryPools];
+	size_t					myMemoryPeak[NumMemoryPools];
+	size_t					myMemoryPeakTotal;
+
+	// import settings a cook was refused for because they don't fit the Memory Budget, and why, so they aren't imported
+	// again every cook. empty if nothing was refused.
+	std::string				myMemoryRefusedKey;
+	std::string				myMemoryRefusedError;
+
+	// assimp messages of this sop's imports, and the copy the Info DAT rows are read from (taken in getInfoDATSize).
+	LogRing*				myLogRing;
+	std::vector<LogEntry>	myInfoLog;
 };
\ No newline at end of file
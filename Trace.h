@@ -0,0 +1,269 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+
+/*
+Trace spans in the chrome trace event format, for chrome://tracing or ui.perfetto.dev. the cook stages, every mesh
+flatten_scene converts, mikktspace, and the background work (progressive loads, prefetched frames, the sequence cache)
+record a span with the thread they ran on, so stalls between threads show up on a timeline.
+
+Spans are only recorded while a trace file is set, otherwise a span is one relaxed atomic load. recorded spans are
+appended to the file at the end of every cook. the file is a json array without the closing bracket, which the trace
+event format allows, so it stays valid however many cooks are appended.
+
+The spans aren't per sop, the background threads don't know whose work they do, so every trace file gets the spans of
+the whole process. each sop holds a TraceRegistration for its own Trace File, and a file is open for as long as any sop
+is registered to it: it's started from scratch when the first one registers, and a sop that clears its parameter only
+drops its own registration, the other files keep tracing.
+*/
+
+// events kept between two flushes at most, so a trace left on without cooking (ie. prefetch threads) can't grow forever.
+const size_t kTraceMaxEvents = 1 << 20;
+
+struct TraceEvent {
+	const char* name; // static strings only, the spans are named in code.
+	std::string detail; // mesh or file name, can be empty.
+	char phase; // 'X' for a span, 'M' for a thread name.
+	int thread;
+	double startUs;
+	double durationUs;
+};
+
+static std::atomic<bool> traceEnabled(false);
+static std::mutex traceMutex;
+static std::vector<TraceEvent> traceEvents;
+static size_t traceDropped = 0;
+static std::atomic<int> traceGeneration(0); // counts up with every new trace file.
+
+// a trace file and the sops registered to it.
+struct TraceSink {
+	int users = 0;
+	bool firstEvent = true;
+};
+
+static std::map<std::string, TraceSink> traceSinks;
+static const std::chrono::high_resolution_clock::time_point traceEpoch = std::chrono::high_resolution_clock::now();
+
+// small sequential thread ids read better in the viewer than the os ones.
+int trace_thread_id() {
+	static std::atomic<int> nextThread(1);
+	thread_local int thread = nextThread++;
+	return thread;
+}
+
+void trace_record(const char* name, const char* detail, char phase, double startUs, double durationUs) {
+	TraceEvent event = { name, detail ? detail : "", phase, trace_thread_id(), startUs, durationUs };
+	std::lock_guard<std::mutex> lock(traceMutex);
+	if (traceEvents.size() < kTraceMaxEvents) {
+		traceEvents.push_back(std::move(event));
+	}
+	else {
+		traceDropped++;
+	}
+}
+
+// records a span from start until now, if tracing is on.
+void trace_span(const char* name, std::chrono::high_resolution_clock::time_point start, const char* detail = nullptr) {
+	if (!traceEnabled.load(std::memory_order_relaxed)) {
+		return;
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	trace_record(name, detail, 'X', std::chrono::duration<double, std::micro>(start - traceEpoch).count(),
+		std::chrono::duration<double, std::micro>(end - start).count());
+}
+
+// names the calling thread in the viewer, once per trace file. worker threads call it when they start.
+void trace_thread_name(const char* name) {
+	thread_local int namedGeneration = -1;
+	if (traceEnabled.load(std::memory_order_relaxed) && namedGeneration != traceGeneration) {
+		namedGeneration = traceGeneration;
+		trace_record("thread_name", name, 'M', 0, 0);
+	}
+}
+
+// records a span for its scope.
+class TraceScope {
+public:
+	TraceScope(const char* name, const char* detail = nullptr) : myName(name), myActive(traceEnabled.load(std::memory_order_relaxed)) {
+		if (myActive) {
+			myDetail = detail ? detail : "";
+			myStart = std::chrono::high_resolution_clock::now();
+		}
+	}
+
+	~TraceScope() {
+		if (myActive) {
+			trace_span(myName, myStart, myDetail.c_str());
+		}
+	}
+
+private:
+	const char* myName;
+	bool myActive;
+	std::string myDetail;
+	std::chrono::high_resolution_clock::time_point myStart;
+};
+
+std::string trace_json_string(const std::string& value) {
+	std::string escaped;
+	for (char c : value) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+			escaped += c;
+		}
+		else if ((unsigned char)c < 0x20) {
+			escaped += ' ';
+		}
+		else {
+			escaped += c;
+		}
+	}
+	return escaped;
+}
+
+// registers one more user of file, starting it from scratch if it's new. call with traceMutex held.
+void trace_acquire(const std::string& file) {
+	TraceSink& sink = traceSinks[file];
+	if (sink.users++ > 0) {
+		return;
+	}
+	// spans recorded before the file existed belong to the other files.
+	if (traceSinks.size() == 1) {
+		traceEvents.clear();
+		traceDropped = 0;
+	}
+	traceGeneration++;
+
+	FILE* out = fopen(file.c_str(), "w");
+	if (out) {
+		fputs("[\n", out);
+		fclose(out);
+	}
+	traceEnabled = true;
+}
+
+// drops one user of file, the last one closes it. call with traceMutex held.
+void trace_release(const std::string& file) {
+	auto found = traceSinks.find(file);
+	if (found == traceSinks.end() || --found->second.users > 0) {
+		return;
+	}
+	traceSinks.erase(found);
+	if (traceSinks.empty()) {
+		traceEvents.clear();
+		traceDropped = 0;
+		traceEnabled = false;
+	}
+}
+
+// the trace file of one sop, empty for none. released when the sop goes away.
+class TraceRegistration {
+public:
+	~TraceRegistration() {
+		set("");
+	}
+
+	// switches this sop's registration to file. only called from the cook thread.
+	void set(const std::string& file) {
+		if (file == myFile) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(traceMutex);
+		if (!myFile.empty()) {
+			trace_release(myFile);
+		}
+		myFile = file;
+		if (!myFile.empty()) {
+			trace_acquire(myFile);
+		}
+	}
+
+private:
+	std::string myFile;
+};
+
+// appends the events to one trace file.
+void trace_write(const std::string& file, TraceSink& sink, const std::vector<TraceEvent>& events, size_t dropped) {
+	FILE* out = fopen(file.c_str(), "a");
+	if (!out) {
+		return;
+	}
+	bool& traceFirstEvent = sink.firstEvent;
+	char buffer[256];
+	for (const TraceEvent& event : events) {
+		if (event.phase == 'M') {
+			snprintf(buffer, sizeof(buffer), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"",
+				traceFirstEvent ? "" : ",\n", event.thread);
+			fputs(buffer, out);
+			fputs(trace_json_string(event.detail).c_str(), out);
+			fputs("\"}}", out);
+		}
+		else {
+			snprintf(buffer, sizeof(buffer), "%s{\"name\":\"%s\",\"cat\":\"tdassimp\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+				traceFirstEvent ? "" : ",\n", event.name, event.thread, event.startUs, event.durationUs);
+			fputs(buffer, out);
+			if (!event.detail.empty()) {
+				fputs(",\"args\":{\"detail\":\"", out);
+				fputs(trace_json_string(event.detail).c_str(), out);
+				fputs("\"}", out);
+			}
+			fputs("}", out);
+		}
+		traceFirstEvent = false;
+	}
+	if (dropped) {
+		snprintf(buffer, sizeof(buffer), "%s{\"name\":\"dropped %zu events\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%.3f}",
+			traceFirstEvent ? "" : ",\n", dropped,
+			std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - traceEpoch).count());
+		fputs(buffer, out);
+		traceFirstEvent = false;
+	}
+	fclose(out);
+}
+
+// appends the events recorded since the last flush to every trace file. only called from the cook thread, like
+// TraceRegistration::set, so the files can be written after the lock is let go.
+void trace_flush() {
+	if (!traceEnabled.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	std::vector<TraceEvent> events;
+	size_t dropped = 0;
+	{
+		std::lock_guard<std::mutex> lock(traceMutex);
+		events.swap(traceEvents);
+		std::swap(dropped, traceDropped);
+	}
+	if (events.empty() && dropped == 0) {
+		return;
+	}
+	for (auto& sink : traceSinks) {
+		trace_write(sink.first, sink.second, events, dropped);
+	}
+}
+
+// the whole cook as a span, set up at the top of execute(). writes the cook's spans when it goes out of scope,
+// whichever way execute() returns.
+class TraceCook {
+public:
+	TraceCook(TraceRegistration* registration, const std::string& file) {
+		registration->set(file);
+		trace_thread_name("cook");
+		myStart = std::chrono::high_resolution_clock::now();
+	}
+
+	~TraceCook() {
+		trace_span("cook", myStart);
+		trace_flush();
+	}
+
+private:
+	std::chrono::high_resolution_clock::time_point myStart;
+};
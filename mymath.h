@@ -178,3 +178,26 @@ void tbn_to_quat(float tx, float ty, float tz, float tw, float bx, float by, flo
 		out[2] *= -out[2];
 	}
 }
+
+// packs a tangent frame whose normal moved without its tangent (morphed, or a sequence frame that kept the first frame's
+// tangents). tbn_to_quat expects an orthonormal matrix, so the tangent is turned into the plane of the normal first
+// (gram-schmidt) and the bitangent rebuilt as cross(n, t) * w, like flatten_scene does. a tangent (nearly) along the
+// normal has no direction left in that plane, that frame is packed as it is.
+void orthogonal_tbn_to_quat(const float normal[3], const float tangent[4], const float bitangent[3], float out[4]) {
+	float along = dot(tangent, normal);
+	float t[3] = { tangent[0] - normal[0] * along, tangent[1] - normal[1] * along, tangent[2] - normal[2] * along };
+	float b[3] = { bitangent[0], bitangent[1], bitangent[2] };
+	if (length(t) > 1e-6f) {
+		normalize(t);
+		cross(normal, t, b);
+		b[0] *= tangent[3];
+		b[1] *= tangent[3];
+		b[2] *= tangent[3];
+	}
+	else {
+		t[0] = tangent[0];
+		t[1] = tangent[1];
+		t[2] = tangent[2];
+	}
+	tbn_to_quat(t[0], t[1], t[2], tangent[3], b[0], b[1], b[2], normal[0], normal[1], normal[2], out);
+}